@@ -0,0 +1,285 @@
+﻿#include "ConvertCache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace UnitConvertor;
+
+namespace
+{
+///一个分片:固定数量的槽位加上从键的哈希值到槽位的索引,槽位写满之后由m_Hand指向的位置开始淘汰
+///索引只保存哈希值,查找时再比较槽位中保存的键,哈希值相同的不同键会互相覆盖
+template<typename Value>
+class alignas(64) CacheShard
+{
+public:
+    explicit CacheShard(std::size_t capacity)
+        : m_Slots(capacity)
+    {
+        m_Index.reserve(capacity);
+    }
+
+    bool find(std::size_t hash,const std::string& key,Value& value)
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto it = m_Index.find(hash);
+        if(it == m_Index.end() || m_Slots[it->second].key != key)
+        {
+            m_Misses.fetch_add(1,std::memory_order_relaxed);
+            return false;
+        }
+        Slot& slot = m_Slots[it->second];
+        if(!slot.referenced.load(std::memory_order_relaxed))
+            slot.referenced.store(true,std::memory_order_relaxed);
+        value = slot.value;
+        m_Hits.fetch_add(1,std::memory_order_relaxed);
+        return true;
+    }
+
+    void insert(std::size_t hash,const std::string& key,const Value& value,CachePolicy policy)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_Mutex);
+        auto it = m_Index.find(hash);
+        if(it != m_Index.end())
+        {
+            //其他线程已经写入了相同的结果,或者哈希值冲突时直接覆盖原来的槽位
+            Slot& slot = m_Slots[it->second];
+            slot.key = key;
+            slot.value = value;
+            return;
+        }
+
+        std::size_t victim = m_Used;
+        if(m_Used < m_Slots.size())
+            ++m_Used;
+        else
+        {
+            //FIFO按照写入顺序依次淘汰;CLOCK跳过被读取过的槽位并清除其标记
+            while(policy == CacheClock && m_Slots[m_Hand].referenced.exchange(false,std::memory_order_relaxed))
+                m_Hand = (m_Hand + 1) % m_Slots.size();
+            victim = m_Hand;
+            m_Hand = (m_Hand + 1) % m_Slots.size();
+            m_Index.erase(m_Slots[victim].hash);
+            m_Evictions.fetch_add(1,std::memory_order_relaxed);
+        }
+
+        Slot& slot = m_Slots[victim];
+        slot.hash = hash;
+        slot.key = key;
+        slot.value = value;
+        slot.referenced.store(false,std::memory_order_relaxed);
+        m_Index.emplace(hash,victim);
+    }
+
+    void clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(m_Mutex);
+        m_Index.clear();
+        m_Used = 0;
+        m_Hand = 0;
+    }
+
+    std::uint64_t hits() const noexcept { return m_Hits.load(std::memory_order_relaxed); }
+
+    std::uint64_t misses() const noexcept { return m_Misses.load(std::memory_order_relaxed); }
+
+    std::uint64_t evictions() const noexcept { return m_Evictions.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::size_t hash = 0;
+        std::string key;
+        Value value;
+        std::atomic<bool> referenced{false};   //读锁下也可以修改
+    };
+
+    mutable std::shared_mutex m_Mutex;
+    std::unordered_map<std::size_t,std::size_t> m_Index;
+    std::vector<Slot> m_Slots;
+    std::size_t m_Used = 0;
+    std::size_t m_Hand = 0;
+    std::atomic<std::uint64_t> m_Hits{0};
+    std::atomic<std::uint64_t> m_Misses{0};
+    std::atomic<std::uint64_t> m_Evictions{0};
+};
+
+///缓存键保存在线程局部的字符串中,查找时不需要申请内存
+///解析结果与已经注册的单位有关,键中包含单位个数,注册新单位之后原来的结果不会再被命中
+std::string& parseKey(std::string_view target,DecimalUnit unit)
+{
+    thread_local std::string key;
+    key.assign(1,static_cast<char>(unit));
+    key.push_back(static_cast<char>(UnitConvertor::unitCount()));
+    key.append(target.data(),target.size());
+    return key;
+}
+
+///格式化函数的种类(FormatMode)和参数都是键的一部分
+std::string& formatKey(FormatMode kind,const ValuePack& pack,int first = 0,int second = 0,char fill = 0)
+{
+    struct Fields
+    {
+        double value;
+        int first;
+        int second;
+        std::uint8_t ratio;
+        std::uint8_t unit;
+        std::uint8_t kind;
+        char fill;
+    };
+    Fields fields;
+    std::memset(&fields,0,sizeof(fields));//填充字节也参与比较
+    fields.value = pack.value();
+    fields.first = first;
+    fields.second = second;
+    fields.ratio = static_cast<std::uint8_t>(pack.ratio());
+    fields.unit = static_cast<std::uint8_t>(pack.unit());
+    fields.kind = kind;
+    fields.fill = fill;
+
+    thread_local std::string key;
+    key.assign(reinterpret_cast<const char*>(&fields),sizeof(fields));
+    return key;
+}
+}
+
+class ConvertCache::Tables
+{
+public:
+    Tables(std::size_t capacity,CachePolicy policy,std::size_t shards)
+        : m_Policy(policy)
+    {
+        shards = std::max<std::size_t>(shards,1);
+        const std::size_t perShard = std::max<std::size_t>((capacity + shards - 1) / shards,1);
+        for(std::size_t i = 0; i < shards; i++)
+        {
+            m_Parse.emplace_back(new CacheShard<ParseResult>(perShard));
+            m_Format.emplace_back(new CacheShard<std::string>(perShard));
+        }
+    }
+
+    ParseResult parse(std::string_view target,DecimalUnit unit)
+    {
+        const std::string& key = parseKey(target,unit);
+        const std::size_t hash = std::hash<std::string>()(key);
+        CacheShard<ParseResult>& shard = *m_Parse[shardOf(hash)];
+        ParseResult result;
+        if(shard.find(hash,key,result))
+            return result;
+        result = UnitConvertor::tryFromString(target,unit);
+        shard.insert(hash,key,result,m_Policy);
+        return result;
+    }
+
+    template<typename Format>
+    std::string format(const std::string& key,Format format)
+    {
+        const std::size_t hash = std::hash<std::string>()(key);
+        CacheShard<std::string>& shard = *m_Format[shardOf(hash)];
+        std::string result;
+        if(shard.find(hash,key,result))
+            return result;
+        result = format();
+        shard.insert(hash,key,result,m_Policy);
+        return result;
+    }
+
+    CacheStats stats() const noexcept
+    {
+        CacheStats stats;
+        for(const auto& shard : m_Parse)
+        {
+            stats.parseHits += shard->hits();
+            stats.parseMisses += shard->misses();
+            stats.evictions += shard->evictions();
+        }
+        for(const auto& shard : m_Format)
+        {
+            stats.formatHits += shard->hits();
+            stats.formatMisses += shard->misses();
+            stats.evictions += shard->evictions();
+        }
+        return stats;
+    }
+
+    void clear()
+    {
+        for(auto& shard : m_Parse)
+            shard->clear();
+        for(auto& shard : m_Format)
+            shard->clear();
+    }
+
+private:
+    ///分片内的索引使用哈希值的低位,分片使用高位,避免同一分片内的哈希值集中在少数桶中
+    std::size_t shardOf(std::size_t hash) const noexcept
+    {
+        return (hash >> (sizeof(std::size_t) * 4)) % m_Parse.size();
+    }
+
+    CachePolicy m_Policy;
+    std::vector<std::unique_ptr<CacheShard<ParseResult>>> m_Parse;
+    std::vector<std::unique_ptr<CacheShard<std::string>>> m_Format;
+};
+
+ConvertCache::ConvertCache(std::size_t capacity, CachePolicy policy, std::size_t shards)
+    : m_Tables(new Tables(capacity,policy,shards))
+{
+}
+
+ConvertCache::~ConvertCache() = default;
+
+ValuePack ConvertCache::fromString(std::string_view target, DecimalUnit unit)
+{
+    //缓存tryFromString的结果,它的数据包与fromString相同,数值超出范围时按照fromString的方式抛出异常
+    ParseResult parsed = m_Tables->parse(target,unit);
+    if(parsed.flags & ParseValueOutOfRange)
+        throw std::out_of_range("UnitConvertor::fromString");
+    return parsed.pack;
+}
+
+ParseResult ConvertCache::tryFromString(std::string_view target, DecimalUnit unit)
+{
+    return m_Tables->parse(target,unit);
+}
+
+std::string ConvertCache::toString(const ValuePack &pack)
+{
+    return m_Tables->format(formatKey(FormatString,pack),[&]{ return UnitConvertor::toString(pack); });
+}
+
+std::string ConvertCache::toFormatString(const ValuePack &pack, int precision, bool fixedDecimal)
+{
+    return m_Tables->format(formatKey(FormatPrecision,pack,precision,fixedDecimal),[&]{ return UnitConvertor::toFormatString(pack,precision,fixedDecimal); });
+}
+
+std::string ConvertCache::toFormatString(const ValuePack &pack, int totalLeng, int decimalLen, char fill)
+{
+    return m_Tables->format(formatKey(FormatWidth,pack,totalLeng,decimalLen,fill),[&]{ return UnitConvertor::toFormatString(pack,totalLeng,decimalLen,fill); });
+}
+
+std::string ConvertCache::toScientificString(const ValuePack &pack)
+{
+    return m_Tables->format(formatKey(FormatScientific,pack,6),[&]{ return UnitConvertor::toScientificString(pack); });
+}
+
+std::string ConvertCache::toScientificString(const ValuePack &pack, int precision)
+{
+    return m_Tables->format(formatKey(FormatScientific,pack,precision),[&]{ return UnitConvertor::toScientificString(pack,precision); });
+}
+
+CacheStats ConvertCache::stats() const noexcept
+{
+    return m_Tables->stats();
+}
+
+void ConvertCache::clear()
+{
+    m_Tables->clear();
+}
@@ -0,0 +1,67 @@
+﻿#ifndef CONVERTCACHE_HPP
+#define CONVERTCACHE_HPP
+
+#include "UnitConvertor.hpp"
+
+#include <memory>
+
+namespace UnitConvertor
+{
+    ///缓存写满之后的淘汰策略
+    enum CachePolicy
+    {
+        CacheFifo,      //淘汰最早写入的结果
+        CacheClock      //近似LRU:最近被读取过的结果会被跳过一次
+    };
+
+    ///缓存的命中统计,parse为fromString/tryFromString,format为字符串格式化函数
+    struct CacheStats
+    {
+        std::uint64_t parseHits = 0;
+        std::uint64_t parseMisses = 0;
+        std::uint64_t formatHits = 0;
+        std::uint64_t formatMisses = 0;
+        std::uint64_t evictions = 0;
+    };
+
+    ///fromString和字符串格式化函数的缓存,适合反复转换少量相同设定值的场景(例如界面和脚本)
+    ///返回结果与直接调用UnitConvertor中对应的函数完全相同;缓存分为多个分片,每个分片一把读写锁,命中时只加读锁
+    ///所有成员函数都可以被多个线程同时调用
+    class ConvertCache
+    {
+    public:
+        ///capacity为解析和格式化各自最多缓存的结果数,平均分配给shards个分片
+        explicit ConvertCache(std::size_t capacity = 4096,CachePolicy policy = CacheClock,std::size_t shards = 16);
+
+        ~ConvertCache();
+
+        ConvertCache(const ConvertCache&) = delete;
+
+        ConvertCache& operator = (const ConvertCache&) = delete;
+
+        ValuePack fromString(std::string_view target,DecimalUnit unit = DecimalUnit::UnitNum);
+
+        ParseResult tryFromString(std::string_view target,DecimalUnit unit = DecimalUnit::UnitNum);
+
+        std::string toString(const ValuePack& pack);
+
+        std::string toFormatString(const ValuePack& pack,int precision,bool fixedDecimal = true);
+
+        std::string toFormatString(const ValuePack& pack,int totalLeng,int decimalLen,char fill = '0');
+
+        std::string toScientificString(const ValuePack& pack);
+
+        std::string toScientificString(const ValuePack& pack,int precision);
+
+        CacheStats stats() const noexcept;
+
+        ///清空缓存的结果,统计数据不变
+        void clear();
+
+    private:
+        class Tables;
+        std::unique_ptr<Tables> m_Tables;
+    };
+}
+
+#endif // CONVERTCACHE_HPP
@@ -0,0 +1,233 @@
+﻿#include "ConvertStats.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+using namespace UnitConvertor;
+
+std::uint64_t StatHistogram::quantileNs(double q) const noexcept
+{
+    if(samples == 0)
+        return 0;
+    const double target = q * static_cast<double>(samples);
+    std::uint64_t seen = 0;
+    for(int i = 0; i < StatBuckets; i++)
+    {
+        seen += buckets[i];
+        if(static_cast<double>(seen) >= target)
+            return std::uint64_t(1) << (i + 1);
+    }
+    return std::uint64_t(1) << StatBuckets;
+}
+
+static constexpr std::string_view TimerNames[TimerNum] = {
+    "parse","parse_batch","ratio_to","ratio_to_batch","proper","proper_batch",
+    "numeric_part","unit_part","to_string","to_format_string","to_scientific_string",
+    "format_batch"
+};
+
+static constexpr std::string_view CounterNames[CounterNum] = {
+    "value_missing","multiple_values","value_out_of_range","multiple_units","unknown_unit",
+    "multiple_ratios","unknown_ratio","unexpected_text","out_of_range_thrown",
+    "format_buffer_too_small","format_retry"
+};
+
+std::string_view UnitConvertor::statName(StatTimer timer) noexcept
+{
+    return timer >= 0 && timer < TimerNum ? TimerNames[timer] : std::string_view();
+}
+
+std::string_view UnitConvertor::statName(StatCounter counter) noexcept
+{
+    return counter >= 0 && counter < CounterNum ? CounterNames[counter] : std::string_view();
+}
+
+namespace
+{
+///一个线程的统计数据,只有所属线程写入,写入时先读后写而不是fetch_add,snapshot可以随时读取
+struct ThreadStats
+{
+    struct Histogram
+    {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> samples{0};
+        std::atomic<std::uint64_t> totalNs{0};
+        std::atomic<std::uint64_t> buckets[StatBuckets] = {};
+        unsigned countdown = 0;         //减到0时采样,只有所属线程访问
+    };
+
+    Histogram timers[TimerNum];
+    std::atomic<std::uint64_t> counters[CounterNum] = {};
+};
+
+std::atomic<unsigned> SampleInterval{16};
+
+inline void bump(std::atomic<std::uint64_t>& target,std::uint64_t n) noexcept
+{
+    target.store(target.load(std::memory_order_relaxed) + n,std::memory_order_relaxed);
+}
+
+///所有存活线程的统计数据,以及已经退出的线程合并之后的数据
+struct StatsRegistry
+{
+    std::mutex mutex;
+    std::vector<ThreadStats*> threads;
+    StatsSnapshot retired;
+    StatsSnapshot baseline;     //resetStats()时的值
+};
+
+StatsRegistry& statsRegistry()
+{
+    static StatsRegistry* instance = new StatsRegistry;     //线程退出时还会用到,不析构
+    return *instance;
+}
+
+void addTo(StatsSnapshot& sum,const ThreadStats& stats)
+{
+    for(int t = 0; t < TimerNum; t++)
+    {
+        sum.timers[t].calls += stats.timers[t].calls.load(std::memory_order_relaxed);
+        sum.timers[t].samples += stats.timers[t].samples.load(std::memory_order_relaxed);
+        sum.timers[t].totalNs += stats.timers[t].totalNs.load(std::memory_order_relaxed);
+        for(int b = 0; b < StatBuckets; b++)
+            sum.timers[t].buckets[b] += stats.timers[t].buckets[b].load(std::memory_order_relaxed);
+    }
+    for(int c = 0; c < CounterNum; c++)
+        sum.counters[c] += stats.counters[c].load(std::memory_order_relaxed);
+}
+
+StatsSnapshot mergeAll(StatsRegistry& registry)
+{
+    StatsSnapshot sum = registry.retired;
+    for(const ThreadStats* stats : registry.threads)
+        addTo(sum,*stats);
+    return sum;
+}
+
+///线程第一次记录时注册,退出时把数据合并到retired
+struct ThreadStatsHolder
+{
+    ThreadStats stats;
+
+    ThreadStatsHolder()
+    {
+        StatsRegistry& registry = statsRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.threads.push_back(&stats);
+    }
+
+    ~ThreadStatsHolder()
+    {
+        StatsRegistry& registry = statsRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        addTo(registry.retired,stats);
+        for(std::size_t i = 0; i < registry.threads.size(); i++)
+        {
+            if(registry.threads[i] == &stats)
+            {
+                registry.threads[i] = registry.threads.back();
+                registry.threads.pop_back();
+                break;
+            }
+        }
+    }
+};
+
+inline ThreadStats& threadStats() noexcept
+{
+    thread_local ThreadStatsHolder holder;
+    return holder.stats;
+}
+
+inline int bucketOf(std::uint64_t ns) noexcept
+{
+    int bucket = 0;
+    while(ns > 1 && bucket < StatBuckets - 1)
+    {
+        ns >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+}
+
+void UnitConvertor::recordCount(StatCounter counter, std::uint64_t n) noexcept
+{
+    bump(threadStats().counters[counter],n);
+}
+
+static inline std::int64_t nowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::int64_t UnitConvertor::beginTimer(StatTimer timer) noexcept
+{
+    ThreadStats::Histogram& h = threadStats().timers[timer];
+    bump(h.calls,1);
+    if(h.countdown != 0)
+    {
+        --h.countdown;
+        return -1;
+    }
+    h.countdown = SampleInterval.load(std::memory_order_relaxed) - 1;
+    return nowNs();
+}
+
+void UnitConvertor::endTimer(StatTimer timer, std::int64_t startNs) noexcept
+{
+    const std::int64_t elapsed = nowNs() - startNs;
+    const std::uint64_t ns = elapsed > 0 ? static_cast<std::uint64_t>(elapsed) : 0;
+    ThreadStats::Histogram& h = threadStats().timers[timer];
+    bump(h.samples,1);
+    bump(h.totalNs,ns);
+    bump(h.buckets[bucketOf(ns)],1);
+}
+
+void UnitConvertor::setStatsSampleInterval(unsigned interval) noexcept
+{
+    SampleInterval.store(interval == 0 ? 1 : interval,std::memory_order_relaxed);
+}
+
+void UnitConvertor::recordParseFlags(std::uint8_t flags) noexcept
+{
+    ThreadStats& stats = threadStats();
+    for(int bit = 0; bit < 8; bit++)
+    {
+        if(flags & (1u << bit))
+            bump(stats.counters[CounterValueMissing + bit],1);
+    }
+}
+
+StatsSnapshot UnitConvertor::statsSnapshot()
+{
+    if(!StatsEnabled)
+        return StatsSnapshot();
+
+    StatsRegistry& registry = statsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    StatsSnapshot sum = mergeAll(registry);
+    for(int t = 0; t < TimerNum; t++)
+    {
+        sum.timers[t].calls -= registry.baseline.timers[t].calls;
+        sum.timers[t].samples -= registry.baseline.timers[t].samples;
+        sum.timers[t].totalNs -= registry.baseline.timers[t].totalNs;
+        for(int b = 0; b < StatBuckets; b++)
+            sum.timers[t].buckets[b] -= registry.baseline.timers[t].buckets[b];
+    }
+    for(int c = 0; c < CounterNum; c++)
+        sum.counters[c] -= registry.baseline.counters[c];
+    return sum;
+}
+
+void UnitConvertor::resetStats()
+{
+    if(!StatsEnabled)
+        return;
+
+    StatsRegistry& registry = statsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.baseline = mergeAll(registry);
+}
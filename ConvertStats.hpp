@@ -0,0 +1,137 @@
+﻿#ifndef CONVERTSTATS_HPP
+#define CONVERTSTATS_HPP
+
+#include "UnitConvertor.hpp"
+
+///热点函数的调用次数、延迟直方图和回退路径计数
+///只有定义了UNITCONVERTOR_ENABLE_STATS(例如-DUNITCONVERTOR_ENABLE_STATS)时才统计,否则记录点展开为空,statsSnapshot()返回全0
+///这个宏必须对UnitConvertor.cpp和ConvertStats.cpp使用相同的设置
+///每个线程写自己的计数器(不加锁也没有原子的读-改-写),statsSnapshot()把所有线程(包括已经退出的线程)的数据合并起来
+///读取时钟比大多数被测函数本身还慢,所以调用次数是精确的,延迟只对每个线程每隔若干次调用采样一次(见setStatsSampleInterval)
+namespace UnitConvertor
+{
+    ///记录延迟的函数,数组版本的一次调用算一次
+    enum StatTimer
+    {
+        TimerParse,                 //fromString、tryFromString
+        TimerParseBatch,            //fromStrings
+        TimerRatioTo,               //ratioTo(ValuePack),定义了UNITCONVERTOR_INLINE时这个函数和proper(ValuePack)内联在调用处,不记录
+        TimerRatioToBatch,          //数组版本的ratioTo,ValueColumn版本每一段相同单位的元素算一次
+        TimerProper,                //proper(ValuePack)
+        TimerProperBatch,           //数组版本的proper,ValueColumn版本每一段相同单位的元素算一次
+        TimerNumericPart,
+        TimerUnitPart,
+        TimerToString,
+        TimerToFormatString,
+        TimerToScientificString,
+        TimerFormatBatch,           //toStrings(TextColumn)
+        TimerNum
+    };
+
+    ///回退和错误路径的计数
+    enum StatCounter
+    {
+        CounterValueMissing,        //没有找到数值,使用0
+        CounterMultipleValues,      //找到多个数值,使用0
+        CounterValueOutOfRange,     //数值超出double的范围,使用0
+        CounterMultipleUnits,       //找到多个单位,使用Null
+        CounterUnknownUnit,         //单位无法识别,使用Null
+        CounterMultipleRatios,      //找到多个数量级,使用One
+        CounterUnknownRatio,        //数量级无法识别,使用One
+        CounterUnexpectedText,      //tryFromString、fromStrings发现多余的字符
+        CounterOutOfRangeThrown,    //fromString抛出std::out_of_range
+        CounterFormatBufferTooSmall,//缓冲区版本的格式化函数因为缓冲区不足返回FormatFailed
+        CounterFormatRetry,         //返回std::string的格式化函数栈上缓冲区不足,改用堆上缓冲区重试
+        CounterNum
+    };
+
+    ///直方图的桶数,第i个桶统计延迟在[2^i,2^(i+1)) ns之间的调用,最后一个桶包括更长的延迟
+    inline constexpr int StatBuckets = 32;
+
+    struct StatHistogram
+    {
+        std::uint64_t calls = 0;        //调用次数
+        std::uint64_t samples = 0;      //记录了延迟的调用次数,即buckets之和
+        std::uint64_t totalNs = 0;      //记录了延迟的调用的总时间
+        std::uint64_t buckets[StatBuckets] = {};
+
+        double meanNs() const noexcept { return samples == 0 ? 0 : static_cast<double>(totalNs) / samples; }
+
+        ///延迟的q分位数(0 <= q <= 1)的上界,精度为一个桶(2倍)
+        std::uint64_t quantileNs(double q) const noexcept;
+    };
+
+    struct StatsSnapshot
+    {
+        StatHistogram timers[TimerNum];
+        std::uint64_t counters[CounterNum] = {};
+    };
+
+#ifdef UNITCONVERTOR_ENABLE_STATS
+    inline constexpr bool StatsEnabled = true;
+#else
+    inline constexpr bool StatsEnabled = false;
+#endif
+
+    ///合并所有线程的统计数据,减去上一次resetStats()时的值
+    StatsSnapshot statsSnapshot();
+
+    ///把当前的统计数据作为之后statsSnapshot()的起点;其他线程中正在进行的调用不会丢失也不会被清零
+    void resetStats();
+
+    ///每个线程的每个函数每interval次调用记录一次延迟(第一次调用总是记录),1表示每次都记录,默认为16
+    void setStatsSampleInterval(unsigned interval) noexcept;
+
+    ///导出指标时使用的名称,例如"parse"、"value_missing"
+    std::string_view statName(StatTimer timer) noexcept;
+    std::string_view statName(StatCounter counter) noexcept;
+
+    ///记录当前线程的数据,由记录点调用
+    void recordCount(StatCounter counter,std::uint64_t n = 1) noexcept;
+
+    ///记录一次调用,这次调用需要采样时返回开始时间(ns),否则返回-1
+    std::int64_t beginTimer(StatTimer timer) noexcept;
+
+    ///记录beginTimer()返回的开始时间到现在的延迟
+    void endTimer(StatTimer timer,std::int64_t startNs) noexcept;
+
+    ///ParseFlag的每一位按顺序对应CounterValueMissing到CounterUnexpectedText
+    void recordParseFlags(std::uint8_t flags) noexcept;
+
+    ///在析构时记录从构造开始经过的时间(需要采样时)
+    class StatScope
+    {
+    public:
+        explicit StatScope(StatTimer timer) noexcept
+            : m_Timer(timer),m_Start(beginTimer(timer))
+        {
+        }
+
+        ~StatScope()
+        {
+            if(m_Start >= 0)
+                endTimer(m_Timer,m_Start);
+        }
+
+        StatScope(const StatScope&) = delete;
+        StatScope& operator = (const StatScope&) = delete;
+
+    private:
+        StatTimer m_Timer;
+        std::int64_t m_Start;
+    };
+}
+
+#ifdef UNITCONVERTOR_ENABLE_STATS
+#define UC_STAT_CONCAT_(a,b) a##b
+#define UC_STAT_CONCAT(a,b) UC_STAT_CONCAT_(a,b)
+#define UC_STAT_COUNT(counter) UnitConvertor::recordCount(counter)
+#define UC_STAT_TIMER(timer) UnitConvertor::StatScope UC_STAT_CONCAT(ucStatScope,__LINE__)(timer)
+#define UC_STAT_PARSE_FLAGS(flags) do{ if(flags) UnitConvertor::recordParseFlags(flags); }while(0)
+#else
+#define UC_STAT_COUNT(counter) ((void)0)
+#define UC_STAT_TIMER(timer) ((void)0)
+#define UC_STAT_PARSE_FLAGS(flags) ((void)0)
+#endif
+
+#endif // CONVERTSTATS_HPP
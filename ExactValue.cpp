@@ -0,0 +1,38 @@
+﻿#include "ExactValue.hpp"
+
+#include <cmath>
+
+using namespace UnitConvertor;
+
+///数量级ratio相对于最小数量级的倍数,即Exp的(ratio - minRatio)次方,与ratioTo使用同一张系数表
+static inline double countScale(DecimalUnit unit,DecimalRatio ratio) noexcept
+{
+    return conversionFactor(unit,ratio,generateUnitProperty(unit).minRatio);
+}
+
+ExactValue::ExactValue(const ValuePack &pack) noexcept
+    : m_Unit(pack.unit())
+{
+    const double scaled = std::round(pack.value() * countScale(pack.unit(),pack.ratio()));
+    //2的63次方可以用double精确表示,大于等于它的值超出int64范围
+    if(std::isnan(scaled))
+        m_Count = 0;
+    else if(scaled >= 9223372036854775808.0)
+        m_Count = Max;
+    else if(scaled < -9223372036854775808.0)
+        m_Count = Min;
+    else
+        m_Count = static_cast<std::int64_t>(scaled);
+}
+
+ValuePack ExactValue::toPack() const noexcept
+{
+    return ValuePack(static_cast<double>(m_Count),generateUnitProperty(m_Unit).minRatio,m_Unit);
+}
+
+ValuePack ExactValue::toPack(DecimalRatio ratio) const noexcept
+{
+    ratio = limitRatio(m_Unit,ratio);
+    //除以整数倍数而不是乘以倒数,倍数是整数时结果是正确舍入的
+    return ValuePack(static_cast<double>(m_Count) / countScale(m_Unit,ratio),ratio,m_Unit);
+}
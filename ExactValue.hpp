@@ -0,0 +1,153 @@
+﻿#ifndef EXACTVALUE_HPP
+#define EXACTVALUE_HPP
+
+#include "UnitConvertor.hpp"
+
+#include <functional>
+#include <limits>
+
+///精确的定点表示:以单位允许的最小数量级(UnitProperty::minRatio)为计数单位保存一个int64整数,例如Time以ns计数、Freq以Hz计数
+///比较、加减和哈希都是整数运算,不同数量级的数值相加不会累积浮点误差
+///溢出时结果饱和为int64的最大值或最小值,不会回绕
+class ExactValue
+{
+public:
+    static constexpr std::int64_t Max = std::numeric_limits<std::int64_t>::max();
+    static constexpr std::int64_t Min = std::numeric_limits<std::int64_t>::min();
+
+    ExactValue() = default;
+
+    ///count为以unit的最小数量级表示的计数值
+    constexpr ExactValue(std::int64_t count,UnitConvertor::DecimalUnit unit) noexcept
+        : m_Count(count),m_Unit(unit)
+    {
+    }
+
+    ///由ValuePack转换,四舍五入到最小数量级的整数,超出int64范围时饱和,NaN转换为0
+    explicit ExactValue(const ValuePack& pack) noexcept;
+
+    ///转换为最小数量级表示的ValuePack
+    ValuePack toPack() const noexcept;
+
+    ///转换为ratio数量级表示的ValuePack,ratio超出单位的限制范围时会被调整
+    ValuePack toPack(UnitConvertor::DecimalRatio ratio) const noexcept;
+
+    explicit operator ValuePack() const noexcept { return toPack(); }
+
+    constexpr std::int64_t count() const noexcept { return m_Count; }
+
+    constexpr UnitConvertor::DecimalUnit unit() const noexcept { return m_Unit; }
+
+    ///计数值是否处于饱和状态(可能已经溢出)
+    constexpr bool saturated() const noexcept { return m_Count == Max || m_Count == Min; }
+
+    ///与ValuePack相同,单位不同时返回默认值
+    constexpr ExactValue operator + (const ExactValue& other) const noexcept
+    {
+        return m_Unit == other.m_Unit ? ExactValue(addSaturated(m_Count,other.m_Count),m_Unit) : ExactValue();
+    }
+
+    constexpr ExactValue operator - (const ExactValue& other) const noexcept
+    {
+        return m_Unit == other.m_Unit ? ExactValue(subSaturated(m_Count,other.m_Count),m_Unit) : ExactValue();
+    }
+
+    constexpr ExactValue operator - () const noexcept
+    {
+        return ExactValue(subSaturated(0,m_Count),m_Unit);
+    }
+
+    constexpr ExactValue operator * (std::int64_t factor) const noexcept
+    {
+        return ExactValue(mulSaturated(m_Count,factor),m_Unit);
+    }
+
+    ///整数除法,向0取整;除数为0时按照被除数的符号饱和,0除以0为0
+    constexpr ExactValue operator / (std::int64_t divisor) const noexcept
+    {
+        if(divisor == 0)
+            return ExactValue(m_Count > 0 ? Max : (m_Count < 0 ? Min : 0),m_Unit);
+        if(m_Count == Min && divisor == -1)
+            return ExactValue(Max,m_Unit);
+        return ExactValue(m_Count / divisor,m_Unit);
+    }
+
+    ExactValue& operator += (const ExactValue& other) noexcept { return *this = *this + other; }
+
+    ExactValue& operator -= (const ExactValue& other) noexcept { return *this = *this - other; }
+
+    ExactValue& operator *= (std::int64_t factor) noexcept { return *this = *this * factor; }
+
+    ExactValue& operator /= (std::int64_t divisor) noexcept { return *this = *this / divisor; }
+
+    ///单位相同时比较计数值;单位不同时按照单位的枚举值排序,所以可以直接作为有序容器的键
+    constexpr bool operator == (const ExactValue& other) const noexcept { return m_Unit == other.m_Unit && m_Count == other.m_Count; }
+
+    constexpr bool operator != (const ExactValue& other) const noexcept { return !(*this == other); }
+
+    constexpr bool operator < (const ExactValue& other) const noexcept
+    {
+        return m_Unit != other.m_Unit ? m_Unit < other.m_Unit : m_Count < other.m_Count;
+    }
+
+    constexpr bool operator > (const ExactValue& other) const noexcept { return other < *this; }
+
+    constexpr bool operator <= (const ExactValue& other) const noexcept { return !(other < *this); }
+
+    constexpr bool operator >= (const ExactValue& other) const noexcept { return !(*this < other); }
+
+    ///哈希值只由计数值和单位决定,相等的两个值哈希值相同
+    std::size_t hash() const noexcept
+    {
+        const std::uint64_t x = static_cast<std::uint64_t>(m_Count) * 0x9E3779B97F4A7C15ull ^ m_Unit;
+        return static_cast<std::size_t>(x ^ (x >> 32));
+    }
+
+    static constexpr std::int64_t addSaturated(std::int64_t a,std::int64_t b) noexcept
+    {
+        if(b > 0 && a > Max - b)
+            return Max;
+        if(b < 0 && a < Min - b)
+            return Min;
+        return a + b;
+    }
+
+    static constexpr std::int64_t subSaturated(std::int64_t a,std::int64_t b) noexcept
+    {
+        if(b < 0 && a > Max + b)
+            return Max;
+        if(b > 0 && a < Min + b)
+            return Min;
+        return a - b;
+    }
+
+    static constexpr std::int64_t mulSaturated(std::int64_t a,std::int64_t b) noexcept
+    {
+        if(a == 0 || b == 0)
+            return 0;
+        const bool negative = (a < 0) != (b < 0);
+        //用无符号数比较绝对值,避免对Min取负
+        const std::uint64_t ua = a < 0 ? 0 - static_cast<std::uint64_t>(a) : static_cast<std::uint64_t>(a);
+        const std::uint64_t ub = b < 0 ? 0 - static_cast<std::uint64_t>(b) : static_cast<std::uint64_t>(b);
+        const std::uint64_t limit = negative ? static_cast<std::uint64_t>(Max) + 1 : static_cast<std::uint64_t>(Max);
+        if(ua > limit / ub)
+            return negative ? Min : Max;
+        const std::uint64_t product = ua * ub;
+        return negative ? static_cast<std::int64_t>(0 - product) : static_cast<std::int64_t>(product);
+    }
+
+private:
+    std::int64_t m_Count = 0;
+    UnitConvertor::DecimalUnit m_Unit = UnitConvertor::Null;
+};
+
+namespace std
+{
+    template<>
+    struct hash<ExactValue>
+    {
+        std::size_t operator()(const ExactValue& value) const noexcept { return value.hash(); }
+    };
+}
+
+#endif // EXACTVALUE_HPP
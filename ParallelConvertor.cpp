@@ -0,0 +1,293 @@
+﻿#include "ParallelConvertor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+using namespace UnitConvertor;
+
+///解析和格式化每个元素耗时较长,按较小的块切分;数值转换按缓存行的整数倍切分,避免相邻块写同一缓存行
+static constexpr std::size_t ParseGrain = 256;
+static constexpr std::size_t FormatGrain = 256;
+static constexpr std::size_t ConvertGrain = 16384;
+static constexpr std::size_t ChunkAlign = 64;
+///每个线程分到的块数,块越多负载越均衡,但窃取和同步的次数也越多
+static constexpr std::size_t ChunksPerThread = 8;
+
+class ParallelConvertor::Pool
+{
+public:
+    explicit Pool(unsigned threads)
+        : m_Queues(threads)
+    {
+        for(unsigned i = 1; i < threads; i++)
+            m_Threads.emplace_back([this,i]{ workerLoop(i); });
+    }
+
+    ~Pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_all();
+        for(std::thread& thread : m_Threads)
+            thread.join();
+    }
+
+    unsigned threadCount() const noexcept
+    {
+        return static_cast<unsigned>(m_Queues.size());
+    }
+
+    void run(std::size_t count,std::size_t grain,const std::function<void(std::size_t,std::size_t)>& body)
+    {
+        if(count == 0)
+            return;
+        const std::size_t threads = m_Queues.size();
+        std::size_t chunk = std::max(grain,(count + threads * ChunksPerThread - 1) / (threads * ChunksPerThread));
+        chunk = (chunk + ChunkAlign - 1) / ChunkAlign * ChunkAlign;
+        if(threads == 1 || chunk >= count)
+        {
+            body(0,count);
+            return;
+        }
+
+        std::lock_guard<std::mutex> running(m_RunMutex);
+        const std::size_t tasks = (count + chunk - 1) / chunk;
+        m_Body = &body;
+        m_Error = nullptr;
+        m_Pending.store(tasks,std::memory_order_relaxed);
+
+        //每个线程分到连续的一段块,窃取时从队列另一端取,尽量保持各线程访问的内存连续
+        for(std::size_t q = 0; q < threads; q++)
+        {
+            Queue& queue = m_Queues[q];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for(std::size_t t = tasks * q / threads; t < tasks * (q + 1) / threads; t++)
+                queue.tasks.push_back({t * chunk,std::min(count,(t + 1) * chunk)});
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            ++m_Generation;
+        }
+        m_Wake.notify_all();
+
+        drain(0);
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Done.wait(lock,[this]{ return m_Pending.load(std::memory_order_acquire) == 0; });
+        }
+        m_Body = nullptr;
+        if(m_Error)
+            std::rethrow_exception(m_Error);
+    }
+
+private:
+    struct Task
+    {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(std::size_t self,Task& task)
+    {
+        {
+            Queue& own = m_Queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.tasks.empty())
+            {
+                task = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+        for(std::size_t i = 1; i < m_Queues.size(); i++)
+        {
+            Queue& victim = m_Queues[(self + i) % m_Queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.tasks.empty())
+            {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void drain(std::size_t self)
+    {
+        Task task;
+        while(pop(self,task))
+        {
+            try
+            {
+                (*m_Body)(task.begin,task.end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if(!m_Error)
+                    m_Error = std::current_exception();
+            }
+            if(m_Pending.fetch_sub(1,std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Done.notify_all();
+            }
+        }
+    }
+
+    void workerLoop(std::size_t self)
+    {
+        std::size_t seen = 0;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock,[&]{ return m_Stop || m_Generation != seen; });
+                if(m_Stop)
+                    return;
+                seen = m_Generation;
+            }
+            drain(self);
+        }
+    }
+
+    std::vector<Queue> m_Queues;
+    std::vector<std::thread> m_Threads;
+    std::mutex m_RunMutex;                  //同一时间只执行一个批量任务
+    std::mutex m_Mutex;                     //保护m_Generation、m_Stop、m_Error
+    std::condition_variable m_Wake;
+    std::condition_variable m_Done;
+    std::size_t m_Generation = 0;
+    bool m_Stop = false;
+    std::atomic<std::size_t> m_Pending{0};
+    const std::function<void(std::size_t,std::size_t)>* m_Body = nullptr;
+    std::exception_ptr m_Error;
+};
+
+ParallelConvertor::ParallelConvertor(unsigned threads)
+    : m_Pool(new Pool(threads != 0 ? threads : std::max(1u,std::thread::hardware_concurrency())))
+{
+    //提前完成转换系数表等延迟初始化,工作线程之间只共享只读数据
+    double value = 1;
+    std::uint8_t ratio = One;
+    UnitConvertor::ratioTo(&value,&ratio,1,Freq,Kilo);
+    UnitConvertor::proper(&value,&ratio,1,Freq);
+}
+
+ParallelConvertor::~ParallelConvertor() = default;
+
+unsigned ParallelConvertor::threadCount() const noexcept
+{
+    return m_Pool->threadCount();
+}
+
+void ParallelConvertor::parallelFor(std::size_t count,std::size_t grain,const std::function<void (std::size_t, std::size_t)> &body)
+{
+    m_Pool->run(count,std::max<std::size_t>(grain,1),body);
+}
+
+std::size_t ParallelConvertor::fromStrings(const std::string_view *targets, std::size_t count, double *values, std::uint8_t *ratios, std::uint8_t *units, std::uint8_t *flags, DecimalUnit unit)
+{
+    std::atomic<std::size_t> failed{0};
+    parallelFor(count,ParseGrain,[&](std::size_t begin,std::size_t end){
+        const std::size_t n = UnitConvertor::fromStrings(targets + begin,end - begin,values + begin,ratios + begin,units + begin,flags + begin,unit);
+        failed.fetch_add(n,std::memory_order_relaxed);
+    });
+    return failed.load();
+}
+
+std::size_t ParallelConvertor::fromStrings(const std::string_view *targets, std::size_t count, ValueColumn &column, DecimalUnit unit)
+{
+    column.resize(count);
+    return fromStrings(targets,count,column.values.data(),column.ratios.data(),column.units.data(),column.flags.data(),unit);
+}
+
+void ParallelConvertor::ratioTo(double *values, std::uint8_t *ratios, std::size_t count, DecimalUnit unit, DecimalRatio newRatio)
+{
+    parallelFor(count,ConvertGrain,[&](std::size_t begin,std::size_t end){
+        UnitConvertor::ratioTo(values + begin,ratios + begin,end - begin,unit,newRatio);
+    });
+}
+
+///在[begin,end)范围内按照连续相同的单位分段调用func
+template<typename Func>
+static void forEachUnitRun(const ValueColumn& column,std::size_t begin,std::size_t end,Func func)
+{
+    while(begin < end)
+    {
+        std::size_t next = begin + 1;
+        while(next < end && column.units[next] == column.units[begin])
+            ++next;
+        func(begin,next - begin,static_cast<DecimalUnit>(column.units[begin]));
+        begin = next;
+    }
+}
+
+void ParallelConvertor::ratioTo(ValueColumn &column, DecimalRatio newRatio)
+{
+    parallelFor(column.size(),ConvertGrain,[&](std::size_t begin,std::size_t end){
+        forEachUnitRun(column,begin,end,[&](std::size_t first,std::size_t n,DecimalUnit unit){
+            UnitConvertor::ratioTo(column.values.data() + first,column.ratios.data() + first,n,unit,newRatio);
+        });
+    });
+}
+
+void ParallelConvertor::proper(double *values, std::uint8_t *ratios, std::size_t count, DecimalUnit unit)
+{
+    parallelFor(count,ConvertGrain,[&](std::size_t begin,std::size_t end){
+        UnitConvertor::proper(values + begin,ratios + begin,end - begin,unit);
+    });
+}
+
+void ParallelConvertor::proper(ValueColumn &column)
+{
+    parallelFor(column.size(),ConvertGrain,[&](std::size_t begin,std::size_t end){
+        forEachUnitRun(column,begin,end,[&](std::size_t first,std::size_t n,DecimalUnit unit){
+            UnitConvertor::proper(column.values.data() + first,column.ratios.data() + first,n,unit);
+        });
+    });
+}
+
+std::vector<std::string> ParallelConvertor::toStrings(const ValuePack *packs, std::size_t count)
+{
+    std::vector<std::string> result(count);
+    parallelFor(count,FormatGrain,[&](std::size_t begin,std::size_t end){
+        for(std::size_t i = begin; i < end; i++)
+            result[i] = UnitConvertor::toString(packs[i]);
+    });
+    return result;
+}
+
+std::vector<std::string> ParallelConvertor::toStrings(const ValuePack *packs, std::size_t count, const std::function<std::string (const ValuePack &)> &format)
+{
+    std::vector<std::string> result(count);
+    parallelFor(count,FormatGrain,[&](std::size_t begin,std::size_t end){
+        for(std::size_t i = begin; i < end; i++)
+            result[i] = format(packs[i]);
+    });
+    return result;
+}
+
+std::vector<std::string> ParallelConvertor::toStrings(const ValueColumn &column, const std::function<std::string (const ValuePack &)> &format)
+{
+    std::vector<std::string> result(column.size());
+    parallelFor(column.size(),FormatGrain,[&](std::size_t begin,std::size_t end){
+        for(std::size_t i = begin; i < end; i++)
+            result[i] = format(ValuePack(column.values[i],static_cast<DecimalRatio>(column.ratios[i]),static_cast<DecimalUnit>(column.units[i])));
+    });
+    return result;
+}
@@ -0,0 +1,60 @@
+﻿#ifndef PARALLELCONVERTOR_HPP
+#define PARALLELCONVERTOR_HPP
+
+#include "UnitConvertor.hpp"
+
+#include <functional>
+#include <memory>
+
+namespace UnitConvertor
+{
+    ///多线程批量转换:输入被切分为若干块,每个工作线程优先处理自己队列中的块,空闲时从其他线程的队列窃取
+    ///每个元素的结果都写入与输入相同的下标,因此输出顺序与线程数和调度无关,结果与单线程的批量函数逐位相同
+    ///同一个ParallelConvertor可以被多个线程调用,但同一时间只执行一个批量任务
+    class ParallelConvertor
+    {
+    public:
+        ///threads为0时使用所有核心,调用线程也参与计算,因此只会额外创建threads - 1个线程
+        explicit ParallelConvertor(unsigned threads = 0);
+
+        ~ParallelConvertor();
+
+        ParallelConvertor(const ParallelConvertor&) = delete;
+
+        ParallelConvertor& operator = (const ParallelConvertor&) = delete;
+
+        unsigned threadCount() const noexcept;
+
+        ///把[0,count)切分为不小于grain个元素的块并行执行body(begin,end),body抛出的第一个异常会在所有块结束后重新抛出
+        void parallelFor(std::size_t count,std::size_t grain,const std::function<void(std::size_t begin,std::size_t end)>& body);
+
+        ///与UnitConvertor::fromStrings相同,返回flags不为ParseOk的元素个数
+        std::size_t fromStrings(const std::string_view* targets,std::size_t count,double* values,std::uint8_t* ratios,std::uint8_t* units,std::uint8_t* flags,DecimalUnit unit = DecimalUnit::UnitNum);
+
+        std::size_t fromStrings(const std::string_view* targets,std::size_t count,ValueColumn& column,DecimalUnit unit = DecimalUnit::UnitNum);
+
+        ///与UnitConvertor::ratioTo的数组版本相同
+        void ratioTo(double* values,std::uint8_t* ratios,std::size_t count,DecimalUnit unit,DecimalRatio newRatio);
+
+        void ratioTo(ValueColumn& column,DecimalRatio newRatio);
+
+        ///与UnitConvertor::proper的数组版本相同
+        void proper(double* values,std::uint8_t* ratios,std::size_t count,DecimalUnit unit);
+
+        void proper(ValueColumn& column);
+
+        ///把每个数据包用toString转换为字符串
+        std::vector<std::string> toStrings(const ValuePack* packs,std::size_t count);
+
+        ///把每个数据包用format转换为字符串,format会被多个线程同时调用
+        std::vector<std::string> toStrings(const ValuePack* packs,std::size_t count,const std::function<std::string(const ValuePack&)>& format);
+
+        std::vector<std::string> toStrings(const ValueColumn& column,const std::function<std::string(const ValuePack&)>& format);
+
+    private:
+        class Pool;
+        std::unique_ptr<Pool> m_Pool;
+    };
+}
+
+#endif // PARALLELCONVERTOR_HPP
@@ -0,0 +1,143 @@
+﻿#ifndef QUANTITY_HPP
+#define QUANTITY_HPP
+
+#include "UnitConvertor.hpp"
+
+#include <stdexcept>
+
+namespace UnitConvertor
+{
+    ///编译期计算单位U从From数量级转换为To数量级时需要乘的系数,结果与std::pow(Exp,From - To)相同
+    template<DecimalUnit U,DecimalRatio From,DecimalRatio To>
+    constexpr double quantityFactor()
+    {
+        double factor = 1;
+        for(int i = 0; i < (From > To ? From - To : To - From); i++)
+            factor *= UnitPropertyTable[U].Exp;
+        return From >= To ? factor : 1 / factor;
+    }
+}
+
+///单位和数量级在编译期确定的数值,只保存一个double
+///单位检查和数量级限制都在编译期完成,不同单位之间的运算和比较无法通过编译,相同单位不同数量级之间的转换只需要一次乘法
+template<UnitConvertor::DecimalUnit U,UnitConvertor::DecimalRatio R>
+class Quantity
+{
+    static_assert(U >= UnitConvertor::Null && U < UnitConvertor::UnitNum,"Quantity: invalid unit");
+    static_assert(R >= UnitConvertor::UnitPropertyTable[U].minRatio && R <= UnitConvertor::UnitPropertyTable[U].maxRatio,
+                  "Quantity: ratio is out of the range of this unit");
+
+public:
+    static constexpr UnitConvertor::DecimalUnit unit = U;
+
+    static constexpr UnitConvertor::DecimalRatio ratio = R;
+
+    static constexpr UnitProperty property = UnitConvertor::UnitPropertyTable[U];
+
+    constexpr Quantity() = default;
+
+    constexpr explicit Quantity(double value) noexcept : m_Value(value) {}
+
+    ///相同单位不同数量级之间可以直接转换
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr Quantity(const Quantity<U,R2>& other) noexcept
+        : m_Value(other.value() * UnitConvertor::quantityFactor<U,R2,R>()) {}
+
+    ///从ValuePack转换,单位不一致时抛出std::invalid_argument
+    explicit Quantity(const ValuePack& pack)
+    {
+        if(pack.unit() != U)
+            throw std::invalid_argument("Quantity: unit mismatch");
+        m_Value = UnitConvertor::ratioTo(pack,R).value();
+    }
+
+    explicit operator ValuePack() const
+    {
+        return ValuePack(m_Value,R,U);
+    }
+
+    constexpr double value() const noexcept { return m_Value; }
+
+    constexpr void setValue(double value) noexcept { m_Value = value; }
+
+    ///转换为R2数量级表示
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr Quantity<U,R2> ratioTo() const noexcept
+    {
+        return Quantity<U,R2>(*this);
+    }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr Quantity operator + (const Quantity<U,R2>& other) const noexcept
+    {
+        return Quantity(m_Value + Quantity(other).m_Value);
+    }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr Quantity operator - (const Quantity<U,R2>& other) const noexcept
+    {
+        return Quantity(m_Value - Quantity(other).m_Value);
+    }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr Quantity& operator += (const Quantity<U,R2>& other) noexcept
+    {
+        m_Value += Quantity(other).m_Value;
+        return *this;
+    }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr Quantity& operator -= (const Quantity<U,R2>& other) noexcept
+    {
+        m_Value -= Quantity(other).m_Value;
+        return *this;
+    }
+
+    constexpr Quantity operator * (double factor) const noexcept { return Quantity(m_Value * factor); }
+
+    constexpr Quantity operator / (double divisor) const noexcept { return Quantity(m_Value / divisor); }
+
+    constexpr Quantity& operator *= (double factor) noexcept
+    {
+        m_Value *= factor;
+        return *this;
+    }
+
+    constexpr Quantity& operator /= (double divisor) noexcept
+    {
+        m_Value /= divisor;
+        return *this;
+    }
+
+    constexpr Quantity operator - () const noexcept { return Quantity(-m_Value); }
+
+    ///比较时把other转换到当前数量级
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr bool operator == (const Quantity<U,R2>& other) const noexcept { return m_Value == Quantity(other).m_Value; }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr bool operator != (const Quantity<U,R2>& other) const noexcept { return m_Value != Quantity(other).m_Value; }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr bool operator < (const Quantity<U,R2>& other) const noexcept { return m_Value < Quantity(other).m_Value; }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr bool operator > (const Quantity<U,R2>& other) const noexcept { return m_Value > Quantity(other).m_Value; }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr bool operator <= (const Quantity<U,R2>& other) const noexcept { return m_Value <= Quantity(other).m_Value; }
+
+    template<UnitConvertor::DecimalRatio R2>
+    constexpr bool operator >= (const Quantity<U,R2>& other) const noexcept { return m_Value >= Quantity(other).m_Value; }
+
+private:
+    double m_Value = 0;
+};
+
+template<UnitConvertor::DecimalUnit U,UnitConvertor::DecimalRatio R>
+constexpr Quantity<U,R> operator * (double factor,const Quantity<U,R>& q) noexcept
+{
+    return q * factor;
+}
+
+#endif // QUANTITY_HPP
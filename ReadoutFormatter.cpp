@@ -0,0 +1,120 @@
+﻿#include "ReadoutFormatter.hpp"
+
+#include <cmath>
+
+using namespace UnitConvertor;
+
+ReadoutFormatter::ReadoutFormatter(DecimalUnit unit, int precision, bool fixedDecimal, double hysteresis)
+    : m_Unit(unit),m_Precision(precision),m_FixedDecimal(fixedDecimal)
+{
+    setHysteresis(hysteresis);
+    initScale();
+}
+
+ReadoutFormatter::ReadoutFormatter(DecimalUnit unit, int totalLeng, int decimalLen, char fill, double hysteresis)
+    : m_Unit(unit),m_Width(true),m_Precision(decimalLen),m_TotalLeng(totalLeng),m_Fill(fill)
+{
+    setHysteresis(hysteresis);
+    initScale();
+}
+
+bool ReadoutFormatter::update(double value, DecimalRatio ratio)
+{
+    const ValuePack sample(value,ratio,m_Unit);
+    if(!m_HasValue)
+    {
+        const ValuePack shown = UnitConvertor::proper(sample);
+        m_HasValue = true;
+        m_Ratio = shown.ratio();
+        m_DigitsValid = false;
+        return render(shown.value());
+    }
+
+    //在当前数量级下数值没有超出回差范围时保持数量级不变,否则与proper()一样重新选择
+    ValuePack shown = UnitConvertor::ratioTo(sample,m_Ratio);
+    const UnitProperty p = generateUnitProperty(m_Unit);
+    const double a = std::abs(shown.value());
+    if((a > 1000 * (1 + m_Hysteresis) && m_Ratio < p.maxRatio) || (a > 0 && a < 1 / (1 + m_Hysteresis) && m_Ratio > p.minRatio))
+    {
+        shown = UnitConvertor::proper(sample);
+        if(shown.ratio() != m_Ratio)
+        {
+            m_Ratio = shown.ratio();
+            m_DigitsValid = false;
+        }
+    }
+    return render(shown.value());
+}
+
+bool ReadoutFormatter::update(const ValuePack &pack)
+{
+    if(pack.unit() != m_Unit)
+    {
+        m_Unit = pack.unit();
+        reset();
+    }
+    return update(pack.value(),pack.ratio());
+}
+
+void ReadoutFormatter::setHysteresis(double hysteresis) noexcept
+{
+    m_Hysteresis = hysteresis > 0 ? hysteresis : 0;
+}
+
+void ReadoutFormatter::reset() noexcept
+{
+    m_HasValue = false;
+    m_Ratio = DecimalRatio::One;
+    m_DigitsValid = false;
+    m_Text.clear();
+}
+
+void ReadoutFormatter::initScale() noexcept
+{
+    //小数位数与iostream一样,小于0时按照6处理;位数太多时double无法精确表示乘积,不做判断
+    const int decimals = m_Precision < 0 ? 6 : m_Precision;
+    m_Scale = (m_Width || m_FixedDecimal) && decimals <= 15 ? std::pow(10.0,decimals) : 0;
+}
+
+///数值乘以10的小数位数次方之后与整数digits的距离小于0.5(留出乘法的舍入误差)时,按照定点格式四舍五入得到的就是digits
+static inline bool roundsTo(double scaled,double digits) noexcept
+{
+    const double margin = std::abs(scaled) * 1e-15;
+    return std::abs(scaled) < 4503599627370496.0 && std::abs(scaled - digits) < 0.5 - margin;
+}
+
+bool ReadoutFormatter::render(double value)
+{
+    //定点格式下显示的数字由四舍五入之后的整数决定,整数与上一次相同时不需要重新格式化
+    if(m_DigitsValid && std::signbit(value) == m_Negative && roundsTo(value * m_Scale,m_Digits))
+        return false;
+
+    const ValuePack pack(value,m_Ratio,m_Unit);
+    char buffer[128];
+    std::size_t len = m_Width ? UnitConvertor::toFormatString(pack,buffer,sizeof(buffer),m_TotalLeng,m_Precision,m_Fill)
+                              : UnitConvertor::toFormatString(pack,buffer,sizeof(buffer),m_Precision,m_FixedDecimal);
+    bool changed = false;
+    if(len != UnitConvertor::FormatFailed)
+    {
+        changed = m_Text.compare(0,std::string::npos,buffer,len) != 0;
+        if(changed)
+            m_Text.assign(buffer,len);
+    }
+    else
+    {
+        std::string text = m_Width ? UnitConvertor::toFormatString(pack,m_TotalLeng,m_Precision,m_Fill)
+                                   : UnitConvertor::toFormatString(pack,m_Precision,m_FixedDecimal);
+        changed = text != m_Text;
+        if(changed)
+            m_Text.swap(text);
+    }
+
+    m_DigitsValid = false;
+    if(m_Scale != 0)
+    {
+        m_Digits = std::nearbyint(value * m_Scale);
+        m_DigitsValid = roundsTo(value * m_Scale,m_Digits);
+        m_Negative = std::signbit(value);
+    }
+    return changed;
+}
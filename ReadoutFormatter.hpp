@@ -0,0 +1,69 @@
+﻿#ifndef READOUTFORMATTER_HPP
+#define READOUTFORMATTER_HPP
+
+#include "UnitConvertor.hpp"
+
+namespace UnitConvertor
+{
+    ///实时读数的显示格式化:保存上一次显示的数量级和字符串,每个采样调用一次update
+    ///数量级的切换带有回差:只有数值超出1000 * (1 + hysteresis)或者低于1 / (1 + hysteresis)时才重新选择恰当的数量级,避免数值在边界附近时数量级来回跳动
+    ///hysteresis为0时选择的数量级与proper()相同;显示的数字不会改变时不重新格式化,update返回false,界面可以跳过重绘
+    class ReadoutFormatter
+    {
+    public:
+        ///与toFormatString(pack,precision,fixedDecimal)的格式相同
+        explicit ReadoutFormatter(DecimalUnit unit,int precision = 3,bool fixedDecimal = true,double hysteresis = 0.05);
+
+        ///与toFormatString(pack,totalLeng,decimalLen,fill)的格式相同
+        ReadoutFormatter(DecimalUnit unit,int totalLeng,int decimalLen,char fill,double hysteresis = 0.05);
+
+        ///输入一个新的采样值(数量级为ratio),显示的字符串改变时返回true
+        bool update(double value,DecimalRatio ratio = DecimalRatio::One);
+
+        ///输入一个新的采样值,pack的单位与当前单位不同时先切换单位并重新开始
+        bool update(const ValuePack& pack);
+
+        ///当前显示的字符串,还没有输入采样值时为空
+        const std::string& text() const noexcept { return m_Text; }
+
+        ///当前显示的数量级
+        DecimalRatio ratio() const noexcept { return m_Ratio; }
+
+        DecimalUnit unit() const noexcept { return m_Unit; }
+
+        double hysteresis() const noexcept { return m_Hysteresis; }
+
+        ///设置回差比例,小于0时按0处理
+        void setHysteresis(double hysteresis) noexcept;
+
+        ///清除保存的数量级和字符串,下一个采样值重新选择恰当的数量级
+        void reset() noexcept;
+
+    private:
+        void initScale() noexcept;
+
+        bool render(double value);
+
+        DecimalUnit m_Unit;
+        DecimalRatio m_Ratio = DecimalRatio::One;
+        bool m_HasValue = false;
+        double m_Hysteresis = 0;
+
+        //显示格式
+        bool m_Width = false;       //true时使用totalLeng/decimalLen格式
+        int m_Precision = 3;
+        bool m_FixedDecimal = true;
+        int m_TotalLeng = 0;
+        char m_Fill = '0';
+
+        //上一次显示的数字:定点格式下为数值乘以m_Scale(10的小数位数次方)后四舍五入得到的整数,m_DigitsValid为false时不能用来判断
+        double m_Scale = 0;     //不是定点格式时为0
+        double m_Digits = 0;
+        bool m_DigitsValid = false;
+        bool m_Negative = false;
+
+        std::string m_Text;
+    };
+}
+
+#endif // READOUTFORMATTER_HPP
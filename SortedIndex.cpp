@@ -0,0 +1,161 @@
+﻿#include "SortedIndex.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace UnitConvertor;
+
+///把double映射为大小顺序相同的uint64:正数翻转符号位,负数翻转所有位
+static inline std::uint64_t orderedBits(double value) noexcept
+{
+    if(std::isnan(value))
+        return ~std::uint64_t(0);       //所有NaN(包括符号位为1的)都排在最后
+    value += 0.0;       //-0.0变为0.0
+    std::uint64_t bits;
+    std::memcpy(&bits,&value,sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | 0x8000000000000000ull;
+}
+
+///unit的数量级ratio换算到One的倍数,与ratioTo不同,不受单位数量级范围的限制
+///与ValueStatistics相同,超出范围的数量级按照最大的数量级处理
+static inline double baseFactor(DecimalUnit unit,DecimalRatio ratio) noexcept
+{
+    return conversionFactor(unit,static_cast<DecimalRatio>(std::min<int>(ratio,RatioNum - 1)),One);
+}
+
+SortKey UnitConvertor::sortKey(const ValuePack& pack) noexcept
+{
+    return SortKey{orderedBits(pack.value() * baseFactor(pack.unit(),pack.ratio())),pack.unit()};
+}
+
+void UnitConvertor::sortKeys(const ValuePack* packs,std::size_t count,SortKey* keys) noexcept
+{
+    //按照(单位,数量级)缓存换算系数,避免注册单位每个元素都读取一次单位快照
+    //系数表不初始化,每个单位用一个字节的位图记录已经计算的数量级,小批量时每次调用只需要清零256字节
+    static_assert(RatioNum <= 8,"one bit per ratio");
+    std::array<std::array<double,RatioNum>,256> factors;
+    std::array<std::uint8_t,256> cached{};
+    for(std::size_t i = 0; i < count; i++)
+    {
+        const ValuePack& pack = packs[i];
+        const int ratio = std::min<int>(pack.ratio(),RatioNum - 1);
+        const std::uint8_t bit = static_cast<std::uint8_t>(1u << ratio);
+        double& factor = factors[pack.unit()][ratio];
+        if(!(cached[pack.unit()] & bit))
+        {
+            factor = baseFactor(pack.unit(),pack.ratio());
+            cached[pack.unit()] |= bit;
+        }
+        keys[i] = SortKey{orderedBits(pack.value() * factor),pack.unit()};
+    }
+}
+
+namespace
+{
+struct KeyedIndex
+{
+    SortKey key;
+    std::uint32_t index;
+};
+
+///第digit个排序字节:0~7为value的从低到高字节,8为unit
+inline unsigned keyByte(const SortKey& key,unsigned digit) noexcept
+{
+    return digit < 8 ? static_cast<unsigned>(key.value >> (digit * 8)) & 0xff : key.unit;
+}
+
+///LSD基数排序,一次遍历统计所有字节的直方图,所有元素都相同的字节直接跳过
+///排序键的高字节通常是相同的(同一单位、同一数量级的数值),所以实际的遍历次数一般远少于9次
+void radixSortKeys(std::vector<KeyedIndex>& items)
+{
+    constexpr unsigned Digits = 9;
+    const std::size_t count = items.size();
+    std::vector<std::array<std::size_t,256>> histogram(Digits);
+    for(auto& h : histogram)
+        h.fill(0);
+    for(const KeyedIndex& item : items)
+        for(unsigned d = 0; d < Digits; d++)
+            ++histogram[d][keyByte(item.key,d)];
+
+    std::vector<KeyedIndex> buffer(count);
+    for(unsigned d = 0; d < Digits; d++)
+    {
+        auto& h = histogram[d];
+        if(h[keyByte(items.front().key,d)] == count)
+            continue;
+        std::size_t offset = 0;
+        for(std::size_t& n : h)
+        {
+            const std::size_t c = n;
+            n = offset;
+            offset += c;
+        }
+        for(const KeyedIndex& item : items)
+            buffer[h[keyByte(item.key,d)]++] = item;
+        items.swap(buffer);
+    }
+}
+
+std::vector<KeyedIndex> sortedItems(const ValuePack* packs,std::size_t count)
+{
+    if(count > 0xffffffffu)
+        throw std::length_error("too many values for a sorted index");
+    std::vector<SortKey> keys(count);
+    sortKeys(packs,count,keys.data());
+    std::vector<KeyedIndex> items(count);
+    for(std::size_t i = 0; i < count; i++)
+        items[i] = KeyedIndex{keys[i],static_cast<std::uint32_t>(i)};
+    if(count > 1)
+        radixSortKeys(items);
+    return items;
+}
+}
+
+void UnitConvertor::radixSort(ValuePack* packs,std::size_t count)
+{
+    const std::vector<KeyedIndex> items = sortedItems(packs,count);
+    std::vector<ValuePack> sorted(count);
+    for(std::size_t i = 0; i < count; i++)
+        sorted[i] = packs[items[i].index];
+    std::copy(sorted.begin(),sorted.end(),packs);
+}
+
+SortedIndex::SortedIndex(const ValuePack* packs,std::size_t count)
+{
+    const std::vector<KeyedIndex> items = sortedItems(packs,count);
+    m_Keys.resize(count);
+    m_Order.resize(count);
+    for(std::size_t i = 0; i < count; i++)
+    {
+        m_Keys[i] = items[i].key;
+        m_Order[i] = items[i].index;
+    }
+}
+
+std::size_t SortedIndex::lowerBound(const ValuePack& pack) const noexcept
+{
+    return std::lower_bound(m_Keys.begin(),m_Keys.end(),sortKey(pack)) - m_Keys.begin();
+}
+
+std::size_t SortedIndex::upperBound(const ValuePack& pack) const noexcept
+{
+    return std::upper_bound(m_Keys.begin(),m_Keys.end(),sortKey(pack)) - m_Keys.begin();
+}
+
+std::pair<std::size_t,std::size_t> SortedIndex::range(const ValuePack& low,const ValuePack& high) const noexcept
+{
+    if(low.unit() != high.unit())
+        return {0,0};
+    const std::size_t first = lowerBound(low);
+    return {first,std::max(first,upperBound(high))};
+}
+
+std::pair<std::size_t,std::size_t> SortedIndex::range(DecimalUnit unit) const noexcept
+{
+    const auto first = std::lower_bound(m_Keys.begin(),m_Keys.end(),SortKey{0,unit});
+    const auto last = std::upper_bound(first,m_Keys.end(),SortKey{~std::uint64_t(0),unit});
+    return {static_cast<std::size_t>(first - m_Keys.begin()),static_cast<std::size_t>(last - m_Keys.begin())};
+}
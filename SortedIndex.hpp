@@ -0,0 +1,79 @@
+﻿#ifndef SORTEDINDEX_HPP
+#define SORTEDINDEX_HPP
+
+#include "UnitConvertor.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace UnitConvertor
+{
+    ///ValuePack的排序键:先按照单位排序,单位相同时按照转换到基本数量级(One)之后的数值排序
+    ///value是数值的IEEE 754位模式经过变换之后的无符号整数,大小顺序与数值相同(-0与0相同,NaN排在最后),可以直接用于基数排序
+    struct SortKey
+    {
+        std::uint64_t value = 0;
+        std::uint8_t unit = Null;
+
+        bool operator == (const SortKey& other) const noexcept { return unit == other.unit && value == other.value; }
+
+        bool operator != (const SortKey& other) const noexcept { return !(*this == other); }
+
+        bool operator < (const SortKey& other) const noexcept
+        {
+            return unit != other.unit ? unit < other.unit : value < other.value;
+        }
+    };
+
+    ///计算一个数据包的排序键
+    SortKey sortKey(const ValuePack& pack) noexcept;
+
+    ///计算count个数据包的排序键,每个单位的换算系数只计算一次
+    void sortKeys(const ValuePack* packs,std::size_t count,SortKey* keys) noexcept;
+
+    ///按照排序键比较两个数据包,满足严格弱序,可以用于std::sort和有序容器
+    struct SortKeyLess
+    {
+        bool operator()(const ValuePack& a,const ValuePack& b) const noexcept { return sortKey(a) < sortKey(b); }
+    };
+
+    ///按照排序键对数据包进行稳定的基数排序(原地)
+    void radixSort(ValuePack* packs,std::size_t count);
+
+    ///数据包数组的有序索引:只计算一次排序键并用基数排序,之后的区间查询都是二分查找
+    ///索引只保存排序键和下标,不保存数据包本身;元素个数不能超过2^32 - 1
+    class SortedIndex
+    {
+    public:
+        SortedIndex() = default;
+
+        SortedIndex(const ValuePack* packs,std::size_t count);
+
+        std::size_t size() const noexcept { return m_Order.size(); }
+
+        ///按照排序键从小到大排列的原数组下标,排序键相同的元素保持原来的先后顺序
+        const std::vector<std::uint32_t>& order() const noexcept { return m_Order; }
+
+        ///排序后第i个元素的排序键
+        const SortKey& key(std::size_t i) const noexcept { return m_Keys[i]; }
+
+        ///单位与low相同并且low <= 数值 <= high(比较前换算到相同数量级)的元素,返回order()中的范围[first,second)
+        ///low和high的单位不同时返回空范围
+        std::pair<std::size_t,std::size_t> range(const ValuePack& low,const ValuePack& high) const noexcept;
+
+        ///单位为unit的所有元素,返回order()中的范围[first,second)
+        std::pair<std::size_t,std::size_t> range(DecimalUnit unit) const noexcept;
+
+        ///第一个排序键不小于pack的元素在order()中的位置
+        std::size_t lowerBound(const ValuePack& pack) const noexcept;
+
+        ///第一个排序键大于pack的元素在order()中的位置
+        std::size_t upperBound(const ValuePack& pack) const noexcept;
+
+    private:
+        std::vector<SortKey> m_Keys;            //已经排序
+        std::vector<std::uint32_t> m_Order;
+    };
+}
+
+#endif // SORTEDINDEX_HPP
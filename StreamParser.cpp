@@ -0,0 +1,99 @@
+﻿#include "StreamParser.hpp"
+
+using namespace UnitConvertor;
+
+StreamParser::StreamParser(Callback callback, DecimalUnit unit, std::string_view separators)
+    : m_Callback(std::move(callback)),m_Unit(unit)
+{
+    for(char c : separators)
+        m_Separator[static_cast<unsigned char>(c)] = true;
+    m_Partial.reserve(MaxTokenLength);
+}
+
+StreamParser::StreamParser(ValueColumn &sink, DecimalUnit unit, std::string_view separators)
+    : StreamParser([&sink](const ParseResult& result){
+          sink.values.push_back(result.pack.value());
+          sink.ratios.push_back(static_cast<std::uint8_t>(result.pack.ratio()));
+          sink.units.push_back(static_cast<std::uint8_t>(result.pack.unit()));
+          sink.flags.push_back(result.flags);
+      },unit,separators)
+{
+}
+
+std::size_t StreamParser::feed(std::string_view chunk)
+{
+    std::size_t emitted = 0;
+    const char* p = chunk.data();
+    const char* const end = p + chunk.size();
+    while(p < end)
+    {
+        const char* sep = p;
+        while(sep < end && !m_Separator[static_cast<unsigned char>(*sep)])
+            ++sep;
+        const std::size_t len = static_cast<std::size_t>(sep - p);
+
+        //没有结束的片段保存下来,超过长度限制之后只记录溢出
+        if(sep == end || !m_Partial.empty() || m_Overflow)
+        {
+            if(m_Partial.size() + len > MaxTokenLength)
+                m_Overflow = true;
+            else
+                m_Partial.append(p,len);
+            if(sep == end)
+                break;
+            emitted += emitPartial();
+        }
+        else
+        {
+            emitted += len > MaxTokenLength ? emitOverflow() : emit(std::string_view(p,len));//完整的片段直接在chunk上解析
+        }
+        p = sep + 1;
+    }
+    return emitted;
+}
+
+std::size_t StreamParser::finish()
+{
+    return emitPartial();
+}
+
+void StreamParser::reset() noexcept
+{
+    m_Partial.clear();
+    m_Overflow = false;
+}
+
+std::size_t StreamParser::emitPartial()
+{
+    const std::size_t emitted = m_Overflow ? emitOverflow() : emit(m_Partial);
+    reset();
+    return emitted;
+}
+
+std::size_t StreamParser::emitOverflow()
+{
+    ParseResult result;
+    result.error = ParseUnexpectedText;
+    result.flags = ParseUnexpectedText;
+    result.offset = MaxTokenLength;
+    m_Callback(result);
+    return 1;
+}
+
+std::size_t StreamParser::emit(std::string_view token)
+{
+    bool blank = true;
+    for(char c : token)
+    {
+        if(c != ' ' && c != '\t' && c != '\r' && c != '\n')
+        {
+            blank = false;
+            break;
+        }
+    }
+    if(blank)
+        return 0;
+
+    m_Callback(tryFromString(token,m_Unit));
+    return 1;
+}
@@ -0,0 +1,163 @@
+﻿#ifndef STREAMPARSER_HPP
+#define STREAMPARSER_HPP
+
+#include "UnitConvertor.hpp"
+
+#include <functional>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+#define UNITCONVERTOR_HAS_COROUTINE 1
+#endif
+
+namespace UnitConvertor
+{
+    ///默认的分隔符:逗号、分号和换行
+    inline constexpr std::string_view DefaultSeparators = ",;\n";
+
+    ///增量解析按分隔符分开的数值序列,例如仪器分多次返回的"1.2kHz,3.4kHz,..."
+    ///每次feed()传入任意切分的一段数据,完整的数值立即解析并交给回调函数(结果与tryFromString相同),
+    ///跨越两段数据的数值只保存没有结束的部分,所以占用的内存与整个回复的长度无关
+    ///只包含空白字符的片段(例如连续的分隔符、"\r\n"中的\r)会被忽略
+    class StreamParser
+    {
+    public:
+        using Callback = std::function<void(const ParseResult&)>;
+
+        ///超过这个长度的片段不会被解析,而是报告一个error为ParseUnexpectedText、offset为MaxTokenLength的结果
+        static constexpr std::size_t MaxTokenLength = 256;
+
+        explicit StreamParser(Callback callback,DecimalUnit unit = DecimalUnit::UnitNum,std::string_view separators = DefaultSeparators);
+
+        ///把结果追加到sink中(解析问题写入flags),sink的生存期必须长于StreamParser
+        explicit StreamParser(ValueColumn& sink,DecimalUnit unit = DecimalUnit::UnitNum,std::string_view separators = DefaultSeparators);
+
+        ///解析一段数据,返回这次产生的结果个数
+        std::size_t feed(std::string_view chunk);
+
+        ///数据结束:解析最后一个没有分隔符结尾的片段,返回产生的结果个数(0或1),之后可以继续feed新的数据
+        std::size_t finish();
+
+        ///丢弃没有结束的片段
+        void reset() noexcept;
+
+        ///没有结束的片段的长度
+        std::size_t pending() const noexcept { return m_Partial.size(); }
+
+    private:
+        std::size_t emit(std::string_view token);
+        std::size_t emitPartial();
+        std::size_t emitOverflow();
+
+        Callback m_Callback;
+        DecimalUnit m_Unit;
+        bool m_Separator[256] = {};
+        std::string m_Partial;
+        bool m_Overflow = false;    //当前片段超过了MaxTokenLength
+    };
+
+#ifdef UNITCONVERTOR_HAS_COROUTINE
+    ///parseChunks()返回的生成器,按顺序产生解析结果,只能遍历一次
+    class ParseGenerator
+    {
+    public:
+        struct promise_type
+        {
+            const ParseResult* current = nullptr;
+            std::exception_ptr error;
+
+            ParseGenerator get_return_object() noexcept { return ParseGenerator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            std::suspend_always final_suspend() const noexcept { return {}; }
+            std::suspend_always yield_value(const ParseResult& result) noexcept { current = &result; return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+        };
+
+        struct Sentinel {};
+
+        class Iterator
+        {
+        public:
+            using value_type = ParseResult;
+            using difference_type = std::ptrdiff_t;
+
+            explicit Iterator(std::coroutine_handle<promise_type> handle) noexcept : m_Handle(handle) {}
+
+            const ParseResult& operator*() const noexcept { return *m_Handle.promise().current; }
+            const ParseResult* operator->() const noexcept { return m_Handle.promise().current; }
+
+            Iterator& operator++()
+            {
+                resume(m_Handle);
+                return *this;
+            }
+
+            void operator++(int) { ++*this; }
+
+            bool operator == (Sentinel) const noexcept { return m_Handle.done(); }
+            bool operator != (Sentinel) const noexcept { return !m_Handle.done(); }
+
+        private:
+            std::coroutine_handle<promise_type> m_Handle;
+        };
+
+        ParseGenerator(ParseGenerator&& other) noexcept : m_Handle(other.m_Handle) { other.m_Handle = nullptr; }
+        ParseGenerator(const ParseGenerator&) = delete;
+        ParseGenerator& operator = (const ParseGenerator&) = delete;
+        ParseGenerator& operator = (ParseGenerator&&) = delete;
+
+        ~ParseGenerator()
+        {
+            if(m_Handle)
+                m_Handle.destroy();
+        }
+
+        ///开始解析并停在第一个结果上;读取数据的函数抛出的异常在这里或者递增迭代器时重新抛出
+        Iterator begin()
+        {
+            resume(m_Handle);
+            return Iterator(m_Handle);
+        }
+
+        Sentinel end() const noexcept { return {}; }
+
+    private:
+        explicit ParseGenerator(std::coroutine_handle<promise_type> handle) noexcept : m_Handle(handle) {}
+
+        static void resume(std::coroutine_handle<promise_type> handle)
+        {
+            handle.resume();
+            if(handle.done() && handle.promise().error)
+                std::rethrow_exception(handle.promise().error);
+        }
+
+        std::coroutine_handle<promise_type> m_Handle;
+    };
+
+    ///按需调用read读取下一段数据(返回空数据表示结束),边读边产生解析结果
+    ///每段数据解析完之后才读取下一段,所以缓存的结果个数不超过一段数据中的数值个数
+    ///协程在第一次遍历时才开始执行,separators按值保存在协程中,调用时可以传入临时字符串
+    inline ParseGenerator parseChunks(std::function<std::string_view()> read,DecimalUnit unit = DecimalUnit::UnitNum,std::string separators = std::string(DefaultSeparators))
+    {
+        std::vector<ParseResult> ready;
+        StreamParser parser([&ready](const ParseResult& result){ ready.push_back(result); },unit,separators);
+        for(;;)
+        {
+            const std::string_view chunk = read();
+            if(chunk.empty())
+                parser.finish();
+            else
+                parser.feed(chunk);
+            for(const ParseResult& result : ready)
+                co_yield result;
+            ready.clear();
+            if(chunk.empty())
+                co_return;
+        }
+    }
+#endif
+}
+
+#endif // STREAMPARSER_HPP
@@ -1,253 +1,750 @@
 ﻿#include "UnitConvertor.hpp"
+#include "ConvertStats.hpp"
+#ifndef UNITCONVERTOR_INLINE
+#include "UnitConvertorInline.hpp"
+#endif
 
-#include <iomanip>
-#include <regex>
-#include <set>
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define UC_SIMD_X86 1
+#define UC_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define UC_SIMD_X86 1
+#define UC_TARGET(isa)
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#define UC_SIMD_X86 0
+#endif
 
 using namespace UnitConvertor;
+using UnitConvertor::Detail::ratioFactor;
+using UnitConvertor::Detail::properValue;
 
-static std::once_flag ratioMapOnce;
-static std::once_flag unitMapOnce;
-static std::unordered_map<std::string,std::size_t> GlobalRatioMap;
-static std::unordered_map<std::string,std::size_t> GlobalUnitMap;
+///判断字符是否为数字
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
 
-std::string toLower(const std::string& str)
+///将ASCII大写字母转换为小写,其余字符保持不变
+static constexpr inline char asciiLower(char c)
 {
-    std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(),[](unsigned char c) { return std::tolower(c); });
-    return result;
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
 }
 
-void initRatioMap()
+///在pos处按照 -?\d*\.?\d+([eE][-+]?\d+)? 的规则匹配一个数值,返回匹配长度,匹配失败时返回0
+static std::size_t matchDecimal(const char* pos,const char* end)
 {
-    for(int i = 0; i < UnitConvertor::RatioNum; i++)
+    const char* p = pos;
+    if(p != end && *p == '-')
+        ++p;
+
+    const char* intBegin = p;
+    while(p != end && isDigit(*p))
+        ++p;
+
+    //小数点后面必须跟着数字,否则小数点不属于这个数值
+    if(p != end && *p == '.' && p + 1 != end && isDigit(p[1]))
+    {
+        p += 2;
+        while(p != end && isDigit(*p))
+            ++p;
+    }
+    else if(p == intBegin)
+    {
+        return 0;
+    }
+
+    //科学计数法的指数部分,e后面没有数字时e不属于这个数值
+    if(p != end && (*p == 'e' || *p == 'E'))
     {
-        GlobalRatioMap.emplace(DecimalRatioString[i],i);
+        const char* q = p + 1;
+        if(q != end && (*q == '+' || *q == '-'))
+            ++q;
+        if(q != end && isDigit(*q))
+        {
+            while(q != end && isDigit(*q))
+                ++q;
+            p = q;
+        }
     }
+    return static_cast<std::size_t>(p - pos);
 }
 
-void initUnitMap()
+///判断pos处是否以token开头,ignoreCase为true时忽略ASCII大小写
+static inline bool startsWith(const char* pos,const char* end,std::string_view token,bool ignoreCase) noexcept
 {
-    for(int i = 0; i < UnitConvertor::UnitNum; i++)
+    if(token.length() > static_cast<std::size_t>(end - pos))
+        return false;
+    std::size_t j = 0;
+    if(ignoreCase)
+        while(j < token.length() && asciiLower(pos[j]) == asciiLower(token[j])) ++j;
+    else
+        while(j < token.length() && pos[j] == token[j]) ++j;
+    return j == token.length();
+}
+
+///编译期根据字符串数组生成的查找表(只有一层的字典树):按照首字符分组,每组内按照长度从长到短排列
+///查找时只需要比较首字符相同的几个字符串,直接在输入缓冲区中做最长匹配,不需要转换大小写也不需要申请内存
+template<std::size_t N>
+struct TokenTable
+{
+    static_assert(N < 256,"TokenTable stores indices in one byte");
+
+    const std::string_view* tokens = nullptr;
+    bool ignoreCase = false;
+    std::uint8_t start[257] = {};   //首字符为c的字符串在order中的范围是[start[c],start[c + 1])
+    std::uint8_t order[N] = {};     //字符串在数组中的下标
+
+    static constexpr unsigned char key(char c,bool ignoreCase)
     {
-        GlobalUnitMap.emplace(toLower(DecimalUnitString[i]),i);//查找单位时转换为小写
+        return static_cast<unsigned char>(ignoreCase ? asciiLower(c) : c);
     }
+
+    ///在pos处查找最长的匹配项(空字符串不参与匹配),返回匹配长度,index保存匹配项的下标
+    std::size_t match(const char* pos,const char* end,int& index) const noexcept
+    {
+        if(pos >= end)
+            return 0;
+        const unsigned char c = key(*pos,ignoreCase);
+        for(int i = start[c]; i < start[c + 1]; i++)
+        {
+            const std::string_view token = tokens[order[i]];
+            if(startsWith(pos,end,token,ignoreCase))
+            {
+                index = order[i];
+                return token.length();
+            }
+        }
+        return 0;
+    }
+};
+
+template<std::size_t N>
+static constexpr TokenTable<N> makeTokenTable(const std::string_view (&tokens)[N],bool ignoreCase)
+{
+    TokenTable<N> table;
+    table.tokens = tokens;
+    table.ignoreCase = ignoreCase;
+
+    std::size_t count[256] = {};
+    for(std::size_t i = 0; i < N; i++)
+        if(!tokens[i].empty())
+            ++count[TokenTable<N>::key(tokens[i][0],ignoreCase)];
+    for(std::size_t c = 0; c < 256; c++)
+        table.start[c + 1] = static_cast<std::uint8_t>(table.start[c] + count[c]);
+
+    std::size_t filled[256] = {};
+    for(std::size_t i = 0; i < N; i++)
+    {
+        if(tokens[i].empty())
+            continue;
+        const unsigned char c = TokenTable<N>::key(tokens[i][0],ignoreCase);
+        //插入排序,保证同一组内长的字符串在前面
+        std::size_t pos = table.start[c] + filled[c]++;
+        while(pos > table.start[c] && tokens[table.order[pos - 1]].length() < tokens[i].length())
+        {
+            table.order[pos] = table.order[pos - 1];
+            --pos;
+        }
+        table.order[pos] = static_cast<std::uint8_t>(i);
+    }
+    return table;
 }
 
-///获取比例字符串和枚举值的映射关系
-static const std::unordered_map<std::string,std::size_t>& ratioMap()
+///数量级必须区分大小写,因为m和M会重复;单位不区分大小写
+static constexpr TokenTable<RatioNum> RatioTokenTable = makeTokenTable(DecimalRatioString,false);
+static constexpr TokenTable<UnitNum> UnitTokenTable = makeTokenTable(DecimalUnitString,true);
+
+///判断两个字符串是否相同(忽略ASCII大小写)
+static inline bool equalsIgnoreCase(std::string_view a,std::string_view b) noexcept
 {
-    std::call_once(ratioMapOnce,initRatioMap);
-    return GlobalRatioMap;
+    return a.length() == b.length() && startsWith(a.data(),a.data() + a.length(),b,true);
 }
 
-///获取单位字符串和枚举值的映射关系
-static const std::unordered_map<std::string,std::size_t>& unitMap()
+///运行时注册的单位组成的只读快照,包含内置单位,下标为单位枚举值(UnitNum处为空位)
+///注册单位时复制当前快照生成新的快照并原子地替换(RCU),读取方只需要一次原子读取,旧的快照不会被释放
+struct UnitSnapshot
 {
-    std::call_once(unitMapOnce,initUnitMap);
-    return GlobalUnitMap;
+    std::size_t count = UnitNum + 1;
+    std::vector<UnitProperty> properties;
+    std::vector<std::string_view> names;
+    std::vector<std::array<double,2 * RatioNum - 1>> factors;  //与RatioFactorTable相同
+    std::uint16_t start[257] = {};      //与TokenTable相同:首字符为c的单位在order中的范围
+    std::vector<std::uint8_t> order;
+
+    bool contains(DecimalUnit unit) const noexcept
+    {
+        return unit > UnitNum && unit < count;
+    }
+
+    ///与TokenTable::match相同,在所有单位(包括内置单位)中查找最长的匹配项
+    std::size_t match(const char* pos,const char* end,int& index) const noexcept
+    {
+        if(pos >= end)
+            return 0;
+        const unsigned char c = static_cast<unsigned char>(asciiLower(*pos));
+        for(int i = start[c]; i < start[c + 1]; i++)
+        {
+            const std::string_view token = names[order[i]];
+            if(startsWith(pos,end,token,true))
+            {
+                index = order[i];
+                return token.length();
+            }
+        }
+        return 0;
+    }
+
+    ///按照首字符分组、组内从长到短排列,生成查找用的索引
+    void buildIndex()
+    {
+        order.clear();
+        for(std::size_t i = 0; i < names.size(); i++)
+            if(!names[i].empty())
+                order.push_back(static_cast<std::uint8_t>(i));
+        std::stable_sort(order.begin(),order.end(),[this](std::uint8_t a,std::uint8_t b){
+            const unsigned char ca = static_cast<unsigned char>(asciiLower(names[a][0]));
+            const unsigned char cb = static_cast<unsigned char>(asciiLower(names[b][0]));
+            return ca != cb ? ca < cb : names[a].length() > names[b].length();
+        });
+        std::fill(std::begin(start),std::end(start),std::uint16_t(0));
+        for(std::uint8_t i : order)
+            ++start[static_cast<unsigned char>(asciiLower(names[i][0])) + 1];
+        for(std::size_t c = 0; c < 256; c++)
+            start[c + 1] = static_cast<std::uint16_t>(start[c + 1] + start[c]);
+    }
+};
+
+///当前的单位快照,没有注册过单位时为空,这时所有函数都只使用编译期生成的内置表
+static std::atomic<const UnitSnapshot*> CurrentUnits{nullptr};
+
+static inline const UnitSnapshot* currentUnits() noexcept
+{
+    return CurrentUnits.load(std::memory_order_acquire);
 }
 
-///转义正则表达式特殊字符
-const std::string escapeRegex(const std::string &str)
+///调用者指定的单位是否为内置单位或者已经注册的单位
+static inline bool knownUnit(DecimalUnit unit,const UnitSnapshot* units) noexcept
 {
-    std::string result;
-    for (char c : str)
+    return unit < UnitNum || (units != nullptr && units->contains(unit));
+}
+
+///由字符串数组中的字符串首尾相连组成的一段连续字符
+struct TokenRun
+{
+    const char* begin = nullptr;
+    std::size_t length = 0;
+    int index = -1;     //第一个字符串在数组中的下标
+    int tokens = 0;     //这一段中包含的字符串个数
+    int runs = 0;       //查找范围内一共找到的段数(最多统计到2)
+    const char* next = nullptr;//第二段的起始位置
+};
+
+///在[begin,end)中查找由查找表中的字符串组成的连续片段,找到第二段之后停止查找
+template<typename Table>
+static TokenRun scanTokenRun(const char* begin,const char* end,const Table& table) noexcept
+{
+    TokenRun run;
+    const char* p = begin;
+    while(p < end)
     {
-        if (c == '.' || c == '*' || c == '+' || c == '?' || c == '^' ||
-            c == '$' || c == '|' || c == '(' || c == ')' || c == '[' ||
-            c == ']' || c == '{' || c == '}' || c == '\\')
+        int index = -1;
+        std::size_t len = table.match(p,end,index);
+        if(len == 0)
+        {
+            ++p;
+            continue;
+        }
+
+        if(++run.runs > 1)
         {
-            result += '\\';
+            run.next = p;
+            break;
         }
-        result += c;
+
+        run.begin = p;
+        run.index = index;
+        while(len != 0)
+        {
+            p += len;
+            ++run.tokens;
+            len = table.match(p,end,index);
+        }
+        run.length = static_cast<std::size_t>(p - run.begin);
     }
-    return result;
+    return run;
 }
 
-///自定义比较函数对象
-struct LengthCompare
+///单次扫描字符串得到的数值、数量级和单位,以及它们在字符串中的位置
+struct ScanResult
 {
-    bool operator()(const std::string& a, const std::string& b) const {
-        if (a.length() != b.length())
+    double value = 0;
+    DecimalRatio ratio = UnitConvertor::One;
+    DecimalUnit unit = UnitConvertor::Null;
+    std::uint8_t flags = ParseOk;
+    ParseFlag error = ParseOk;          //第一个发现的问题
+    const char* errorPos = nullptr;     //第一个问题出现的位置
+
+    const char* valueBegin = nullptr;
+    std::size_t valueLen = 0;
+    const char* unitBegin = nullptr;
+    std::size_t unitLen = 0;
+    const char* ratioBegin = nullptr;
+    std::size_t ratioLen = 0;
+
+    void addFlag(ParseFlag flag,const char* pos) noexcept
+    {
+        flags |= flag;
+        if(error == ParseOk)
         {
-            return a.length() > b.length(); // 长度长的在前
+            error = flag;
+            errorPos = pos;
         }
-        return a < b; // 长度相同时按字典序排列
     }
 };
 
-///生成一个可以自动匹配string数组中各个字符串的正则表达式
-const std::string generateRegexString(const std::string *array, const std::size_t arraySize)
+///不使用正则表达式扫描[begin,end),规则与原来的正则表达式相同:
+///数值、单位、数量级都必须恰好找到一个,找到多个或者没有找到时使用默认值
+static ScanResult scanString(const char* begin,const char* end,DecimalUnit unit) noexcept
 {
-    std::set<std::string, LengthCompare> stringSet;
-    // 按长度降序排序，确保长匹配优先
-    for (size_t i = 0; i < arraySize; ++i)
+    ScanResult result;
+
+    //先查找数字,只统计到第二个数字为止
+    const char* secondValue = nullptr;
+    int valueCount = 0;
+    for(const char* p = begin; p < end;)
     {
-        if (!array[i].empty())
+        std::size_t len = matchDecimal(p,end);
+        if(len == 0)
         {
-            stringSet.insert(array[i]);
+            ++p;
+            continue;
         }
+
+        if(++valueCount > 1)
+        {
+            secondValue = p;
+            break;
+        }
+        result.valueBegin = p;
+        result.valueLen = len;
+        p += len;
     }
 
-    std::string pattern;
-    pattern.append("(");
+    if(valueCount == 0)
+    {
+        result.addFlag(ParseValueMissing,begin);
+    }
+    else if(valueCount > 1)
+    {
+        result.addFlag(ParseMultipleValues,secondValue);
+    }
+    else
+    {
+        if(std::from_chars(result.valueBegin,result.valueBegin + result.valueLen,result.value).ec != std::errc())
+            result.addFlag(ParseValueOutOfRange,result.valueBegin);
+        begin += result.valueLen;//按照数值长度缩小查找范围(与原来的正则表达式实现保持一致)
+    }
+
+    //再查找单位对应的字符串,单位不区分大小写;注册过单位时在快照中查找
+    const UnitSnapshot* units = currentUnits();
+    if(knownUnit(unit,units))
+    {
+        result.unit = unit;
+        //末尾与指定单位相同的字符串不参与数量级的查找,例如指定单位Ohm时"5 kOhm"中的m
+        //内置单位的字符串中没有数量级字符,所以这一步只影响注册的单位
+        const std::string_view name = unitName(unit);
+        const char* tail = end;
+        while(tail > begin && (tail[-1] == ' ' || tail[-1] == '\t' || tail[-1] == '\r' || tail[-1] == '\n'))
+            --tail;
+        if(!name.empty() && static_cast<std::size_t>(tail - begin) >= name.length() && startsWith(tail - name.length(),tail,name,true))
+            end = tail - name.length();
+    }
+    else
+    {
+        TokenRun run = units != nullptr ? scanTokenRun(begin,end,*units) : scanTokenRun(begin,end,UnitTokenTable);
+        if(run.runs == 1)
+        {
+            if(run.tokens == 1)
+                result.unit = static_cast<DecimalUnit>(run.index);
+            else
+                result.addFlag(ParseUnknownUnit,run.begin);
+            result.unitBegin = run.begin;
+            result.unitLen = run.length;
+            end -= run.length;//再次缩小查找范围
+        }
+        else if(run.runs > 1)
+        {
+            result.addFlag(ParseMultipleUnits,run.next);
+        }
+    }
 
-    // 构建正则表达式字符串
-    for (auto it = stringSet.begin(); it != stringSet.end(); ++it)
+    //数量级必须区分大小写,因为m和M会重复
+    TokenRun run = scanTokenRun(begin,end,RatioTokenTable);
+    if(run.runs == 1)
     {
-        if (it != stringSet.begin())
-            pattern.append("|");
+        if(run.tokens == 1)
+            result.ratio = static_cast<DecimalRatio>(run.index);
+        else
+            result.addFlag(ParseUnknownRatio,run.begin);
+        result.ratioBegin = run.begin;
+        result.ratioLen = run.length;
+    }
+    else if(run.runs > 1)
+    {
+        result.addFlag(ParseMultipleRatios,run.next);
+    }
+
+    return result;
+}
 
-        pattern.append(escapeRegex(*it));
+///检查[begin,end)中是否还有不属于数值、数量级、单位的字符(空白字符除外),有则记录ParseUnexpectedText
+///unit为调用者指定的单位时字符串中的单位没有被查找,这时与指定单位相同的字符串也是允许的
+static void checkUnexpectedText(const char* begin,const char* end,DecimalUnit unit,ScanResult& result) noexcept
+{
+    const bool givenUnit = knownUnit(unit,currentUnits());
+    const std::string_view name = givenUnit ? unitName(unit) : std::string_view();
+    for(const char* p = begin; p < end;)
+    {
+        if(p == result.valueBegin)
+        {
+            p += result.valueLen;
+        }
+        else if(p == result.unitBegin)
+        {
+            p += result.unitLen;
+        }
+        else if(p == result.ratioBegin)
+        {
+            p += result.ratioLen;
+        }
+        else if(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        {
+            ++p;
+        }
+        else
+        {
+            const std::size_t len = givenUnit && startsWith(p,end,name,true) ? name.length() : 0;
+            if(len == 0)
+            {
+                result.addFlag(ParseUnexpectedText,p);
+                return;
+            }
+            p += len;
+        }
     }
-    pattern.append( ")+");
-    return pattern;
 }
 
-///返回一个查找比例字符串的正则表达式,根据比例字符串数组自动生成一个用于查找比例字符串的正则表达式,更新比例字符串数组之后正则表达式会自动更新(quf)
-const std::regex& ratioRegex()
+///判断字符串小数部分是否全部都是0,如果小数点后面全部都是0则删除,返回删除之后的长度
+///这样就不需要区分ValuePack的m_Value原本是浮点值还是整数值,避免整数值传入ValuePack转字符串之后后面有0
+static std::size_t trimFractional(const char* buffer,std::size_t len) noexcept
 {
-    //数量级必须区分大小写,因为m和M会重复
-    static const std::regex instance(generateRegexString(DecimalRatioString,RatioNum)/*,std::regex_constants::icase*/);
-    return instance;
+    std::size_t zeros = 0;
+    while(zeros < len && buffer[len - 1 - zeros] == '0')
+        ++zeros;
+    if(zeros == 0 || zeros == len || buffer[len - 1 - zeros] != '.')
+        return len;
+    return len - zeros - 1;
 }
 
-///返回一个查找单位字符串的正则表达式,根据单位字符串数组自动生成一个用于查找单位字符串的正则表达式,更新单位字符串数组之后正则表达式会自动更新
-const std::regex& unitRegex()
+///判断科学计数法字符串的小数部分是否全部为0,如果全部为0则删除小数部分,返回删除之后的长度
+static std::size_t trimScientific(char* buffer,std::size_t len) noexcept
 {
-    static const std::regex instance(generateRegexString(DecimalUnitString,UnitNum),std::regex_constants::icase);
-    return instance;
+    const char* e = static_cast<const char*>(std::memchr(buffer,'e',len));
+    if(e == nullptr)
+        return len;
+
+    const std::size_t exp = static_cast<std::size_t>(e - buffer);
+    const std::size_t mantissa = trimFractional(buffer,exp);
+    if(mantissa == exp)
+        return len;
+
+    std::memmove(buffer + mantissa,buffer + exp,len - exp);
+    return len - (exp - mantissa);
 }
 
-///返回查找数值字符串的正则表达式[暂时还不支持科学计数法]
-const std::regex& decimalRegex()
+///数值部分的输出格式,对应iostream的std::fixed/默认格式/std::scientific以及setprecision、setw、setfill
+struct NumberFormat
 {
-    //如果支持正则表达式之后还要修改数值转换部分代码,正则表达式匹配科学计数法会产生两部分结果
-    //static const std::regex reg(R"(^[-+]?(\d+\.\d+|\d+\.?|\.\d+)([eE][-+]?\d+)?$)");
+    std::chars_format format = std::chars_format::fixed;
+    int precision = 6;
+    int width = 0;
+    char fill = ' ';
+};
+
+///按照iostream的规则输出数值,precision小于0时与iostream一样按照6处理,长度不足width时与iostream的默认对齐方式一样在左侧填充
+///最后删除全部为0的小数部分,缓冲区长度不足时返回FormatFailed
+static std::size_t formatNumber(char* buffer,std::size_t size,double value,const NumberFormat& fmt) noexcept
+{
+    const int precision = fmt.precision < 0 ? 6 : fmt.precision;
+    const std::size_t width = fmt.width > 0 ? static_cast<std::size_t>(fmt.width) : 0;
 
-    static const std::regex  reg(R"(-?\d*\.?\d+)",std::regex_constants::icase);
-    return reg;
+    //先写入栈上的缓冲区,这样buffer只需要能够容纳删除0之后的结果;栈上的缓冲区不够用时直接写入buffer
+    char local[384];
+    char* out = local;
+    std::size_t capacity = sizeof(local);
+    std::to_chars_result r = std::to_chars(local,local + sizeof(local),value,fmt.format,precision);
+    if(r.ec != std::errc() || width > sizeof(local))
+    {
+        out = buffer;
+        capacity = size;
+        r = std::to_chars(buffer,buffer + size,value,fmt.format,precision);
+        if(r.ec != std::errc())
+            return FormatFailed;
+    }
+
+    std::size_t len = static_cast<std::size_t>(r.ptr - out);
+    if(len < width)
+    {
+        if(width > capacity)
+            return FormatFailed;
+        std::memmove(out + width - len,out,len);
+        std::memset(out,fmt.fill,width - len);
+        len = width;
+    }
+
+    len = fmt.format == std::chars_format::scientific ? trimScientific(out,len) : trimFractional(out,len);
+    if(out == local)
+    {
+        if(len > size)
+            return FormatFailed;
+        std::memcpy(buffer,local,len);
+    }
+    return len;
 }
 
-///判断字符串小数部分是否全部都是0,如果小数点后面全部都是0则删除
-///这样就不需要区分ValuePack的m_Value原本是浮点值还是整数值,避免整数值传入ValuePack转字符串之后后面有0
-const std::regex& fractionalRegex()
+///输出单位部分(数量级和单位字符串),缓冲区长度不足时返回FormatFailed
+static std::size_t formatUnit(const ValuePack& pack,char* buffer,std::size_t size) noexcept
 {
-    static const std::regex  reg(R"(\.0+$)");
-    return reg;
+    const std::string_view ratio = UnitConvertor::DecimalRatioString[pack.ratio()];
+    const std::string_view unit = UnitConvertor::unitName(pack.unit());
+    if(ratio.length() + unit.length() > size)
+        return FormatFailed;
+    //结果为空时buffer可以是nullptr,std::copy对空范围不访问buffer
+    std::copy(unit.begin(),unit.end(),std::copy(ratio.begin(),ratio.end(),buffer));
+    return ratio.length() + unit.length();
 }
 
-///判断科学计数法字符串的小数部分是否全部为0
-const std::regex& scientificRegex()
+///输出"数值 单位"形式的字符串,缓冲区长度不足时返回FormatFailed
+static std::size_t formatValue(const ValuePack& pack,char* buffer,std::size_t size,const NumberFormat& fmt) noexcept
 {
-    static const std::regex  reg(R"(\.0+e)",std::regex_constants::icase);
-    return reg;
+    std::size_t len = formatNumber(buffer,size,pack.value(),fmt);
+    if(len == FormatFailed || len >= size)
+        return FormatFailed;
+    buffer[len++] = ' ';
+    std::size_t unitLen = formatUnit(pack,buffer + len,size - len);
+    return unitLen == FormatFailed ? FormatFailed : len + unitLen;
 }
 
-///通过三个字符串生成数据包
-ValuePack generateValuePack(const std::string& valueStr,const std::string& ratioStr,const std::string& unitStr)
+///对外接口返回内部格式化函数的结果,失败时记录缓冲区不足的次数
+static inline std::size_t formatResult(std::size_t len) noexcept
 {
-    double value = std::stod(valueStr);
-    DecimalRatio ratio;
-    DecimalUnit unit ;
+    if(len == FormatFailed)
+        UC_STAT_COUNT(CounterFormatBufferTooSmall);
+    return len;
+}
 
-    try {
-        ratio = static_cast<DecimalRatio>(ratioMap().at(ratioStr));
-    } catch (std::out_of_range) {
-        ratio = UnitConvertor::One;
-    }
+///通过写入缓冲区的函数生成字符串,栈上的缓冲区不够时换成更大的缓冲区重新写入
+template<typename Writer>
+static std::string writeString(Writer write)
+{
+    char local[256];
+    std::size_t len = write(local,sizeof(local));
+    if(len != FormatFailed)
+        return std::string(local,len);
 
-    try {
-        unit = static_cast<DecimalUnit>(unitMap().at(toLower(unitStr)));//查找单位时转换为小写
-    } catch (std::out_of_range) {
-        unit = UnitConvertor::Null;
+    UC_STAT_COUNT(CounterFormatRetry);
+    std::string result;
+    for(std::size_t capacity = sizeof(local) * 2; len == FormatFailed; capacity *= 2)
+    {
+        result.resize(capacity);
+        len = write(&result[0],capacity);
     }
+    result.resize(len);
+    return result;
+}
 
-    return ValuePack(value,ratio,unit);
+///生成"数值 单位"形式的字符串
+static std::string valueString(const ValuePack& pack,const NumberFormat& fmt)
+{
+    return writeString([&](char* buffer,std::size_t size){ return formatValue(pack,buffer,size,fmt); });
 }
 
-const UnitProperty UnitConvertor::generateUnitProperty(DecimalUnit unit) noexcept
+UnitProperty UnitConvertor::Detail::registeredUnitProperty(DecimalUnit unit) noexcept
 {
-    switch (unit)
-    {
-    case Freq:return UnitProperty{Giga,One,Freq,1000} ;break;
-    case Time:return UnitProperty{One,Nano,Time,1000} ;break;
-    case Ampl:return UnitProperty{Kilo,Micro,Ampl,1000} ;break;
-    case Voltage:return UnitProperty{Kilo,Micro,Voltage,1000} ;break;
-    case Current:return UnitProperty{Kilo,Micro,Current,1000} ;break;
-    case Phase:return UnitProperty{One,One,Phase,1000} ;break;
-    case SampRate:return UnitProperty{Giga,One,SampRate,1000} ;break;
-    case VolArea:return UnitProperty{Giga,One,VolArea,1000} ;break;
-    case Percent:return UnitProperty{One,One,Percent,1} ;break;
-    default:return UnitProperty{} ;
-    }
+    const UnitSnapshot* units = currentUnits();
+    if(units != nullptr && units->contains(unit))
+        return units->properties[unit];
+    return UnitProperty{};
 }
 
-DecimalRatio UnitConvertor::limitRatio(DecimalUnit unit, DecimalRatio ratio)
+double UnitConvertor::Detail::registeredRatioFactor(DecimalUnit unit, int diff) noexcept
 {
-    UnitProperty p = UnitConvertor::generateUnitProperty(unit);
-    ratio = std::min(p.maxRatio,ratio);
-    ratio = std::max(p.minRatio,ratio);
-    return ratio;
+    const UnitSnapshot* units = currentUnits();
+    if(units != nullptr && units->contains(unit))
+        return units->factors[unit][diff + RatioNum - 1];
+    return RatioFactors.factor[Null][diff + RatioNum - 1];
 }
 
-ValuePack UnitConvertor::fromString(const std::string &target,DecimalUnit unit)
+///注册单位时使用的锁和字符串存储,与进程同生命周期(不析构,退出时其他线程可能还在读取快照)
+struct UnitRegistry
 {
-    std::string valueStr = "0";
-    std::string ratioStr;
-    std::string unitStr;
+    std::mutex mutex;
+    std::deque<std::string> names;      //快照中的单位字符串指向这里,deque添加元素时已有元素的地址不变
+    std::vector<std::unique_ptr<const UnitSnapshot>> snapshots;
+};
 
-    const char* begin = target.data();
-    const char* end = begin + target.length();
+static UnitRegistry& unitRegistry()
+{
+    static UnitRegistry* registry = new UnitRegistry;
+    return *registry;
+}
 
-    //先查找数字对应的字符串,允许查找结果为空,查找失败时字符串会保持为空
-    const std::regex& decimalReg = decimalRegex();
-    std::cregex_iterator decimalBeg(begin,end,decimalReg);
-    std::cregex_iterator decimalEnd;
-    if(std::distance(decimalBeg,decimalEnd) == 1)//如果查找到的数字字符串不等于1(多余或者少于1都认为是错误的,此时让值保持为默认值0)
-    {
-        valueStr = decimalBeg->str();
-        begin += decimalBeg->str().length();//移动指针缩小查找范围
-    }
+DecimalUnit UnitConvertor::registerUnit(std::string_view name, DecimalRatio minRatio, DecimalRatio maxRatio, double exp)
+{
+    if(name.empty() || std::any_of(name.begin(),name.end(),[](char c){ return isDigit(c) || c == ' ' || c == '\t' || c == '\r' || c == '\n'; }))
+        throw std::invalid_argument("UnitConvertor::registerUnit: invalid unit name");
+    if(minRatio < Nano || maxRatio >= RatioNum || minRatio > maxRatio || !(exp > 0) || !std::isfinite(exp))
+        throw std::invalid_argument("UnitConvertor::registerUnit: invalid ratio range or exp");
+
+    UnitRegistry& registry = unitRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if(findUnit(name) != UnitNum)
+        throw std::invalid_argument("UnitConvertor::registerUnit: unit already exists");
 
-    //再查找单位对应的字符串
-    if(std::abs(unit) < DecimalUnit::UnitNum)//避免传入的值超出枚举范围,使用static_cast是有可能的
+    const UnitSnapshot* old = currentUnits();
+    std::unique_ptr<UnitSnapshot> snapshot(new UnitSnapshot);
+    if(old != nullptr)
     {
-        unitStr = DecimalUnitString[unit];
+        *snapshot = *old;
     }
     else
     {
-        const std::regex& unitReg = unitRegex();
-        std::cregex_iterator unitBeg(begin,end,unitReg);
-        std::cregex_iterator unitEnd;
-        if(std::distance(unitBeg,unitEnd) == 1)//如果查找到的数字字符串不等于1(多余或者少于1都认为是错误的,此时让值保持为默认值0)
+        for(int unit = 0; unit <= UnitNum; unit++)
         {
-            unitStr = unitBeg->str();
-            end -= unitBeg->str().length();//再次缩写查找范围
+            const bool builtin = unit < UnitNum;
+            snapshot->properties.push_back(builtin ? UnitPropertyTable[unit] : UnitProperty{});
+            snapshot->names.push_back(builtin ? DecimalUnitString[unit] : std::string_view());
+            std::array<double,2 * RatioNum - 1> factors;
+            for(int diff = 1 - RatioNum; diff < RatioNum; diff++)
+                factors[diff + RatioNum - 1] = std::pow(snapshot->properties.back().Exp,diff);
+            snapshot->factors.push_back(factors);
         }
     }
+    if(snapshot->count > 255)
+        throw std::length_error("UnitConvertor::registerUnit: too many units");
+
+    const DecimalUnit unit = static_cast<DecimalUnit>(snapshot->count++);
+    registry.names.emplace_back(name);
+    snapshot->names.push_back(registry.names.back());
+    snapshot->properties.push_back(UnitProperty{maxRatio,minRatio,unit,exp});
+    std::array<double,2 * RatioNum - 1> factors;
+    for(int diff = 1 - RatioNum; diff < RatioNum; diff++)
+        factors[diff + RatioNum - 1] = std::pow(exp,diff);
+    snapshot->factors.push_back(factors);
+    snapshot->buildIndex();
+
+    CurrentUnits.store(snapshot.get(),std::memory_order_release);
+    registry.snapshots.push_back(std::move(snapshot));
+    return unit;
+}
+
+DecimalUnit UnitConvertor::findUnit(std::string_view name) noexcept
+{
+    for(int unit = 0; unit < UnitNum; unit++)
+        if(equalsIgnoreCase(name,DecimalUnitString[unit]))
+            return static_cast<DecimalUnit>(unit);
+    if(const UnitSnapshot* units = currentUnits())
+        for(std::size_t unit = UnitNum + 1; unit < units->count; unit++)
+            if(equalsIgnoreCase(name,units->names[unit]))
+                return static_cast<DecimalUnit>(unit);
+    return UnitNum;
+}
+
+std::string_view UnitConvertor::unitName(DecimalUnit unit) noexcept
+{
+    if(unit < UnitNum)
+        return DecimalUnitString[unit];
+    const UnitSnapshot* units = currentUnits();
+    if(units != nullptr && units->contains(unit))
+        return units->names[unit];
+    return std::string_view();
+}
 
-    const std::regex& ratioReg = ratioRegex();
-    std::cregex_iterator ratioBeg(begin,end,ratioReg);
-    std::cregex_iterator ratioEnd;
-    if(std::distance(ratioBeg,ratioEnd) == 1)//如果查找到的数字字符串不等于1(多余或者少于1都认为是错误的,此时让值保持为默认值0)
+std::size_t UnitConvertor::unitCount() noexcept
+{
+    const UnitSnapshot* units = currentUnits();
+    return units != nullptr ? units->count : UnitNum + 1;
+}
+
+ValuePack UnitConvertor::fromString(const std::string &target,DecimalUnit unit)
+{
+    UC_STAT_TIMER(TimerParse);
+    const char* begin = target.data();
+    ScanResult result = scanString(begin,begin + target.length(),unit);
+    UC_STAT_PARSE_FLAGS(result.flags);
+    if(result.flags & ParseValueOutOfRange)
     {
-        ratioStr = ratioBeg->str();
+        UC_STAT_COUNT(CounterOutOfRangeThrown);
+        throw std::out_of_range("UnitConvertor::fromString");
     }
 
-    //最后将查找到的三个字符串转换为数据包
-    return generateValuePack(valueStr,ratioStr,unitStr);
+    return ValuePack(result.value,result.ratio,result.unit);
 }
 
-ValuePack UnitConvertor::ratioTo(ValuePack pack, DecimalRatio newRatio)
+ParseResult UnitConvertor::tryFromString(std::string_view target, DecimalUnit unit) noexcept
 {
-    newRatio = limitRatio(pack.unit(),newRatio);
+    UC_STAT_TIMER(TimerParse);
+    const char* begin = target.data();
+    const char* end = begin + target.size();
+    ScanResult result = scanString(begin,end,unit);
+    checkUnexpectedText(begin,end,unit,result);
+    UC_STAT_PARSE_FLAGS(result.flags);
 
-    double value = pack.value() * std::pow(pack.property().Exp , pack.ratio() - newRatio);
-    return ValuePack(value,newRatio,pack.property().unit);
+    ParseResult parsed;
+    parsed.pack = ValuePack(result.value,result.ratio,result.unit);
+    parsed.error = result.error;
+    parsed.flags = result.flags;
+    parsed.offset = result.errorPos == nullptr ? 0 : static_cast<std::size_t>(result.errorPos - begin);
+    return parsed;
+}
+
+std::size_t UnitConvertor::fromStrings(const std::string_view *targets, std::size_t count, double *values, std::uint8_t *ratios, std::uint8_t *units, std::uint8_t *flags, DecimalUnit unit) noexcept
+{
+    UC_STAT_TIMER(TimerParseBatch);
+    std::size_t errors = 0;
+    for(std::size_t i = 0; i < count; i++)
+    {
+        const char* begin = targets[i].data();
+        const char* end = begin + targets[i].size();
+        ScanResult result = scanString(begin,end,unit);
+        checkUnexpectedText(begin,end,unit,result);
+        UC_STAT_PARSE_FLAGS(result.flags);
+        values[i] = result.value;
+        ratios[i] = static_cast<std::uint8_t>(limitRatio(result.unit,result.ratio));//与ValuePack的构造函数保持一致
+        units[i] = static_cast<std::uint8_t>(result.unit);
+        flags[i] = result.flags;
+        errors += result.flags != ParseOk;
+    }
+    return errors;
+}
+
+std::size_t UnitConvertor::fromStrings(const std::string_view *targets, std::size_t count, ValueColumn &column, DecimalUnit unit)
+{
+    column.resize(count);
+    return fromStrings(targets,count,column.values.data(),column.ratios.data(),column.units.data(),column.flags.data(),unit);
 }
 
 ValuePack UnitConvertor::ratioTo(const std::string &str, DecimalRatio newRatio)
@@ -256,211 +753,745 @@ ValuePack UnitConvertor::ratioTo(const std::string &str, DecimalRatio newRatio)
     return UnitConvertor::ratioTo(pack,newRatio);
 }
 
-ValuePack UnitConvertor::proper(ValuePack pack)
+ValuePack UnitConvertor::proper(const std::string &str)
+{
+    ValuePack pack = UnitConvertor::fromString(str);
+    return proper(pack);
+}
+
+///数组转换函数使用的指令集,运行时根据CPU选择
+enum SimdLevel{SimdScalar,SimdSse2,SimdAvx2,SimdAvx512};
+
+static SimdLevel detectSimdLevel() noexcept
+{
+#if UC_SIMD_X86 && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info,0);
+    if(info[0] < 7)
+        return SimdSse2;
+    __cpuid(info,1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(info,7,0);
+    if((xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)))
+        return SimdAvx512;
+    if((xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)))
+        return SimdAvx2;
+    return SimdSse2;
+#elif UC_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return SimdAvx512;
+    if(__builtin_cpu_supports("avx2"))
+        return SimdAvx2;
+    if(__builtin_cpu_supports("sse2"))
+        return SimdSse2;
+    return SimdScalar;
+#else
+    return SimdScalar;
+#endif
+}
+
+static SimdLevel simdLevel() noexcept
+{
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+///数组中每个元素乘以同一个系数
+static void scaleScalar(double* values,std::size_t count,double factor) noexcept
 {
-    if(pack.value() == 0)
-        return pack;
+    for(std::size_t i = 0; i < count; i++)
+        values[i] *= factor;
+}
+
+///数组中每个元素乘以按照自身数量级查表得到的系数,factors的下标为数量级
+static void scaleEachScalar(double* values,const std::uint8_t* ratios,std::size_t count,const double* factors) noexcept
+{
+    for(std::size_t i = 0; i < count; i++)
+        values[i] *= factors[ratios[i]];
+}
 
-    if(std::abs(pack.value()) > 1000)
+///数组中每个元素调整到恰当的数量级
+static void properScalar(double* values,std::uint8_t* ratios,std::size_t count,const UnitProperty& p) noexcept
+{
+    for(std::size_t i = 0; i < count; i++)
     {
-        if(pack.ratio() == Uc::Giga)//已经到达最大数量级单位就返回
-            return pack;
-        else
-            return proper( ValuePack(pack.value()/pack.property().Exp, DecimalRatio(pack.ratio() + 1), pack.property().unit) );
+        int ratio = ratios[i];
+        properValue(values[i],ratio,p);
+        ratios[i] = static_cast<std::uint8_t>(ratio);
     }
-    else if(std::abs(pack.value()) < 1)
+}
+
+///统计一块数据:第一次遍历求个数、和、最小值、最大值,第二次遍历求与均值之差的平方和,NaN不参与统计
+static ColumnSummary summarizeScalar(const double* values,std::size_t count,double factor) noexcept
+{
+    ColumnSummary s;
+    for(std::size_t i = 0; i < count; i++)
     {
-        if(pack.ratio() == Uc::Nano)//已经到达最小数量级单位就返回
-            return pack;
-        else
-            return proper( ValuePack(pack.value()*pack.property().Exp, DecimalRatio(pack.ratio() - 1), pack.property().unit) );
+        const double x = values[i] * factor;
+        if(std::isnan(x))
+            continue;
+        ++s.count;
+        s.sum += x;
+        s.min = std::min(s.min,x);
+        s.max = std::max(s.max,x);
     }
-    else
-        return pack;
+    if(s.count == 0)
+        return s;
+    s.mean = s.sum / static_cast<double>(s.count);
+    for(std::size_t i = 0; i < count; i++)
+    {
+        const double x = values[i] * factor;
+        if(!std::isnan(x))
+            s.m2 += (x - s.mean) * (x - s.mean);
+    }
+    return s;
 }
 
-ValuePack UnitConvertor::proper(const std::string &str)
+///把向量各通道的第一次遍历结果合并到s中
+static void reduceLanes(ColumnSummary& s,const double* count,const double* sum,const double* lo,const double* hi,int lanes) noexcept
 {
-    ValuePack pack = UnitConvertor::fromString(str);
-    return proper(pack);
+    for(int lane = 0; lane < lanes; lane++)
+    {
+        s.count += static_cast<std::size_t>(count[lane]);
+        s.sum += sum[lane];
+        s.min = std::min(s.min,lo[lane]);
+        s.max = std::max(s.max,hi[lane]);
+    }
 }
 
-std::string UnitConvertor::numericPart(const ValuePack &pack)
+#if UC_SIMD_X86
+UC_TARGET("sse2") static void scaleSse2(double* values,std::size_t count,double factor) noexcept
 {
-    std::ostringstream oss;
-    oss  <<std::fixed << pack.value();
-    std::string s = std::regex_replace(oss.str(),fractionalRegex(),"");
-    return s;
+    const __m128d k = _mm_set1_pd(factor);
+    std::size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+        _mm_storeu_pd(values + i,_mm_mul_pd(_mm_loadu_pd(values + i),k));
+    scaleScalar(values + i,count - i,factor);
 }
 
-std::string UnitConvertor::unitPart(const ValuePack &pack)
+UC_TARGET("avx2") static void scaleAvx2(double* values,std::size_t count,double factor) noexcept
 {
-    return UnitConvertor::DecimalRatioString[pack.ratio()] + UnitConvertor::DecimalUnitString[pack.property().unit];
+    const __m256d k = _mm256_set1_pd(factor);
+    std::size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+        _mm256_storeu_pd(values + i,_mm256_mul_pd(_mm256_loadu_pd(values + i),k));
+    //与properAvx2相同,调用SSE编码的标量实现之前清除YMM寄存器的高位
+    _mm256_zeroupper();
+    scaleScalar(values + i,count - i,factor);
 }
 
-std::string UnitConvertor::toString(const ValuePack &pack)
+UC_TARGET("avx512f") static void scaleAvx512(double* values,std::size_t count,double factor) noexcept
 {
-    std::ostringstream oss;
-    oss  <<std::fixed << pack.value();
-    std::string s = std::regex_replace(oss.str(),fractionalRegex(),"");
-    return s + " " + UnitConvertor::DecimalRatioString[pack.ratio()] + UnitConvertor::DecimalUnitString[pack.property().unit];
+    const __m512d k = _mm512_set1_pd(factor);
+    std::size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+        _mm512_storeu_pd(values + i,_mm512_mul_pd(_mm512_loadu_pd(values + i),k));
+    _mm256_zeroupper();
+    scaleScalar(values + i,count - i,factor);
 }
 
-std::string UnitConvertor::toFormatString(const ValuePack &pack, int precision,bool fixedDecimal )
+UC_TARGET("sse2") static void scaleEachSse2(double* values,const std::uint8_t* ratios,std::size_t count,const double* factors) noexcept
 {
-    std::ostringstream oss;
-    if(fixedDecimal)
-        oss << std::fixed << std::setprecision(precision) << pack.value();
-    else
-        oss << std::setprecision(precision) << pack.value();
-    std::string s = std::regex_replace(oss.str(),fractionalRegex(),"");
-   return s + " " + UnitConvertor::DecimalRatioString[pack.ratio()] + UnitConvertor::DecimalUnitString[pack.property().unit];
+    std::size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const __m128d k = _mm_set_pd(factors[ratios[i + 1]],factors[ratios[i]]);
+        _mm_storeu_pd(values + i,_mm_mul_pd(_mm_loadu_pd(values + i),k));
+    }
+    scaleEachScalar(values + i,ratios + i,count - i,factors);
 }
 
-std::string UnitConvertor::toFormatString(const ValuePack &pack, int totalLeng, int decimalLen, char fill)
+UC_TARGET("avx2") static void scaleEachAvx2(double* values,const std::uint8_t* ratios,std::size_t count,const double* factors) noexcept
 {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(decimalLen) << std::setw(totalLeng) << std::setfill(fill) << pack.value();
-    std::string s = std::regex_replace(oss.str(),fractionalRegex(),"");
-    return s + " " + UnitConvertor::DecimalRatioString[pack.ratio()] + UnitConvertor::DecimalUnitString[pack.property().unit];
+    //不带掩码的gather和转换指令以未初始化的寄存器作为源操作数,GCC会报告-Wmaybe-uninitialized,所以统一使用全部通道的掩码和0作为源操作数
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    std::size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        std::int32_t packed;
+        std::memcpy(&packed,ratios + i,sizeof(packed));
+        const __m128i index = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+        const __m256d k = _mm256_mask_i32gather_pd(zero,factors,index,allLanes,8);
+        _mm256_storeu_pd(values + i,_mm256_mul_pd(_mm256_loadu_pd(values + i),k));
+    }
+    _mm256_zeroupper();
+    scaleEachScalar(values + i,ratios + i,count - i,factors);
 }
 
-std::string UnitConvertor::toScientificString(const ValuePack &pack)
+UC_TARGET("avx512f,avx2") static void scaleEachAvx512(double* values,const std::uint8_t* ratios,std::size_t count,const double* factors) noexcept
 {
-    std::ostringstream oss;
-    oss << std::scientific  << pack.value();
-    std::string s = std::regex_replace(oss.str(),scientificRegex(),"e");
-    return s + " " + UnitConvertor::DecimalRatioString[pack.ratio()] + UnitConvertor::DecimalUnitString[pack.property().unit];
+    const __m512d zero = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ratios + i)));
+        const __m512d k = _mm512_mask_i32gather_pd(zero,0xff,index,factors,8);
+        _mm512_storeu_pd(values + i,_mm512_mul_pd(_mm512_loadu_pd(values + i),k));
+    }
+    _mm256_zeroupper();
+    scaleEachScalar(values + i,ratios + i,count - i,factors);
 }
 
-std::string UnitConvertor::toScientificString(const ValuePack &pack, int precision)
+UC_TARGET("sse2") static void properSse2(double* values,std::uint8_t* ratios,std::size_t count,const UnitProperty& p) noexcept
 {
-    std::ostringstream oss;
-    oss << std::scientific  << std::setprecision(precision) << pack.value();
-    std::string s = std::regex_replace(oss.str(),scientificRegex(),"e");
-    return s + " " + UnitConvertor::DecimalRatioString[pack.ratio()] + UnitConvertor::DecimalUnitString[pack.property().unit];
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    const __m128d upper = _mm_set1_pd(1000);
+    const __m128d lower = _mm_set1_pd(1);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1);
+    const __m128d exp = _mm_set1_pd(p.Exp);
+    const __m128d maxRatio = _mm_set1_pd(p.maxRatio);
+    const __m128d minRatio = _mm_set1_pd(p.minRatio);
+
+    std::size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128d v = _mm_loadu_pd(values + i);
+        __m128d r = _mm_set_pd(ratios[i + 1],ratios[i]);
+        for(int step = 1; step < RatioNum; step++)
+        {
+            const __m128d up = _mm_and_pd(_mm_cmpgt_pd(_mm_andnot_pd(signMask,v),upper),_mm_cmplt_pd(r,maxRatio));
+            if(_mm_movemask_pd(up) == 0)
+                break;
+            v = _mm_or_pd(_mm_and_pd(up,_mm_div_pd(v,exp)),_mm_andnot_pd(up,v));
+            r = _mm_add_pd(r,_mm_and_pd(up,one));
+        }
+        for(int step = 1; step < RatioNum; step++)
+        {
+            const __m128d a = _mm_andnot_pd(signMask,v);
+            const __m128d down = _mm_and_pd(_mm_and_pd(_mm_cmplt_pd(a,lower),_mm_cmpgt_pd(a,zero)),_mm_cmpgt_pd(r,minRatio));
+            if(_mm_movemask_pd(down) == 0)
+                break;
+            v = _mm_or_pd(_mm_and_pd(down,_mm_mul_pd(v,exp)),_mm_andnot_pd(down,v));
+            r = _mm_sub_pd(r,_mm_and_pd(down,one));
+        }
+        _mm_storeu_pd(values + i,v);
+        double newRatio[2];
+        _mm_storeu_pd(newRatio,r);
+        ratios[i] = static_cast<std::uint8_t>(newRatio[0]);
+        ratios[i + 1] = static_cast<std::uint8_t>(newRatio[1]);
+    }
+    properScalar(values + i,ratios + i,count - i,p);
 }
-long long UnitConvertor::toInt(const ValuePack& pack)
+
+UC_TARGET("avx2") static void properAvx2(double* values,std::uint8_t* ratios,std::size_t count,const UnitProperty& p) noexcept
 {
-    return std::llround(pack.value());
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256d upper = _mm256_set1_pd(1000);
+    const __m256d lower = _mm256_set1_pd(1);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1);
+    const __m256d exp = _mm256_set1_pd(p.Exp);
+    const __m256d maxRatio = _mm256_set1_pd(p.maxRatio);
+    const __m256d minRatio = _mm256_set1_pd(p.minRatio);
+
+    std::size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        std::int32_t packed;
+        std::memcpy(&packed,ratios + i,sizeof(packed));
+        __m256d v = _mm256_loadu_pd(values + i);
+        __m256d r = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+        for(int step = 1; step < RatioNum; step++)
+        {
+            const __m256d up = _mm256_and_pd(_mm256_cmp_pd(_mm256_andnot_pd(signMask,v),upper,_CMP_GT_OQ),_mm256_cmp_pd(r,maxRatio,_CMP_LT_OQ));
+            if(_mm256_movemask_pd(up) == 0)
+                break;
+            v = _mm256_blendv_pd(v,_mm256_div_pd(v,exp),up);
+            r = _mm256_add_pd(r,_mm256_and_pd(up,one));
+        }
+        for(int step = 1; step < RatioNum; step++)
+        {
+            const __m256d a = _mm256_andnot_pd(signMask,v);
+            const __m256d down = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(a,lower,_CMP_LT_OQ),_mm256_cmp_pd(a,zero,_CMP_GT_OQ)),_mm256_cmp_pd(r,minRatio,_CMP_GT_OQ));
+            if(_mm256_movemask_pd(down) == 0)
+                break;
+            v = _mm256_blendv_pd(v,_mm256_mul_pd(v,exp),down);
+            r = _mm256_sub_pd(r,_mm256_and_pd(down,one));
+        }
+        _mm256_storeu_pd(values + i,v);
+        const __m128i r32 = _mm256_cvttpd_epi32(r);
+        packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(r32,r32),_mm_setzero_si128()));
+        std::memcpy(ratios + i,&packed,sizeof(packed));
+    }
+    //尾部交给SSE编码的标量实现,编译器在尾调用前没有插入vzeroupper,需要手动清除,否则之后的SSE指令都会变慢
+    _mm256_zeroupper();
+    properScalar(values + i,ratios + i,count - i,p);
+}
+
+UC_TARGET("avx512f,avx2") static void properAvx512(double* values,std::uint8_t* ratios,std::size_t count,const UnitProperty& p) noexcept
+{
+    //与scaleEachAvx2相同,转换指令使用全部通道的掩码,避免以未初始化的寄存器作为源操作数
+    const __m512d upper = _mm512_set1_pd(1000);
+    const __m512d lower = _mm512_set1_pd(1);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1);
+    const __m512d exp = _mm512_set1_pd(p.Exp);
+    const __m512d maxRatio = _mm512_set1_pd(p.maxRatio);
+    const __m512d minRatio = _mm512_set1_pd(p.minRatio);
+
+    std::size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512d v = _mm512_loadu_pd(values + i);
+        __m512d r = _mm512_maskz_cvtepi32_pd(0xff,_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ratios + i))));
+        for(int step = 1; step < RatioNum; step++)
+        {
+            const __mmask8 up = _mm512_cmp_pd_mask(_mm512_abs_pd(v),upper,_CMP_GT_OQ) & _mm512_cmp_pd_mask(r,maxRatio,_CMP_LT_OQ);
+            if(up == 0)
+                break;
+            v = _mm512_mask_div_pd(v,up,v,exp);
+            r = _mm512_mask_add_pd(r,up,r,one);
+        }
+        for(int step = 1; step < RatioNum; step++)
+        {
+            const __m512d a = _mm512_abs_pd(v);
+            const __mmask8 down = _mm512_cmp_pd_mask(a,lower,_CMP_LT_OQ) & _mm512_cmp_pd_mask(a,zero,_CMP_GT_OQ) & _mm512_cmp_pd_mask(r,minRatio,_CMP_GT_OQ);
+            if(down == 0)
+                break;
+            v = _mm512_mask_mul_pd(v,down,v,exp);
+            r = _mm512_mask_sub_pd(r,down,r,one);
+        }
+        _mm512_storeu_pd(values + i,v);
+        std::int32_t newRatio[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(newRatio),_mm512_maskz_cvttpd_epi32(0xff,r));
+        for(int lane = 0; lane < 8; lane++)
+            ratios[i + lane] = static_cast<std::uint8_t>(newRatio[lane]);
+    }
+    _mm256_zeroupper();
+    properScalar(values + i,ratios + i,count - i,p);
+}
+
+UC_TARGET("sse2") static ColumnSummary summarizeSse2(const double* values,std::size_t count,double factor) noexcept
+{
+    const __m128d k = _mm_set1_pd(factor);
+    const __m128d one = _mm_set1_pd(1);
+    const __m128d inf = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    const __m128d negInf = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+    __m128d n = _mm_setzero_pd();
+    __m128d sum = _mm_setzero_pd();
+    __m128d lo = inf;
+    __m128d hi = negInf;
+    std::size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const __m128d x = _mm_mul_pd(_mm_loadu_pd(values + i),k);
+        const __m128d valid = _mm_cmpord_pd(x,x);
+        n = _mm_add_pd(n,_mm_and_pd(one,valid));
+        sum = _mm_add_pd(sum,_mm_and_pd(x,valid));
+        lo = _mm_min_pd(lo,_mm_or_pd(_mm_and_pd(valid,x),_mm_andnot_pd(valid,inf)));
+        hi = _mm_max_pd(hi,_mm_or_pd(_mm_and_pd(valid,x),_mm_andnot_pd(valid,negInf)));
+    }
+    ColumnSummary s = summarizeScalar(values + i,count - i,factor);
+    double lanes[4][2];
+    _mm_storeu_pd(lanes[0],n);
+    _mm_storeu_pd(lanes[1],sum);
+    _mm_storeu_pd(lanes[2],lo);
+    _mm_storeu_pd(lanes[3],hi);
+    reduceLanes(s,lanes[0],lanes[1],lanes[2],lanes[3],2);
+    if(s.count == 0)
+        return s;
+
+    s.mean = s.sum / static_cast<double>(s.count);
+    const __m128d mean = _mm_set1_pd(s.mean);
+    __m128d m2 = _mm_setzero_pd();
+    for(i = 0; i + 2 <= count; i += 2)
+    {
+        const __m128d x = _mm_mul_pd(_mm_loadu_pd(values + i),k);
+        const __m128d d = _mm_and_pd(_mm_sub_pd(x,mean),_mm_cmpord_pd(x,x));
+        m2 = _mm_add_pd(m2,_mm_mul_pd(d,d));
+    }
+    double m2Lanes[2];
+    _mm_storeu_pd(m2Lanes,m2);
+    s.m2 = m2Lanes[0] + m2Lanes[1];
+    for(; i < count; i++)
+    {
+        const double x = values[i] * factor;
+        if(!std::isnan(x))
+            s.m2 += (x - s.mean) * (x - s.mean);
+    }
+    return s;
+}
+
+UC_TARGET("avx2") static ColumnSummary summarizeAvx2(const double* values,std::size_t count,double factor) noexcept
+{
+    const __m256d k = _mm256_set1_pd(factor);
+    const __m256d one = _mm256_set1_pd(1);
+    const __m256d inf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    const __m256d negInf = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    __m256d n = _mm256_setzero_pd();
+    __m256d sum = _mm256_setzero_pd();
+    __m256d lo = inf;
+    __m256d hi = negInf;
+    std::size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m256d x = _mm256_mul_pd(_mm256_loadu_pd(values + i),k);
+        const __m256d valid = _mm256_cmp_pd(x,x,_CMP_ORD_Q);
+        n = _mm256_add_pd(n,_mm256_and_pd(one,valid));
+        sum = _mm256_add_pd(sum,_mm256_and_pd(x,valid));
+        lo = _mm256_min_pd(lo,_mm256_blendv_pd(inf,x,valid));
+        hi = _mm256_max_pd(hi,_mm256_blendv_pd(negInf,x,valid));
+    }
+    double lanes[4][4];
+    _mm256_storeu_pd(lanes[0],n);
+    _mm256_storeu_pd(lanes[1],sum);
+    _mm256_storeu_pd(lanes[2],lo);
+    _mm256_storeu_pd(lanes[3],hi);
+    const std::size_t body = i;
+    //与properAvx2相同,调用SSE编码的标量实现之前清除YMM寄存器的高位
+    _mm256_zeroupper();
+    ColumnSummary s = summarizeScalar(values + body,count - body,factor);
+    reduceLanes(s,lanes[0],lanes[1],lanes[2],lanes[3],4);
+    if(s.count == 0)
+        return s;
+
+    s.mean = s.sum / static_cast<double>(s.count);
+    const __m256d mean = _mm256_set1_pd(s.mean);
+    __m256d m2 = _mm256_setzero_pd();
+    for(i = 0; i < body; i += 4)
+    {
+        const __m256d x = _mm256_mul_pd(_mm256_loadu_pd(values + i),k);
+        const __m256d d = _mm256_and_pd(_mm256_sub_pd(x,mean),_mm256_cmp_pd(x,x,_CMP_ORD_Q));
+        m2 = _mm256_add_pd(m2,_mm256_mul_pd(d,d));
+    }
+    double m2Lanes[4];
+    _mm256_storeu_pd(m2Lanes,m2);
+    _mm256_zeroupper();
+    s.m2 = (m2Lanes[0] + m2Lanes[1]) + (m2Lanes[2] + m2Lanes[3]);
+    for(; i < count; i++)
+    {
+        const double x = values[i] * factor;
+        if(!std::isnan(x))
+            s.m2 += (x - s.mean) * (x - s.mean);
+    }
+    return s;
 }
+#endif
 
-ValuePack::ValuePack(){}
+DecimalRatio UnitConvertor::ratioTo(double *values, std::size_t count, DecimalUnit unit, DecimalRatio ratio, DecimalRatio newRatio) noexcept
+{
+    UC_STAT_TIMER(TimerRatioToBatch);
+    newRatio = limitRatio(unit,newRatio);
+    const double factor = ratioFactor(unit,ratio,newRatio);
+    switch (simdLevel())
+    {
+#if UC_SIMD_X86
+    case SimdAvx512:scaleAvx512(values,count,factor);break;
+    case SimdAvx2:scaleAvx2(values,count,factor);break;
+    case SimdSse2:scaleSse2(values,count,factor);break;
+#endif
+    default:scaleScalar(values,count,factor);break;
+    }
+    return newRatio;
+}
 
-ValuePack::ValuePack(double value, UnitConvertor::DecimalRatio ratio, UnitConvertor::DecimalUnit unit)
+void UnitConvertor::ratioTo(double *values, std::uint8_t *ratios, std::size_t count, DecimalUnit unit, DecimalRatio newRatio) noexcept
 {
-    this->m_Value = value;
-    this->m_Ratio = UnitConvertor::limitRatio(unit,ratio);
-    this->m_Property = UnitConvertor::generateUnitProperty(unit);
+    UC_STAT_TIMER(TimerRatioToBatch);
+    newRatio = limitRatio(unit,newRatio);
+    double factors[RatioNum];
+    for(int ratio = 0; ratio < RatioNum; ratio++)
+        factors[ratio] = ratioFactor(unit,ratio,newRatio);
+
+    switch (simdLevel())
+    {
+#if UC_SIMD_X86
+    case SimdAvx512:scaleEachAvx512(values,ratios,count,factors);break;
+    case SimdAvx2:scaleEachAvx2(values,ratios,count,factors);break;
+    case SimdSse2:scaleEachSse2(values,ratios,count,factors);break;
+#endif
+    default:scaleEachScalar(values,ratios,count,factors);break;
+    }
+    std::fill_n(ratios,count,static_cast<std::uint8_t>(newRatio));
 }
 
-ValuePack ValuePack::operator +(const ValuePack &pack) const noexcept
+void UnitConvertor::proper(double *values, std::uint8_t *ratios, std::size_t count, DecimalUnit unit) noexcept
 {
-    ValuePack tmpPack{};
-    if(pack.m_Property.unit == this->m_Property.unit)
+    UC_STAT_TIMER(TimerProperBatch);
+    const UnitProperty p = generateUnitProperty(unit);
+    switch (simdLevel())
     {
-        tmpPack = UnitConvertor::ratioTo(pack,this->m_Ratio);
-        return ValuePack(this->m_Value + tmpPack.m_Value,this->m_Ratio,this->m_Property.unit);
+#if UC_SIMD_X86
+    case SimdAvx512:properAvx512(values,ratios,count,p);break;
+    case SimdAvx2:properAvx2(values,ratios,count,p);break;
+    case SimdSse2:properSse2(values,ratios,count,p);break;
+#endif
+    default:properScalar(values,ratios,count,p);break;
     }
-    return tmpPack;
 }
 
-ValuePack ValuePack::operator - (const ValuePack &pack) const noexcept
+///对column中单位相同的每一段连续元素调用func(起始下标,元素个数,单位)
+template<typename Func>
+static void forEachUnitRun(const ValueColumn& column,Func func)
 {
-    ValuePack tmpPack{};
-    if(pack.m_Property.unit == this->m_Property.unit)
+    const std::size_t count = column.size();
+    for(std::size_t begin = 0; begin < count;)
     {
-        tmpPack = UnitConvertor::ratioTo(pack,this->m_Ratio);
-        return ValuePack(this->m_Value - tmpPack.m_Value,this->m_Ratio,this->m_Property.unit);
+        std::size_t end = begin + 1;
+        while(end < count && column.units[end] == column.units[begin])
+            ++end;
+        func(begin,end - begin,static_cast<DecimalUnit>(column.units[begin]));
+        begin = end;
     }
-    return tmpPack;
 }
 
-bool ValuePack::operator == (const ValuePack &other) const
+void UnitConvertor::ratioTo(ValueColumn &column, DecimalRatio newRatio) noexcept
 {
-    return std::abs(this->m_Value - other.m_Value) < 1e-10
-           &&this->m_Ratio == other.m_Ratio
-           && this->m_Property.unit == other.m_Property.unit;
+    forEachUnitRun(column,[&](std::size_t begin,std::size_t count,DecimalUnit unit){
+        ratioTo(column.values.data() + begin,column.ratios.data() + begin,count,unit,newRatio);
+    });
 }
 
-bool ValuePack::operator != (const ValuePack &other) const
+void UnitConvertor::proper(ValueColumn &column) noexcept
 {
-    return !(*this == other);
+    forEachUnitRun(column,[&](std::size_t begin,std::size_t count,DecimalUnit unit){
+        proper(column.values.data() + begin,column.ratios.data() + begin,count,unit);
+    });
 }
 
-bool ValuePack::operator > (const ValuePack &other) const noexcept
+///补偿求和(Neumaier):sum + compensation保存的总和比直接相加多出大约一倍的有效位数
+static inline void compensatedAdd(double& sum,double& compensation,double value) noexcept
 {
-    if(this->unit() == other.unit())
-        return !(*this <= other);
+    const double t = sum + value;
+    if(std::abs(sum) >= std::abs(value))
+        compensation += (sum - t) + value;
     else
-        return false;
+        compensation += (value - t) + sum;
+    sum = t;
 }
 
-bool ValuePack::operator < (const ValuePack &other) const noexcept
+void ColumnSummary::add(double value) noexcept
 {
-    if(this->unit() == other.unit())
-        return !(*this >= other);
-    else
-        return false;
+    if(std::isnan(value))
+        return;
+    ++count;
+    const double delta = value - mean;
+    mean += delta / static_cast<double>(count);
+    m2 += delta * (value - mean);
+    min = std::min(min,value);
+    max = std::max(max,value);
+    compensatedAdd(sum,compensation,value);
 }
 
-bool ValuePack::operator >= (const ValuePack &other) const noexcept
+void ColumnSummary::merge(const ColumnSummary &other) noexcept
 {
-    if(this->unit() == other.unit())
+    if(other.count == 0)
+        return;
+    if(count == 0)
     {
-        if(this->m_Ratio == other.ratio())
-            return this->m_Value >= other.m_Value;
-        else
-            return Uc::ratioTo(*this,Uc::One).m_Value >= Uc::ratioTo(other,Uc::One).m_Value;
+        *this = other;
+        return;
     }
-    return false;
+    const double n = static_cast<double>(count) + static_cast<double>(other.count);
+    const double delta = other.mean - mean;
+    mean += delta * (static_cast<double>(other.count) / n);
+    m2 += other.m2 + delta * delta * (static_cast<double>(count) * static_cast<double>(other.count) / n);
+    min = std::min(min,other.min);
+    max = std::max(max,other.max);
+    compensatedAdd(sum,compensation,other.sum);
+    compensation += other.compensation;
+    count += other.count;
 }
 
-bool ValuePack::operator <= (const ValuePack &other) const noexcept
+ColumnSummary UnitConvertor::summarize(const double *values, std::size_t count, double factor) noexcept
 {
-    if(this->unit() == other.unit())
+    //每块8KB,第二次遍历时数据还在L1缓存中
+    constexpr std::size_t Chunk = 1024;
+    ColumnSummary result;
+    for(std::size_t begin = 0; begin < count; begin += Chunk)
     {
-        if(this->m_Ratio == other.ratio())
-            return this->m_Value <= other.m_Value;
-        else
-            return Uc::ratioTo(*this,Uc::One).m_Value <= Uc::ratioTo(other,Uc::One).m_Value;
+        const std::size_t n = std::min(Chunk,count - begin);
+        switch (simdLevel())
+        {
+#if UC_SIMD_X86
+        case SimdAvx512:        //统计受内存带宽限制,AVX-512没有明显的收益,使用AVX2的实现
+        case SimdAvx2:result.merge(summarizeAvx2(values + begin,n,factor));break;
+        case SimdSse2:result.merge(summarizeSse2(values + begin,n,factor));break;
+#endif
+        default:result.merge(summarizeScalar(values + begin,n,factor));break;
+        }
     }
-    return false;
+    return result;
 }
 
-ValuePack &ValuePack::ratioTo(UnitConvertor::DecimalRatio newRatio)
+std::string UnitConvertor::numericPart(const ValuePack &pack)
 {
-    *this = UnitConvertor::ratioTo(*this,newRatio);
-    return *this;
+    UC_STAT_TIMER(TimerNumericPart);
+    return writeString([&](char* buffer,std::size_t size){ return formatNumber(buffer,size,pack.value(),NumberFormat{}); });
 }
 
-ValuePack &ValuePack::proper()
+std::string UnitConvertor::unitPart(const ValuePack &pack)
 {
-    *this = UnitConvertor::proper(*this);
-    return *this;
+    UC_STAT_TIMER(TimerUnitPart);
+    std::string result(UnitConvertor::DecimalRatioString[pack.ratio()]);
+    result.append(UnitConvertor::unitName(pack.unit()));
+    return result;
 }
 
-void ValuePack::setValue(double value) noexcept
+std::string UnitConvertor::toString(const ValuePack &pack)
 {
-    this->m_Value = value;
+    UC_STAT_TIMER(TimerToString);
+    return valueString(pack,NumberFormat{});
 }
 
-double ValuePack::value() const noexcept
+std::string UnitConvertor::toFormatString(const ValuePack &pack, int precision,bool fixedDecimal )
 {
-    return this->m_Value;
+    UC_STAT_TIMER(TimerToFormatString);
+    return valueString(pack,{fixedDecimal ? std::chars_format::fixed : std::chars_format::general,precision,0,' '});
 }
 
-DecimalRatio ValuePack::ratio() const noexcept
+std::string UnitConvertor::toFormatString(const ValuePack &pack, int totalLeng, int decimalLen, char fill)
 {
-    return this->m_Ratio;
+    UC_STAT_TIMER(TimerToFormatString);
+    return valueString(pack,{std::chars_format::fixed,decimalLen,totalLeng,fill});
 }
 
-DecimalUnit ValuePack::unit() const noexcept
+std::string UnitConvertor::toScientificString(const ValuePack &pack)
 {
-    return this->m_Property.unit;
+    UC_STAT_TIMER(TimerToScientificString);
+    return valueString(pack,{std::chars_format::scientific,6,0,' '});
 }
 
-UnitProperty ValuePack::property() const noexcept
+std::string UnitConvertor::toScientificString(const ValuePack &pack, int precision)
 {
-    return this->m_Property;
+    UC_STAT_TIMER(TimerToScientificString);
+    return valueString(pack,{std::chars_format::scientific,precision,0,' '});
+}
+
+std::size_t UnitConvertor::numericPart(const ValuePack &pack, char *buffer, std::size_t size) noexcept
+{
+    UC_STAT_TIMER(TimerNumericPart);
+    return formatResult(formatNumber(buffer,size,pack.value(),NumberFormat{}));
+}
+
+std::size_t UnitConvertor::unitPart(const ValuePack &pack, char *buffer, std::size_t size) noexcept
+{
+    UC_STAT_TIMER(TimerUnitPart);
+    return formatResult(formatUnit(pack,buffer,size));
+}
+
+std::size_t UnitConvertor::toString(const ValuePack &pack, char *buffer, std::size_t size) noexcept
+{
+    UC_STAT_TIMER(TimerToString);
+    return formatResult(formatValue(pack,buffer,size,NumberFormat{}));
+}
+
+std::size_t UnitConvertor::toFormatString(const ValuePack &pack, char *buffer, std::size_t size, int precision, bool fixedDecimal) noexcept
+{
+    UC_STAT_TIMER(TimerToFormatString);
+    return formatResult(formatValue(pack,buffer,size,{fixedDecimal ? std::chars_format::fixed : std::chars_format::general,precision,0,' '}));
+}
+
+std::size_t UnitConvertor::toFormatString(const ValuePack &pack, char *buffer, std::size_t size, int totalLeng, int decimalLen, char fill) noexcept
+{
+    UC_STAT_TIMER(TimerToFormatString);
+    return formatResult(formatValue(pack,buffer,size,{std::chars_format::fixed,decimalLen,totalLeng,fill}));
+}
+
+std::size_t UnitConvertor::toScientificString(const ValuePack &pack, char *buffer, std::size_t size) noexcept
+{
+    UC_STAT_TIMER(TimerToScientificString);
+    return formatResult(formatValue(pack,buffer,size,{std::chars_format::scientific,6,0,' '}));
+}
+
+std::size_t UnitConvertor::toScientificString(const ValuePack &pack, char *buffer, std::size_t size, int precision) noexcept
+{
+    UC_STAT_TIMER(TimerToScientificString);
+    return formatResult(formatValue(pack,buffer,size,{std::chars_format::scientific,precision,0,' '}));
+}
+
+///按照spec调用对应的内部格式化函数,缓冲区长度不足时返回FormatFailed
+static std::size_t formatSpec(const ValuePack& pack,char* buffer,std::size_t size,const FormatSpec& spec) noexcept
+{
+    switch (spec.mode)
+    {
+    case FormatPrecision:return formatValue(pack,buffer,size,{spec.fixedDecimal ? std::chars_format::fixed : std::chars_format::general,spec.precision,0,' '});
+    case FormatWidth:return formatValue(pack,buffer,size,{std::chars_format::fixed,spec.decimalLen,spec.totalLeng,spec.fill});
+    case FormatScientific:return formatValue(pack,buffer,size,{std::chars_format::scientific,spec.precision,0,' '});
+    case FormatNumericPart:return formatNumber(buffer,size,pack.value(),NumberFormat{});
+    case FormatUnitPart:return formatUnit(pack,buffer,size);
+    default:return formatValue(pack,buffer,size,NumberFormat{});
+    }
+}
+
+///把count个由packAt(i)得到的数据包格式化后追加到out中,直接写入out.buffer的末尾,空间不足时按倍数扩大后重写当前元素
+template<typename PackAt>
+static void appendStrings(std::size_t count,PackAt packAt,TextColumn& out,const FormatSpec& spec,std::string_view separator)
+{
+    UC_STAT_TIMER(TimerFormatBatch);
+    out.offsets.reserve(out.offsets.size() + count);
+    out.lengths.reserve(out.lengths.size() + count);
+
+    std::string& buffer = out.buffer;
+    std::size_t pos = buffer.size();
+    buffer.resize(std::max(buffer.capacity(),pos + count * (24 + separator.size())));   //大多数数值加单位不超过24个字符
+    for(std::size_t i = 0; i < count; i++)
+    {
+        const ValuePack pack = packAt(i);
+        std::size_t len;
+        for(;;)
+        {
+            const std::size_t room = buffer.size() - pos;
+            len = room > separator.size() ? formatSpec(pack,&buffer[pos],room - separator.size(),spec) : FormatFailed;
+            if(len != FormatFailed)
+                break;
+            buffer.resize(std::max<std::size_t>(buffer.size() * 2,pos + separator.size() + 64));
+        }
+        out.offsets.push_back(pos);
+        out.lengths.push_back(len);
+        pos += len;
+        std::memcpy(&buffer[pos],separator.data(),separator.size());
+        pos += separator.size();
+    }
+    buffer.resize(pos);
+}
+
+void UnitConvertor::toStrings(const ValuePack *packs, std::size_t count, TextColumn &out, const FormatSpec &spec, std::string_view separator)
+{
+    appendStrings(count,[packs](std::size_t i){ return packs[i]; },out,spec,separator);
+}
+
+void UnitConvertor::toStrings(const ValueColumn &column, TextColumn &out, const FormatSpec &spec, std::string_view separator)
+{
+    appendStrings(column.size(),[&column](std::size_t i){
+        return ValuePack(column.values[i],static_cast<DecimalRatio>(column.ratios[i]),static_cast<DecimalUnit>(column.units[i]));
+    },out,spec,separator);
+}
+
+long long UnitConvertor::toInt(const ValuePack& pack)
+{
+    return std::llround(pack.value());
+}
+
+void UnitConvertor::warmUp()
+{
+    simdLevel();
+    unitRegistry();
+
+    //解析、数组换算和格式化各执行一次,数组长度足够进入向量化的主循环
+    static constexpr std::string_view Samples[] = {"12.5 kHz","-3.3e-2 mV","1 GSa/s","42"};
+    ValueColumn column;
+    fromStrings(Samples,std::size(Samples),column);
+    fromStrings(Samples,std::size(Samples),column,Freq);
+
+    double values[32];
+    std::uint8_t ratios[32];
+    for(std::size_t i = 0; i < std::size(values); i++)
+    {
+        values[i] = 1.5 * static_cast<double>(i + 1) * 1000;
+        ratios[i] = Milli;
+    }
+    ratioTo(values,ratios,std::size(values),Voltage,Micro);
+    proper(values,ratios,std::size(values),Voltage);
+
+    char buffer[64];
+    const ValuePack pack = tryFromString(Samples[0]).pack;
+    toString(pack,buffer,sizeof(buffer));
+    toFormatString(pack,buffer,sizeof(buffer),6);
+    toFormatString(pack,buffer,sizeof(buffer),10,3);
+    toScientificString(pack,buffer,sizeof(buffer));
 }
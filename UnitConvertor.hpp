@@ -2,7 +2,20 @@
 #define UNITCONVERTOR_HPP
 
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
 #include <cmath>
+#include <limits>
+
+///定义UNITCONVERTOR_INLINE(例如-DUNITCONVERTOR_INLINE)时,ValuePack的构造函数和访问函数、generateUnitProperty、limitRatio
+///以及数量级换算等热点函数在头文件中内联定义(见UnitConvertorInline.hpp),不需要LTO也可以内联到调用处的循环中;
+///否则这些函数在UnitConvertor.cpp中定义。这个宏必须对程序中的所有源文件(包括UnitConvertor.cpp)使用相同的设置
+#ifdef UNITCONVERTOR_INLINE
+#define UC_INLINE inline
+#else
+#define UC_INLINE
+#endif
 
 class ValuePack;
 struct UnitProperty;
@@ -10,33 +23,186 @@ namespace UnitConvertor
 {
     enum DecimalRatio{Nano,Micro,Milli,One,Kilo,Mega,Giga,RatioNum};
 
-    static const std::string DecimalRatioString[RatioNum] = {"n" , "u" , "m" , "" , "k" , "M" , "G"};
+    inline constexpr std::string_view DecimalRatioString[RatioNum] = {"n" , "u" , "m" , "" , "k" , "M" , "G"};
+
+    ///UnitNum之后的枚举值留给运行时注册的单位(见registerUnit),所以底层类型固定为一个字节
+    enum DecimalUnit : std::uint8_t{Null,Freq,Time,Ampl,Voltage,Current,Phase,SampRate,VolArea,Percent,UnitNum};
+
+    inline constexpr std::string_view DecimalUnitString[UnitNum] = {"" , "Hz" , "s" , "Vpp" , "V" , "A" , "°","Sa/s","V*s","%"};
+
+    ///解析字符串时发现的问题,可以按位组合,ParseOk表示没有发现问题
+    enum ParseFlag : std::uint8_t
+    {
+        ParseOk = 0,
+        ParseValueMissing = 1 << 0,     //没有找到数值,数值为0
+        ParseMultipleValues = 1 << 1,   //找到多个数值,数值为0
+        ParseValueOutOfRange = 1 << 2,  //数值超出double的表示范围,数值为0
+        ParseMultipleUnits = 1 << 3,    //找到多个单位,单位为Null
+        ParseUnknownUnit = 1 << 4,      //单位字符串无法识别,单位为Null
+        ParseMultipleRatios = 1 << 5,   //找到多个数量级,数量级为One
+        ParseUnknownRatio = 1 << 6,     //数量级字符串无法识别,数量级为One
+        ParseUnexpectedText = 1 << 7    //存在不属于数值、数量级、单位的字符,不影响解析结果(fromString不检查这一项)
+    };
+
+    ///批量解析的结果,按列连续存储,可以直接交给向量化的后续处理
+    struct ValueColumn
+    {
+        std::vector<double> values;
+        std::vector<std::uint8_t> ratios;   //DecimalRatio
+        std::vector<std::uint8_t> units;    //DecimalUnit
+        std::vector<std::uint8_t> flags;    //ParseFlag的组合
+
+        std::size_t size() const noexcept { return values.size(); }
+
+        void resize(std::size_t count)
+        {
+            values.resize(count);
+            ratios.resize(count);
+            units.resize(count);
+            flags.resize(count);
+        }
+    };
+
+    ///一组数值的统计量,NaN不参与统计;add逐个累加(Welford),merge合并两组数据(Chan),求和使用补偿求和(Neumaier)
+    struct ColumnSummary
+    {
+        std::size_t count = 0;
+        double mean = 0;
+        double m2 = 0;                  //与均值之差的平方和,总体方差为m2 / count
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        double sum = 0;
+        double compensation = 0;        //补偿求和中尚未加到sum中的低位部分,总和为sum + compensation
+
+        void add(double value) noexcept;
+
+        void merge(const ColumnSummary& other) noexcept;
+    };
+
+    ///批量格式化时选择与哪一个格式化函数输出相同的内容
+    enum FormatMode
+    {
+        FormatString,           //toString
+        FormatPrecision,        //toFormatString(pack,precision,fixedDecimal)
+        FormatWidth,            //toFormatString(pack,totalLeng,decimalLen,fill)
+        FormatScientific,       //toScientificString(pack,precision),precision为6时与toScientificString(pack)相同
+        FormatNumericPart,      //numericPart
+        FormatUnitPart          //unitPart
+    };
+
+    ///批量格式化的格式,默认构造时与toString相同,其他格式用下面的静态函数生成
+    struct FormatSpec
+    {
+        FormatMode mode = FormatString;
+        int precision = 6;
+        bool fixedDecimal = true;
+        int totalLeng = 0;
+        int decimalLen = 0;
+        char fill = '0';
+
+        static FormatSpec precisionFormat(int precision,bool fixedDecimal = true) noexcept { FormatSpec f; f.mode = FormatPrecision; f.precision = precision; f.fixedDecimal = fixedDecimal; return f; }
+
+        static FormatSpec widthFormat(int totalLeng,int decimalLen,char fill = '0') noexcept { FormatSpec f; f.mode = FormatWidth; f.totalLeng = totalLeng; f.decimalLen = decimalLen; f.fill = fill; return f; }
+
+        static FormatSpec scientificFormat(int precision = 6) noexcept { FormatSpec f; f.mode = FormatScientific; f.precision = precision; return f; }
+
+        static FormatSpec numericFormat() noexcept { FormatSpec f; f.mode = FormatNumericPart; return f; }
+
+        static FormatSpec unitFormat() noexcept { FormatSpec f; f.mode = FormatUnitPart; return f; }
+    };
+
+    ///批量格式化的结果:所有字符串连续存放在buffer中,第i个字符串为buffer[offsets[i],offsets[i] + lengths[i])
+    ///buffer可以直接写入文件或者socket;字符串之间的分隔符(见toStrings)也在buffer中,但是不计入lengths
+    struct TextColumn
+    {
+        std::string buffer;
+        std::vector<std::size_t> offsets;
+        std::vector<std::size_t> lengths;
+
+        std::size_t size() const noexcept { return offsets.size(); }
+
+        std::string_view operator[](std::size_t i) const noexcept { return std::string_view(buffer.data() + offsets[i],lengths[i]); }
+
+        void clear() noexcept
+        {
+            buffer.clear();
+            offsets.clear();
+            lengths.clear();
+        }
+    };
 
-    enum DecimalUnit{Null,Freq,Time,Ampl,Voltage,Current,Phase,SampRate,VolArea,Percent,UnitNum};
+    ///这个函数返回一个单位对应的属性:属性包括这个单位所对应的最大数量级、最小数量级、单位枚举
+    UC_INLINE const UnitProperty generateUnitProperty(DecimalUnit unit) noexcept;
 
-    static const std::string DecimalUnitString[UnitNum] = {"" , "Hz" , "s" , "Vpp" , "V" , "A" , "°","Sa/s","V*s","%"};
+    ///在运行时注册一个单位,返回新单位的枚举值(从UnitNum + 1开始分配,UnitNum仍然表示不指定单位)
+    ///name为单位字符串,解析时与内置单位一样不区分大小写;数量级范围为[minRatio,maxRatio],相邻数量级之间的进制为exp(例如m²为1000000)
+    ///name为空、包含数字或空白字符、与已有单位重复,或者数量级范围、进制无效时抛出std::invalid_argument,单位个数超过一个字节时抛出std::length_error
+    ///注册的单位不能删除;注册时生成新的只读快照,不会阻塞也不会拖慢其他线程中正在进行的解析和转换
+    DecimalUnit registerUnit(std::string_view name,DecimalRatio minRatio,DecimalRatio maxRatio,double exp = 1000);
 
-    ///这个函数返回一个单位对应的属性:属性包括这个单位所对应的最大数量级、最小数量级、单位枚举
-    const UnitProperty generateUnitProperty(DecimalUnit unit) noexcept;
+    ///按照单位字符串查找单位(不区分大小写),找不到时返回UnitNum
+    DecimalUnit findUnit(std::string_view name) noexcept;
+
+    ///单位字符串,内置单位与DecimalUnitString相同,未注册的单位返回空字符串
+    std::string_view unitName(DecimalUnit unit) noexcept;
+
+    ///当前已经分配的单位枚举值个数(包括内置单位和UnitNum),每注册一个单位加一
+    std::size_t unitCount() noexcept;
+
+    ///库中所有的表都在编译期生成,包含头文件和加载库不会执行任何初始化代码;剩下的检测SIMD指令集、创建单位注册表、
+    ///调用线程的线程局部状态会在第一次用到时才完成,并且解析和格式化的代码第一次执行时还不在缓存中
+    ///warmUp在调用线程中提前完成这些工作并把各个热点函数执行一次,可以在启动后空闲时调用,避免第一次转换出现延迟尖峰;可以重复调用
+    void warmUp();
 
     ///如果给定单位的数量级超出了这个单位对应的限制范围,则返回这个单位所能代表的限制范围数量级,否则不改变传入数量级大小
-    DecimalRatio limitRatio(DecimalUnit unit,DecimalRatio ratio);
+    UC_INLINE DecimalRatio limitRatio(DecimalUnit unit,DecimalRatio ratio);
 
-    ///将一个字符串转换为数据包,如果在调用这个函数的时候指定单位类型执行效率将会更高
+    ///将一个字符串转换为数据包(支持科学计数法),如果在调用这个函数的时候指定单位类型执行效率将会更高
     ValuePack fromString(const std::string& target,DecimalUnit unit = DecimalUnit::UnitNum);
 
+    ///批量解析count个字符串,结果写入调用者提供的数组,每个元素的解析结果与fromString相同,解析问题写入flags而不会抛出异常
+    ///返回flags不为ParseOk的元素个数
+    std::size_t fromStrings(const std::string_view* targets,std::size_t count,double* values,std::uint8_t* ratios,std::uint8_t* units,std::uint8_t* flags,DecimalUnit unit = DecimalUnit::UnitNum) noexcept;
+
+    ///批量解析count个字符串,column会被调整为count大小
+    std::size_t fromStrings(const std::string_view* targets,std::size_t count,ValueColumn& column,DecimalUnit unit = DecimalUnit::UnitNum);
+
     ///将当前数据的数量级转换为newRatio表示的数据
-    ValuePack ratioTo(ValuePack pack, DecimalRatio newRatio);
+    UC_INLINE ValuePack ratioTo(ValuePack pack, DecimalRatio newRatio);
 
     ///将当前数据字符串的数量级转换为newRatio表示的数据
     ValuePack ratioTo(const std::string& str, DecimalRatio newRatio);
 
-    ///将数值自动转换为一个恰当单位表示的数值(1～999之间的值)
-    ValuePack proper(ValuePack pack);
+    ///单位unit的数值由ratio数量级换算到newRatio数量级时需要乘的系数(Exp的ratio - newRatio次方),查表得到,不受单位数量级范围的限制
+    UC_INLINE double conversionFactor(DecimalUnit unit,DecimalRatio ratio,DecimalRatio newRatio) noexcept;
+
+    ///将count个数值由ratio数量级转换为newRatio数量级(原地转换),newRatio超出单位的限制范围时会被调整,返回实际使用的数量级
+    ///运行时根据CPU选择SSE2/AVX2/AVX-512实现,结果与逐个调用ratioTo逐位相同
+    DecimalRatio ratioTo(double* values,std::size_t count,DecimalUnit unit,DecimalRatio ratio,DecimalRatio newRatio) noexcept;
+
+    ///将count个数值由各自的数量级ratios转换为newRatio数量级(原地转换),ratios会被更新为实际使用的数量级
+    void ratioTo(double* values,std::uint8_t* ratios,std::size_t count,DecimalUnit unit,DecimalRatio newRatio) noexcept;
+
+    ///将column中的所有数值转换为newRatio数量级表示,数量级按照每个数值各自单位的限制范围调整
+    void ratioTo(ValueColumn& column,DecimalRatio newRatio) noexcept;
+
+    ///将数值自动转换为一个恰当单位表示的数值(1～999之间的值),数量级不会超出单位的限制范围
+    UC_INLINE ValuePack proper(ValuePack pack);
 
     ///将字符串自动转换为一个恰当单位表示的数值(1～999之间的值)
     ValuePack proper(const std::string& str);
 
+    ///将count个数值分别转换为恰当数量级表示(原地转换),ratios保存每个数值当前的数量级并会被更新
+    ///运行时根据CPU选择SSE2/AVX2/AVX-512实现,结果与逐个调用proper逐位相同
+    void proper(double* values,std::uint8_t* ratios,std::size_t count,DecimalUnit unit) noexcept;
+
+    ///将column中的所有数值分别转换为恰当数量级表示
+    void proper(ValueColumn& column) noexcept;
+
+    ///count个数值分别乘以factor之后的统计量,运行时根据CPU选择SSE2/AVX2实现
+    ///数据按块处理,每块先求均值再求平方和(两次遍历都在缓存中),块之间按照merge合并,所以结果与逐个add只在最后几位上有差别
+    ColumnSummary summarize(const double* values,std::size_t count,double factor = 1) noexcept;
+
     ///获取数字部分字符串
     std::string numericPart(const ValuePack& pack);
 
@@ -58,6 +224,33 @@ namespace UnitConvertor
     ///将ValuePack转换为科学计数法的字符串,小数点后面保留precision位
     std::string toScientificString(const ValuePack& pack,int precision);
 
+    ///缓冲区长度不足时下面的函数返回FormatFailed,与长度为0的有效结果(例如没有数量级和单位时的unitPart)区分
+    inline constexpr std::size_t FormatFailed = static_cast<std::size_t>(-1);
+
+    ///以下函数与上面对应的函数输出相同的内容,但是结果写入调用者提供的缓冲区buffer而不会申请内存
+    ///返回写入的字符数(不写入结尾的'\0'),缓冲区长度size不足时返回FormatFailed,此时缓冲区的内容不确定
+
+    std::size_t numericPart(const ValuePack& pack,char* buffer,std::size_t size) noexcept;
+
+    std::size_t unitPart(const ValuePack& pack,char* buffer,std::size_t size) noexcept;
+
+    std::size_t toString(const ValuePack& pack,char* buffer,std::size_t size) noexcept;
+
+    std::size_t toFormatString(const ValuePack& pack,char* buffer,std::size_t size,int precision,bool fixedDecimal = true) noexcept;
+
+    std::size_t toFormatString(const ValuePack& pack,char* buffer,std::size_t size,int totalLeng,int decimalLen,char fill = '0') noexcept;
+
+    std::size_t toScientificString(const ValuePack& pack,char* buffer,std::size_t size) noexcept;
+
+    std::size_t toScientificString(const ValuePack& pack,char* buffer,std::size_t size,int precision) noexcept;
+
+    ///将count个数据包按照spec格式化后追加到out中,每个字符串后面追加separator(例如"\n"),每个字符串的内容与对应的单个格式化函数相同
+    ///所有字符串写入同一块缓冲区,缓冲区按倍数增长,每批只需要很少几次内存申请
+    void toStrings(const ValuePack* packs,std::size_t count,TextColumn& out,const FormatSpec& spec = FormatSpec(),std::string_view separator = std::string_view());
+
+    ///将column中的所有数值格式化后追加到out中
+    void toStrings(const ValueColumn& column,TextColumn& out,const FormatSpec& spec = FormatSpec(),std::string_view separator = std::string_view());
+
     ///将ValuePack转换为整数
     long long toInt(const ValuePack& pack);
 };
@@ -73,75 +266,155 @@ struct UnitProperty
     //把进制作为成员变量而不是全局变量以以获得更高的灵活性,比如kV和V之间的进制是1000,km²和m²的进制1000000
 };
 
+namespace UnitConvertor
+{
+    ///每个单位对应的属性,下标为DecimalUnit,编译期可用
+    inline constexpr UnitProperty UnitPropertyTable[UnitNum] = {
+        {One,One,Null,1000},
+        {Giga,One,Freq,1000},
+        {One,Nano,Time,1000},
+        {Kilo,Micro,Ampl,1000},
+        {Kilo,Micro,Voltage,1000},
+        {Kilo,Micro,Current,1000},
+        {One,One,Phase,1000},
+        {Giga,One,SampRate,1000},
+        {Giga,One,VolArea,1000},
+        {One,One,Percent,1}
+    };
+}
+
 class ValuePack
 {
-    //这个类只有数值成员变量,无需自定义拷贝和移动函数,太懒了不想重载+=、-=、*=、/=这些运算符,有需要的时候再加
+    //这个类只有数值成员变量,无需自定义拷贝和移动函数
+    //与数值运算时只改变数值,数量级和单位保持不变,所以不需要经过构造函数重新检查数量级
 public:
-    ValuePack();
+    UC_INLINE ValuePack();
 
-    ValuePack(double value,UnitConvertor::DecimalRatio ratio,UnitConvertor::DecimalUnit unit);
+    UC_INLINE ValuePack(double value,UnitConvertor::DecimalRatio ratio,UnitConvertor::DecimalUnit unit);
 
     ///可以直接与数值类型变量相加
     template<typename T>
     typename std::enable_if<std::is_arithmetic<T>::value,ValuePack>::type
     operator + (T value) const noexcept{
-        return ValuePack(this->m_Value+value, this->ratio(), this->m_Property.unit);
+        ValuePack result(*this);
+        return result += value;
     }
 
     template<typename T>
     typename std::enable_if<std::is_arithmetic<T>::value,ValuePack>::type
     operator - (T value) const noexcept{
-        return ValuePack(this->m_Value-value, this->ratio(), this->m_Property.unit);
+        ValuePack result(*this);
+        return result -= value;
     }
 
     template<typename T>
     typename std::enable_if<std::is_arithmetic<T>::value,ValuePack>::type
     operator * (T value) const noexcept{
-        return ValuePack(this->m_Value*value, this->ratio(), this->m_Property.unit);
+        ValuePack result(*this);
+        return result *= value;
     }
 
     template<typename T>
     typename std::enable_if<std::is_arithmetic<T>::value,ValuePack>::type
     operator / (T value) const noexcept{
-        return ValuePack(this->m_Value*value, this->ratio(), this->m_Property.unit);
+        ValuePack result(*this);
+        return result /= value;
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value,ValuePack&>::type
+    operator += (T value) noexcept{
+        m_Value += value;
+        return *this;
     }
 
-    ValuePack operator + (const ValuePack& pack) const noexcept;
+    template<typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value,ValuePack&>::type
+    operator -= (T value) noexcept{
+        m_Value -= value;
+        return *this;
+    }
 
-    ValuePack operator - (const ValuePack& pack) const noexcept;
+    template<typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value,ValuePack&>::type
+    operator *= (T value) noexcept{
+        m_Value *= value;
+        return *this;
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value,ValuePack&>::type
+    operator /= (T value) noexcept{
+        m_Value /= value;
+        return *this;
+    }
+
+    ///单位相同时把pack换算到当前数量级后相加,结果保持当前的数量级;单位不同时返回默认构造的数据包
+    UC_INLINE ValuePack operator + (const ValuePack& pack) const noexcept;
+
+    UC_INLINE ValuePack operator - (const ValuePack& pack) const noexcept;
+
+    ///与operator +、operator -相同,单位不同时变为默认构造的数据包
+    UC_INLINE ValuePack& operator += (const ValuePack& pack) noexcept;
+
+    UC_INLINE ValuePack& operator -= (const ValuePack& pack) noexcept;
 
     operator double() const noexcept {  return m_Value;  }
 
-    bool operator == (const ValuePack& other) const;
+    UC_INLINE bool operator == (const ValuePack& other) const;
 
-    bool operator != (const ValuePack& other) const;
+    UC_INLINE bool operator != (const ValuePack& other) const;
 
-    bool operator > (const ValuePack& other) const noexcept;
+    UC_INLINE bool operator > (const ValuePack& other) const noexcept;
 
-    bool operator < (const ValuePack& other) const noexcept;
+    UC_INLINE bool operator < (const ValuePack& other) const noexcept;
 
-    bool operator >= (const ValuePack& other) const noexcept;
+    UC_INLINE bool operator >= (const ValuePack& other) const noexcept;
 
-    bool operator <= (const ValuePack& other) const noexcept;
+    UC_INLINE bool operator <= (const ValuePack& other) const noexcept;
 
-    ValuePack& ratioTo(UnitConvertor::DecimalRatio newRatio);
+    UC_INLINE ValuePack& ratioTo(UnitConvertor::DecimalRatio newRatio);
 
-    ValuePack& proper();
+    UC_INLINE ValuePack& proper();
 
-    void setValue(double value) noexcept;
+    UC_INLINE void setValue(double value) noexcept;
 
-    double value() const noexcept;
+    UC_INLINE double value() const noexcept;
 
-    UnitConvertor::DecimalRatio ratio() const noexcept;
+    UC_INLINE UnitConvertor::DecimalRatio ratio() const noexcept;
 
-    UnitConvertor::DecimalUnit unit() const noexcept;
+    UC_INLINE UnitConvertor::DecimalUnit unit() const noexcept;
 
-    UnitProperty property() const noexcept;
+    UC_INLINE UnitProperty property() const noexcept;
 
 private:
     double m_Value = 0;
-    UnitConvertor::DecimalRatio m_Ratio = UnitConvertor::One;
-    UnitProperty m_Property;
+    //数量级和单位各用一个字节保存,单位属性从UnitPropertyTable中查找,这样整个对象只占16字节
+    std::uint8_t m_Ratio = UnitConvertor::One;
+    std::uint8_t m_Unit = UnitConvertor::Null;
 };
 
+static_assert(sizeof(ValuePack) <= 16,"ValuePack should stay within 16 bytes");
+
+namespace UnitConvertor
+{
+    ///tryFromString的解析结果
+    struct ParseResult
+    {
+        ValuePack pack;                 //解析得到的数据包,与fromString的结果相同(数值超出范围时为0)
+        ParseFlag error = ParseOk;      //第一个发现的问题,ParseOk表示解析成功
+        std::uint8_t flags = ParseOk;   //发现的所有问题(ParseFlag的组合)
+        std::size_t offset = 0;         //第一个问题在字符串中的位置
+
+        explicit operator bool() const noexcept { return error == ParseOk; }
+    };
+
+    ///将字符串转换为数据包,不会抛出异常也不会申请内存,无法确定数值、单位或者数量级时通过返回值报告第一个问题及其位置
+    ParseResult tryFromString(std::string_view target,DecimalUnit unit = DecimalUnit::UnitNum) noexcept;
+}
+
+#ifdef UNITCONVERTOR_INLINE
+#include "UnitConvertorInline.hpp"
+#endif
+
 #endif // UNITCONVERTOR_HPP
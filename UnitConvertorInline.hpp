@@ -0,0 +1,245 @@
+﻿#ifndef UNITCONVERTORINLINE_HPP
+#define UNITCONVERTORINLINE_HPP
+
+#include "UnitConvertor.hpp"
+#ifndef UNITCONVERTOR_INLINE
+#include "ConvertStats.hpp"
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+///热点函数的定义:定义了UNITCONVERTOR_INLINE时由UnitConvertor.hpp包含,函数是内联的;否则只由UnitConvertor.cpp包含,函数是普通的外部函数
+///不要直接包含这个文件
+namespace UnitConvertor
+{
+    namespace Detail
+    {
+        ///数量级换算系数表,factor[unit][diff + RatioNum - 1]保存Exp的diff次方,避免每次转换数量级都调用pow
+        struct RatioFactorTable
+        {
+            double factor[UnitNum][2 * RatioNum - 1];
+        };
+
+        ///在编译期生成,正次方是精确的整数,负次方由一次除法得到,与std::pow的结果逐位相同(与Quantity.hpp中的quantityFactor一致)
+        constexpr RatioFactorTable makeRatioFactorTable()
+        {
+            RatioFactorTable table{};
+            for(int unit = 0; unit < UnitNum; unit++)
+            {
+                double power = 1;
+                table.factor[unit][RatioNum - 1] = 1;
+                for(int diff = 1; diff < RatioNum; diff++)
+                {
+                    power *= UnitPropertyTable[unit].Exp;
+                    table.factor[unit][RatioNum - 1 + diff] = power;
+                    table.factor[unit][RatioNum - 1 - diff] = 1 / power;
+                }
+            }
+            return table;
+        }
+
+        inline constexpr RatioFactorTable RatioFactors = makeRatioFactorTable();
+
+        ///运行时注册的单位保存在UnitConvertor.cpp的单位快照中,这两个函数总是在UnitConvertor.cpp中定义
+        ///没有注册的单位分别返回UnitProperty{}和Null单位的系数
+        UnitProperty registeredUnitProperty(DecimalUnit unit) noexcept;
+        double registeredRatioFactor(DecimalUnit unit,int diff) noexcept;
+
+        ///获取单位unit从ratio转换为newRatio时需要乘的系数,结果与std::pow(Exp,ratio - newRatio)完全相同
+        inline double ratioFactor(DecimalUnit unit,int ratio,int newRatio) noexcept
+        {
+            if(unit >= DecimalUnit::UnitNum)
+                return registeredRatioFactor(unit,ratio - newRatio);
+            return RatioFactors.factor[unit][ratio - newRatio + RatioNum - 1];
+        }
+
+        ///将单个数值调整到恰当的数量级,数量级不会超出单位的限制范围
+        ///向量化版本按照完全相同的步骤计算,所以两者的结果逐位相同
+        inline void properValue(double& value,int& ratio,const UnitProperty& p) noexcept
+        {
+            while(std::abs(value) > 1000 && ratio < p.maxRatio)
+            {
+                value /= p.Exp;
+                ++ratio;
+            }
+            while(std::abs(value) < 1 && std::abs(value) > 0 && ratio > p.minRatio)
+            {
+                value *= p.Exp;
+                --ratio;
+            }
+        }
+    }
+
+    UC_INLINE const UnitProperty generateUnitProperty(DecimalUnit unit) noexcept
+    {
+        if(unit < DecimalUnit::UnitNum)
+            return UnitPropertyTable[unit];
+        return Detail::registeredUnitProperty(unit);
+    }
+
+    UC_INLINE DecimalRatio limitRatio(DecimalUnit unit, DecimalRatio ratio)
+    {
+        UnitProperty p = generateUnitProperty(unit);
+        ratio = std::min(p.maxRatio,ratio);
+        ratio = std::max(p.minRatio,ratio);
+        return ratio;
+    }
+
+    UC_INLINE double conversionFactor(DecimalUnit unit, DecimalRatio ratio, DecimalRatio newRatio) noexcept
+    {
+        return Detail::ratioFactor(unit,ratio,newRatio);
+    }
+
+    ///内联时调用处不一定包含ConvertStats.hpp,所以只有在UnitConvertor.cpp中定义时才记录TimerRatioTo和TimerProper
+    UC_INLINE ValuePack ratioTo(ValuePack pack, DecimalRatio newRatio)
+    {
+#ifndef UNITCONVERTOR_INLINE
+        UC_STAT_TIMER(TimerRatioTo);
+#endif
+        newRatio = limitRatio(pack.unit(),newRatio);
+
+        double value = pack.value() * Detail::ratioFactor(pack.unit(),pack.ratio(),newRatio);
+        return ValuePack(value,newRatio,pack.property().unit);
+    }
+
+    UC_INLINE ValuePack proper(ValuePack pack)
+    {
+#ifndef UNITCONVERTOR_INLINE
+        UC_STAT_TIMER(TimerProper);
+#endif
+        double value = pack.value();
+        int ratio = pack.ratio();
+        Detail::properValue(value,ratio,pack.property());
+        return ValuePack(value,DecimalRatio(ratio),pack.property().unit);
+    }
+}
+
+UC_INLINE ValuePack::ValuePack(){}
+
+UC_INLINE ValuePack::ValuePack(double value, UnitConvertor::DecimalRatio ratio, UnitConvertor::DecimalUnit unit)
+{
+    this->m_Value = value;
+    this->m_Ratio = static_cast<std::uint8_t>(UnitConvertor::limitRatio(unit,ratio));
+    this->m_Unit = static_cast<std::uint8_t>(unit);
+}
+
+UC_INLINE ValuePack ValuePack::operator +(const ValuePack &pack) const noexcept
+{
+    ValuePack result(*this);
+    return result += pack;
+}
+
+UC_INLINE ValuePack ValuePack::operator - (const ValuePack &pack) const noexcept
+{
+    ValuePack result(*this);
+    return result -= pack;
+}
+
+UC_INLINE ValuePack &ValuePack::operator +=(const ValuePack &pack) noexcept
+{
+    //两个数量级都已经在单位的范围内,直接查表换算,不需要经过ratioTo和构造函数
+    if(pack.m_Unit != this->m_Unit)
+        return *this = ValuePack();
+    this->m_Value += pack.m_Ratio == this->m_Ratio ? pack.m_Value : pack.m_Value * UnitConvertor::Detail::ratioFactor(this->unit(),pack.m_Ratio,this->m_Ratio);
+    return *this;
+}
+
+UC_INLINE ValuePack &ValuePack::operator -=(const ValuePack &pack) noexcept
+{
+    if(pack.m_Unit != this->m_Unit)
+        return *this = ValuePack();
+    this->m_Value -= pack.m_Ratio == this->m_Ratio ? pack.m_Value : pack.m_Value * UnitConvertor::Detail::ratioFactor(this->unit(),pack.m_Ratio,this->m_Ratio);
+    return *this;
+}
+
+UC_INLINE bool ValuePack::operator == (const ValuePack &other) const
+{
+    return std::abs(this->m_Value - other.m_Value) < 1e-10
+           &&this->m_Ratio == other.m_Ratio
+           && this->m_Unit == other.m_Unit;
+}
+
+UC_INLINE bool ValuePack::operator != (const ValuePack &other) const
+{
+    return !(*this == other);
+}
+
+UC_INLINE bool ValuePack::operator > (const ValuePack &other) const noexcept
+{
+    if(this->unit() == other.unit())
+        return !(*this <= other);
+    else
+        return false;
+}
+
+UC_INLINE bool ValuePack::operator < (const ValuePack &other) const noexcept
+{
+    if(this->unit() == other.unit())
+        return !(*this >= other);
+    else
+        return false;
+}
+
+UC_INLINE bool ValuePack::operator >= (const ValuePack &other) const noexcept
+{
+    if(this->unit() == other.unit())
+    {
+        if(this->m_Ratio == other.m_Ratio)
+            return this->m_Value >= other.m_Value;
+        else
+            return Uc::ratioTo(*this,Uc::One).m_Value >= Uc::ratioTo(other,Uc::One).m_Value;
+    }
+    return false;
+}
+
+UC_INLINE bool ValuePack::operator <= (const ValuePack &other) const noexcept
+{
+    if(this->unit() == other.unit())
+    {
+        if(this->m_Ratio == other.m_Ratio)
+            return this->m_Value <= other.m_Value;
+        else
+            return Uc::ratioTo(*this,Uc::One).m_Value <= Uc::ratioTo(other,Uc::One).m_Value;
+    }
+    return false;
+}
+
+UC_INLINE ValuePack &ValuePack::ratioTo(UnitConvertor::DecimalRatio newRatio)
+{
+    *this = UnitConvertor::ratioTo(*this,newRatio);
+    return *this;
+}
+
+UC_INLINE ValuePack &ValuePack::proper()
+{
+    *this = UnitConvertor::proper(*this);
+    return *this;
+}
+
+UC_INLINE void ValuePack::setValue(double value) noexcept
+{
+    this->m_Value = value;
+}
+
+UC_INLINE double ValuePack::value() const noexcept
+{
+    return this->m_Value;
+}
+
+UC_INLINE UnitConvertor::DecimalRatio ValuePack::ratio() const noexcept
+{
+    return static_cast<UnitConvertor::DecimalRatio>(this->m_Ratio);
+}
+
+UC_INLINE UnitConvertor::DecimalUnit ValuePack::unit() const noexcept
+{
+    return static_cast<UnitConvertor::DecimalUnit>(this->m_Unit);
+}
+
+UC_INLINE UnitProperty ValuePack::property() const noexcept
+{
+    return UnitConvertor::generateUnitProperty(this->unit());
+}
+
+#endif // UNITCONVERTORINLINE_HPP
@@ -0,0 +1,276 @@
+﻿#ifndef VALUEEXPRESSION_HPP
+#define VALUEEXPRESSION_HPP
+
+#include "UnitConvertor.hpp"
+
+namespace UnitConvertor
+{
+    ///数据包算术表达式的延迟求值:expr()包装的操作数参与的+、-、*、/不会立即计算,而是生成表达式节点,
+    ///求值时只检查一次单位、只确定一次结果的数量级,每个操作数的换算系数查表一次,之后在一个循环中完成全部运算
+    ///结果与依次使用ValuePack的运算符相同:数量级取最左边的数据包,单位不同时得到默认构造的数据包,
+    ///与普通数值相加减时按结果的数量级计算,只能乘除普通数值
+    ///
+    ///  ValuePack v = Uc::expr(a) + b * 2 - c / 4;
+    ///  Uc::evaluate(Uc::expr(volts,Milli,Voltage) * gain - offset,out,count);
+    template<typename Derived>
+    struct Expression
+    {
+        const Derived& derived() const noexcept { return static_cast<const Derived&>(*this); }
+
+        ///所有数据包和数组的单位都相同时返回该单位,否则返回UnitNum
+        DecimalUnit unit() const noexcept
+        {
+            int unit = -1;
+            if(!derived().collectUnit(unit) || unit < 0)
+                return DecimalUnit::UnitNum;
+            return static_cast<DecimalUnit>(unit);
+        }
+
+        ///结果的数量级:最左边的数据包或数组的数量级
+        DecimalRatio ratio() const noexcept { return static_cast<DecimalRatio>(derived().leadRatio()); }
+
+        ///标量求值,相当于依次使用ValuePack的运算符,数组按第一个元素计算
+        ///最左边是数据包时直接复制它再替换数值,它的数量级已经在单位的范围内,不需要再经过构造函数
+        ValuePack evaluate() const noexcept
+        {
+            const DecimalUnit unit = this->unit();
+            if(unit == DecimalUnit::UnitNum)
+                return ValuePack();
+            Derived expression(derived());
+            const DecimalRatio ratio = this->ratio();
+            expression.prepare(unit,ratio);
+            const ValuePack* lead = expression.leadPack();
+            if(lead == nullptr)
+                return ValuePack(expression.at(0),ratio,unit);
+            ValuePack result(*lead);
+            result.setValue(expression.at(0));
+            return result;
+        }
+
+        operator ValuePack() const noexcept { return evaluate(); }
+    };
+
+    ///数据包,在数组求值中作为每个元素都相同的操作数
+    struct PackTerm : Expression<PackTerm>
+    {
+        ///数值、数量级和单位在构造时各读取一次,求值过程中不再访问数据包
+        explicit PackTerm(const ValuePack& pack) noexcept
+            : pack(pack), scaled(pack.value()), ratioValue(pack.ratio()), unitValue(pack.unit()) {}
+
+        bool collectUnit(int& unit) const noexcept { return mergeUnit(unit,unitValue); }
+        int leadRatio() const noexcept { return ratioValue; }
+        const ValuePack* leadPack() const noexcept { return &pack; }
+        void prepare(DecimalUnit unit,DecimalRatio ratio) noexcept
+        {
+            if(ratioValue != ratio)
+                scaled *= conversionFactor(unit,ratioValue,ratio);
+        }
+        double at(std::size_t) const noexcept { return scaled; }
+
+        static bool mergeUnit(int& unit,DecimalUnit current) noexcept
+        {
+            if(unit < 0)
+                unit = current;
+            return unit == current;
+        }
+
+        ValuePack pack;
+        double scaled;
+        DecimalRatio ratioValue;
+        DecimalUnit unitValue;
+    };
+
+    ///count个单位和数量级都相同的数值,由evaluate(expression,out,count)逐个元素求值
+    ///数量级按照ValuePack的构造函数限制在单位的范围内
+    struct ArrayTerm : Expression<ArrayTerm>
+    {
+        ArrayTerm(const double* values,DecimalRatio ratio,DecimalUnit unit)
+            : values(values), ratioValue(UnitConvertor::limitRatio(unit,ratio)), unitValue(unit) {}
+
+        bool collectUnit(int& unit) const noexcept { return PackTerm::mergeUnit(unit,unitValue); }
+        int leadRatio() const noexcept { return ratioValue; }
+        const ValuePack* leadPack() const noexcept { return nullptr; }
+        void prepare(DecimalUnit unit,DecimalRatio ratio) noexcept
+        {
+            factor = ratioValue == ratio ? 1.0 : conversionFactor(unit,ratioValue,ratio);
+        }
+        double at(std::size_t i) const noexcept { return values[i] * factor; }
+
+        const double* values;
+        DecimalRatio ratioValue;
+        DecimalUnit unitValue;
+        double factor = 1;
+    };
+
+    ///普通数值,按照结果的数量级参与加减,或者作为乘除的系数
+    struct ScalarTerm : Expression<ScalarTerm>
+    {
+        explicit ScalarTerm(double value) noexcept : value(value) {}
+
+        bool collectUnit(int&) const noexcept { return true; }
+        int leadRatio() const noexcept { return -1; }
+        const ValuePack* leadPack() const noexcept { return nullptr; }
+        void prepare(DecimalUnit,DecimalRatio) noexcept {}
+        double at(std::size_t) const noexcept { return value; }
+
+        double value;
+    };
+
+    enum ExpressionOperator{ExpressionAdd,ExpressionSub,ExpressionMul,ExpressionDiv};
+
+    template<ExpressionOperator Op,typename Left,typename Right>
+    struct BinaryExpression : Expression<BinaryExpression<Op,Left,Right>>
+    {
+        BinaryExpression(const Left& left,const Right& right) noexcept : left(left), right(right) {}
+
+        bool collectUnit(int& unit) const noexcept { return left.collectUnit(unit) && right.collectUnit(unit); }
+        int leadRatio() const noexcept
+        {
+            const int ratio = left.leadRatio();
+            return ratio >= 0 ? ratio : right.leadRatio();
+        }
+        const ValuePack* leadPack() const noexcept
+        {
+            return left.leadRatio() >= 0 ? left.leadPack() : right.leadPack();
+        }
+        void prepare(DecimalUnit unit,DecimalRatio ratio) noexcept
+        {
+            left.prepare(unit,ratio);
+            right.prepare(unit,ratio);
+        }
+        double at(std::size_t i) const noexcept
+        {
+            switch(Op)
+            {
+            case ExpressionAdd: return left.at(i) + right.at(i);
+            case ExpressionSub: return left.at(i) - right.at(i);
+            case ExpressionMul: return left.at(i) * right.at(i);
+            default:            return left.at(i) / right.at(i);
+            }
+        }
+
+        Left left;
+        Right right;
+    };
+
+    template<typename Operand>
+    struct NegateExpression : Expression<NegateExpression<Operand>>
+    {
+        explicit NegateExpression(const Operand& operand) noexcept : operand(operand) {}
+
+        bool collectUnit(int& unit) const noexcept { return operand.collectUnit(unit); }
+        int leadRatio() const noexcept { return operand.leadRatio(); }
+        const ValuePack* leadPack() const noexcept { return operand.leadPack(); }
+        void prepare(DecimalUnit unit,DecimalRatio ratio) noexcept { operand.prepare(unit,ratio); }
+        double at(std::size_t i) const noexcept { return -operand.at(i); }
+
+        Operand operand;
+    };
+
+    inline PackTerm expr(const ValuePack& pack) noexcept { return PackTerm(pack); }
+
+    inline ArrayTerm expr(const double* values,DecimalRatio ratio,DecimalUnit unit) { return ArrayTerm(values,ratio,unit); }
+
+    ///数组求值:结果按expression.ratio()数量级写入out,单位为expression.unit()
+    ///单位不一致时返回false,不修改out
+    template<typename Derived>
+    bool evaluate(const Expression<Derived>& expression,double* out,std::size_t count) noexcept
+    {
+        const DecimalUnit unit = expression.unit();
+        if(unit == DecimalUnit::UnitNum)
+            return false;
+        Derived fused(expression.derived());
+        fused.prepare(unit,expression.ratio());
+        for(std::size_t i = 0; i < count; i++)
+            out[i] = fused.at(i);
+        return true;
+    }
+
+    namespace ExpressionDetail
+    {
+        template<typename T>
+        struct IsExpression
+        {
+            static constexpr bool value = std::is_base_of<Expression<T>,T>::value;
+        };
+
+        ///把运算符的操作数转换为表达式节点:表达式保持不变,数据包和普通数值分别包装
+        template<typename T,typename = void>
+        struct Operand;
+
+        template<typename T>
+        struct Operand<T,typename std::enable_if<IsExpression<T>::value>::type>
+        {
+            using Type = T;
+            static const T& wrap(const T& value) noexcept { return value; }
+        };
+
+        template<>
+        struct Operand<ValuePack,void>
+        {
+            using Type = PackTerm;
+            static PackTerm wrap(const ValuePack& pack) noexcept { return PackTerm(pack); }
+        };
+
+        template<typename T>
+        struct Operand<T,typename std::enable_if<std::is_arithmetic<T>::value>::type>
+        {
+            using Type = ScalarTerm;
+            static ScalarTerm wrap(T value) noexcept { return ScalarTerm(static_cast<double>(value)); }
+        };
+
+        ///加减的操作数中至少一个是表达式,另一个可以是表达式、数据包或普通数值
+        template<typename Left,typename Right>
+        using AdditiveEnable = typename std::enable_if<(IsExpression<Left>::value || IsExpression<Right>::value)
+            && (IsExpression<Left>::value || std::is_same<Left,ValuePack>::value || std::is_arithmetic<Left>::value)
+            && (IsExpression<Right>::value || std::is_same<Right,ValuePack>::value || std::is_arithmetic<Right>::value)>::type;
+
+        template<ExpressionOperator Op,typename Left,typename Right>
+        using Binary = BinaryExpression<Op,typename Operand<Left>::Type,typename Operand<Right>::Type>;
+
+        template<ExpressionOperator Op,typename Left,typename Right>
+        Binary<Op,Left,Right> make(const Left& left,const Right& right) noexcept
+        {
+            return Binary<Op,Left,Right>(Operand<Left>::wrap(left),Operand<Right>::wrap(right));
+        }
+    }
+
+    template<typename Left,typename Right,typename = ExpressionDetail::AdditiveEnable<Left,Right>>
+    ExpressionDetail::Binary<ExpressionAdd,Left,Right> operator + (const Left& left,const Right& right) noexcept
+    {
+        return ExpressionDetail::make<ExpressionAdd>(left,right);
+    }
+
+    template<typename Left,typename Right,typename = ExpressionDetail::AdditiveEnable<Left,Right>>
+    ExpressionDetail::Binary<ExpressionSub,Left,Right> operator - (const Left& left,const Right& right) noexcept
+    {
+        return ExpressionDetail::make<ExpressionSub>(left,right);
+    }
+
+    ///带单位的量只能与普通数值相乘除
+    template<typename Left,typename Right,typename = typename std::enable_if<std::is_arithmetic<Right>::value>::type>
+    BinaryExpression<ExpressionMul,Left,ScalarTerm> operator * (const Expression<Left>& left,Right right) noexcept
+    {
+        return BinaryExpression<ExpressionMul,Left,ScalarTerm>(left.derived(),ScalarTerm(right));
+    }
+
+    template<typename Left,typename Right,typename = typename std::enable_if<std::is_arithmetic<Left>::value>::type>
+    BinaryExpression<ExpressionMul,ScalarTerm,Right> operator * (Left left,const Expression<Right>& right) noexcept
+    {
+        return BinaryExpression<ExpressionMul,ScalarTerm,Right>(ScalarTerm(left),right.derived());
+    }
+
+    template<typename Left,typename Right,typename = typename std::enable_if<std::is_arithmetic<Right>::value>::type>
+    BinaryExpression<ExpressionDiv,Left,ScalarTerm> operator / (const Expression<Left>& left,Right right) noexcept
+    {
+        return BinaryExpression<ExpressionDiv,Left,ScalarTerm>(left.derived(),ScalarTerm(right));
+    }
+
+    template<typename Operand>
+    NegateExpression<Operand> operator - (const Expression<Operand>& operand) noexcept
+    {
+        return NegateExpression<Operand>(operand.derived());
+    }
+}
+
+#endif // VALUEEXPRESSION_HPP
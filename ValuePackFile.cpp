@@ -0,0 +1,528 @@
+﻿#include "ValuePackFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace UnitConvertor;
+
+static constexpr char FileMagic[4] = {'U','C','V','P'};
+static constexpr char TailMagic[4] = {'U','C','V','E'};
+static constexpr std::uint8_t FileVersion = 1;
+static constexpr std::size_t HeaderSize = 8;
+static constexpr std::size_t TailSize = 12;
+static constexpr std::size_t RawRecordSize = 10;
+static constexpr std::size_t FlushSize = 1 << 16;
+
+///紧凑编码的标记字节:低2位为数值的编码方式,第2位表示后面跟着单位,第3～5位为数量级
+enum ValueKind : std::uint8_t
+{
+    KindSame,           //与上一个数值相同
+    KindDelta,          //整数,与上一个数值之差(zigzag变长整数)
+    KindDouble          //8字节double
+};
+static constexpr std::uint8_t TagUnit = 1 << 2;
+
+///2的53次方以内的整数可以用double精确表示,差值也不会溢出int64
+static constexpr double MaxExactInteger = 9007199254740992.0;
+
+static inline bool exactInteger(double value) noexcept
+{
+    return std::abs(value) <= MaxExactInteger && value == std::trunc(value) && !(value == 0 && std::signbit(value));
+}
+
+template<typename T>
+static inline void storeLE(std::string& out,T value)
+{
+    char bytes[sizeof(T)];
+    for(std::size_t i = 0; i < sizeof(T); i++)
+        bytes[i] = static_cast<char>(static_cast<std::uint64_t>(value) >> (i * 8));
+    out.append(bytes,sizeof(T));
+}
+
+static inline void storeDouble(std::string& out,double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits,&value,sizeof(bits));
+    storeLE(out,bits);
+}
+
+template<typename T>
+static inline T loadLE(const std::uint8_t* p) noexcept
+{
+    std::uint64_t value = 0;
+    for(std::size_t i = 0; i < sizeof(T); i++)
+        value |= static_cast<std::uint64_t>(p[i]) << (i * 8);
+    return static_cast<T>(value);
+}
+
+static inline double loadDouble(const std::uint8_t* p) noexcept
+{
+    const std::uint64_t bits = loadLE<std::uint64_t>(p);
+    double value;
+    std::memcpy(&value,&bits,sizeof(value));
+    return value;
+}
+
+[[noreturn]] static void corrupted()
+{
+    throw std::invalid_argument("UnitConvertor::ValuePackReader: corrupted data");
+}
+
+ValuePackWriter::ValuePackWriter(std::ostream &out, SerialEncoding encoding, std::uint32_t blockSize)
+    : m_Out(out),m_Encoding(encoding),m_BlockSize(blockSize == 0 ? 1 : blockSize)
+{
+    m_Buffer.reserve(FlushSize + 64);
+    m_Buffer.append(FileMagic,sizeof(FileMagic));
+    m_Buffer.push_back(static_cast<char>(FileVersion));
+    m_Buffer.push_back(static_cast<char>(encoding));
+    storeLE(m_Buffer,std::uint16_t(0));
+}
+
+ValuePackWriter::~ValuePackWriter()
+{
+    try
+    {
+        finish();
+    }
+    catch(...)
+    {
+    }
+}
+
+void ValuePackWriter::append(const ValuePack &pack)
+{
+    appendRecord(pack.value(),static_cast<std::uint8_t>(pack.ratio()),static_cast<std::uint8_t>(pack.unit()));
+}
+
+void ValuePackWriter::append(const ValuePack *packs, std::size_t count)
+{
+    for(std::size_t i = 0; i < count; i++)
+        append(packs[i]);
+}
+
+void ValuePackWriter::append(const ValueColumn &column)
+{
+    for(std::size_t i = 0; i < column.size(); i++)
+        appendRecord(column.values[i],column.ratios[i],column.units[i]);
+}
+
+void ValuePackWriter::appendRecord(double value, std::uint8_t ratio, std::uint8_t unit)
+{
+    if(m_Finished)
+        throw std::logic_error("UnitConvertor::ValuePackWriter: append after finish");
+
+    if(m_Count % m_BlockSize == 0)
+    {
+        //新的一块:记录起始偏移并复位编码状态
+        m_BlockOffsets.push_back(m_Written + m_Buffer.size());
+        m_Previous = 0;
+        m_Unit = -1;
+    }
+    m_UsedUnits[unit] = true;
+
+    if(m_Encoding == SerialRaw)
+    {
+        m_Buffer.push_back(static_cast<char>(unit));
+        m_Buffer.push_back(static_cast<char>(ratio));
+        storeDouble(m_Buffer,value);
+    }
+    else
+    {
+        std::uint8_t tag = static_cast<std::uint8_t>(ratio << 3);
+        if(unit != m_Unit)
+            tag |= TagUnit;
+        if(std::memcmp(&value,&m_Previous,sizeof(value)) == 0)
+            tag |= KindSame;
+        else if(exactInteger(value) && exactInteger(m_Previous))
+            tag |= KindDelta;
+        else
+            tag |= KindDouble;
+
+        m_Buffer.push_back(static_cast<char>(tag));
+        if(tag & TagUnit)
+            m_Buffer.push_back(static_cast<char>(unit));
+        if((tag & 3) == KindDelta)
+        {
+            const std::int64_t delta = static_cast<std::int64_t>(value) - static_cast<std::int64_t>(m_Previous);
+            std::uint64_t zigzag = (static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63);
+            while(zigzag >= 0x80)
+            {
+                m_Buffer.push_back(static_cast<char>(zigzag | 0x80));
+                zigzag >>= 7;
+            }
+            m_Buffer.push_back(static_cast<char>(zigzag));
+        }
+        else if((tag & 3) == KindDouble)
+        {
+            storeDouble(m_Buffer,value);
+        }
+        m_Previous = value;
+        m_Unit = unit;
+    }
+
+    ++m_Count;
+    if(m_Buffer.size() >= FlushSize)
+        flush();
+}
+
+void ValuePackWriter::flush()
+{
+    m_Out.write(m_Buffer.data(),static_cast<std::streamsize>(m_Buffer.size()));
+    if(!m_Out)
+        throw std::runtime_error("UnitConvertor::ValuePackWriter: write failed");
+    m_Written += m_Buffer.size();
+    m_Buffer.clear();
+}
+
+void ValuePackWriter::finish()
+{
+    if(m_Finished)
+        return;
+    m_Finished = true;
+
+    const std::uint64_t footerOffset = m_Written + m_Buffer.size();
+    std::uint32_t unitCount = 0;
+    for(bool used : m_UsedUnits)
+        unitCount += used;
+
+    storeLE(m_Buffer,static_cast<std::uint64_t>(m_Count));
+    storeLE(m_Buffer,m_BlockSize);
+    storeLE(m_Buffer,static_cast<std::uint32_t>(m_BlockOffsets.size()));
+    storeLE(m_Buffer,unitCount);
+    for(int unit = 0; unit < 256; unit++)
+    {
+        if(!m_UsedUnits[unit])
+            continue;
+        const UnitProperty p = generateUnitProperty(static_cast<DecimalUnit>(unit));
+        const std::string_view name = unitName(static_cast<DecimalUnit>(unit)).substr(0,255);
+        m_Buffer.push_back(static_cast<char>(unit));
+        m_Buffer.push_back(static_cast<char>(p.minRatio));
+        m_Buffer.push_back(static_cast<char>(p.maxRatio));
+        m_Buffer.push_back(static_cast<char>(name.size()));
+        storeDouble(m_Buffer,p.Exp);
+        m_Buffer.append(name.data(),name.size());
+    }
+    for(std::uint64_t offset : m_BlockOffsets)
+        storeLE(m_Buffer,offset);
+    storeLE(m_Buffer,footerOffset);
+    m_Buffer.append(TailMagic,sizeof(TailMagic));
+    flush();
+    m_Out.flush();
+}
+
+ValuePackReader::ValuePackReader(const void *data, std::size_t size)
+    : m_Data(static_cast<const std::uint8_t*>(data))
+{
+    const std::uint8_t* bytes = m_Data;
+    if(size < HeaderSize + TailSize || std::memcmp(bytes,FileMagic,sizeof(FileMagic)) != 0 || std::memcmp(bytes + size - sizeof(TailMagic),TailMagic,sizeof(TailMagic)) != 0)
+        throw std::invalid_argument("UnitConvertor::ValuePackReader: not a ValuePack stream");
+    if(bytes[4] != FileVersion || bytes[5] > SerialCompact)
+        throw std::invalid_argument("UnitConvertor::ValuePackReader: unsupported version or encoding");
+    m_Encoding = static_cast<SerialEncoding>(bytes[5]);
+
+    const std::uint64_t footerOffset = loadLE<std::uint64_t>(bytes + size - TailSize);
+    if(footerOffset < HeaderSize || footerOffset > size - TailSize)
+        corrupted();
+    m_DataEnd = bytes + footerOffset;
+
+    //按顺序读取文件尾,每次读取之前检查剩余长度
+    const std::uint8_t* pos = m_DataEnd;
+    const std::uint8_t* const footerEnd = bytes + size - TailSize;
+    auto need = [&](std::size_t n){ if(static_cast<std::size_t>(footerEnd - pos) < n) corrupted(); };
+    need(20);
+    const std::uint64_t count = loadLE<std::uint64_t>(pos);
+    m_BlockSize = loadLE<std::uint32_t>(pos + 8);
+    const std::uint32_t blockCount = loadLE<std::uint32_t>(pos + 12);
+    const std::uint32_t unitCount = loadLE<std::uint32_t>(pos + 16);
+    pos += 20;
+    if(m_BlockSize == 0 || count > SIZE_MAX || blockCount != (count + m_BlockSize - 1) / m_BlockSize || unitCount > 256)
+        corrupted();
+    m_Count = static_cast<std::size_t>(count);
+
+    //写入时的单位按照字符串对应到当前进程,内置单位的枚举值是固定的
+    std::memset(m_UnitMap,Null,sizeof(m_UnitMap));
+    for(std::uint32_t i = 0; i < unitCount; i++)
+    {
+        need(12);
+        SerialUnit unit;
+        unit.recordedUnit = pos[0];
+        unit.minRatio = static_cast<DecimalRatio>(pos[1]);
+        unit.maxRatio = static_cast<DecimalRatio>(pos[2]);
+        const std::size_t nameLen = pos[3];
+        unit.exp = loadDouble(pos + 4);
+        pos += 12;
+        need(nameLen);
+        unit.name.assign(reinterpret_cast<const char*>(pos),nameLen);
+        pos += nameLen;
+        if(unit.recordedUnit < UnitNum)
+            unit.unit = static_cast<DecimalUnit>(unit.recordedUnit);
+        else if(!unit.name.empty())
+        {
+            const DecimalUnit local = findUnit(unit.name);
+            unit.unit = local == UnitNum ? Null : local;
+        }
+        m_UnitMap[unit.recordedUnit] = unit.unit;
+        m_Units.push_back(std::move(unit));
+    }
+
+    need(8 * static_cast<std::size_t>(blockCount));
+    m_BlockOffsets.resize(blockCount);
+    std::uint64_t previous = HeaderSize;
+    for(std::uint32_t i = 0; i < blockCount; i++)
+    {
+        m_BlockOffsets[i] = loadLE<std::uint64_t>(pos + 8 * i);
+        if(m_BlockOffsets[i] < previous || m_BlockOffsets[i] > footerOffset)
+            corrupted();
+        previous = m_BlockOffsets[i];
+    }
+
+    //定长记录首尾相连,数据长度和每一块的起始位置都由记录个数决定,cursorAt直接按照这个规则计算位置
+    if(m_Encoding == SerialRaw)
+    {
+        const std::uint64_t dataSize = footerOffset - HeaderSize;
+        if(dataSize % RawRecordSize != 0 || dataSize / RawRecordSize != count)
+            corrupted();
+        for(std::uint32_t i = 0; i < blockCount; i++)
+            if(m_BlockOffsets[i] != HeaderSize + static_cast<std::uint64_t>(i) * m_BlockSize * RawRecordSize)
+                corrupted();
+    }
+}
+
+ValuePackReader::Cursor ValuePackReader::cursorAt(std::size_t index) const
+{
+    Cursor cursor;
+    const std::size_t block = index / m_BlockSize;
+    if(block >= m_BlockOffsets.size())
+    {
+        cursor.pos = m_DataEnd;
+        cursor.index = m_Count;
+        return cursor;
+    }
+    cursor.index = block * m_BlockSize;
+    if(m_Encoding == SerialRaw)
+    {
+        //定长记录直接计算位置
+        cursor.pos = m_Data + m_BlockOffsets[block] + (index - cursor.index) * RawRecordSize;
+        cursor.index = index;
+        return cursor;
+    }
+    cursor.pos = m_Data + m_BlockOffsets[block];
+    while(cursor.index < index)
+        next(cursor);
+    return cursor;
+}
+
+void ValuePackReader::next(Cursor &cursor) const
+{
+    const std::uint8_t* pos = cursor.pos;
+    if(pos > m_DataEnd)
+        corrupted();
+    const std::size_t left = static_cast<std::size_t>(m_DataEnd - pos);
+    if(m_Encoding == SerialRaw)
+    {
+        if(left < RawRecordSize || pos[1] >= RatioNum)
+            corrupted();
+        cursor.unit = m_UnitMap[pos[0]];
+        cursor.ratio = pos[1];
+        cursor.value = loadDouble(pos + 2);
+        cursor.pos = pos + RawRecordSize;
+        ++cursor.index;
+        return;
+    }
+
+    if(cursor.index % m_BlockSize == 0)
+        cursor.value = 0;
+    if(left == 0)
+        corrupted();
+    const std::uint8_t tag = *pos++;
+    const std::uint8_t ratio = (tag >> 3) & 7;
+    if(ratio >= RatioNum || (tag >> 6) != 0)
+        corrupted();
+    cursor.ratio = ratio;
+    if(tag & TagUnit)
+    {
+        if(pos == m_DataEnd)
+            corrupted();
+        cursor.unit = m_UnitMap[*pos++];
+    }
+    else if(cursor.index % m_BlockSize == 0)
+    {
+        corrupted();        //每一块的第一个记录总是带有单位
+    }
+
+    switch (tag & 3)
+    {
+    case KindSame:
+        break;
+    case KindDelta:
+    {
+        std::uint64_t zigzag = 0;
+        for(int shift = 0;; shift += 7)
+        {
+            if(pos == m_DataEnd || shift > 63)
+                corrupted();
+            const std::uint8_t byte = *pos++;
+            zigzag |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80))
+                break;
+        }
+        if(!exactInteger(cursor.value))
+            corrupted();
+        const std::uint64_t delta = (zigzag >> 1) ^ (0 - (zigzag & 1));
+        cursor.value = static_cast<double>(static_cast<std::int64_t>(static_cast<std::uint64_t>(static_cast<std::int64_t>(cursor.value)) + delta));
+        break;
+    }
+    case KindDouble:
+        if(static_cast<std::size_t>(m_DataEnd - pos) < 8)
+            corrupted();
+        cursor.value = loadDouble(pos);
+        pos += 8;
+        break;
+    default:
+        corrupted();
+    }
+    cursor.pos = pos;
+    ++cursor.index;
+}
+
+ValuePack ValuePackReader::at(std::size_t index) const
+{
+    if(index >= m_Count)
+        throw std::out_of_range("UnitConvertor::ValuePackReader::at");
+    Cursor cursor = cursorAt(index);
+    next(cursor);
+    return ValuePack(cursor.value,static_cast<DecimalRatio>(cursor.ratio),static_cast<DecimalUnit>(cursor.unit));
+}
+
+std::size_t ValuePackReader::read(std::size_t first, std::size_t count, double *values, std::uint8_t *ratios, std::uint8_t *units) const
+{
+    if(first >= m_Count)
+        return 0;
+    count = std::min(count,m_Count - first);
+    Cursor cursor = cursorAt(first);
+    for(std::size_t i = 0; i < count; i++)
+    {
+        next(cursor);
+        values[i] = cursor.value;
+        ratios[i] = cursor.ratio;
+        units[i] = cursor.unit;
+    }
+    return count;
+}
+
+void ValuePackReader::read(ValueColumn &column) const
+{
+    column.resize(m_Count);
+    read(0,m_Count,column.values.data(),column.ratios.data(),column.units.data());
+    std::fill(column.flags.begin(),column.flags.end(),std::uint8_t(ParseOk));
+}
+
+ValuePackReader::Iterator ValuePackReader::begin() const
+{
+    Iterator it;
+    it.m_Reader = this;
+    it.m_Cursor = cursorAt(0);
+    if(m_Count > 0)
+    {
+        next(it.m_Cursor);
+        it.m_Pack = ValuePack(it.m_Cursor.value,static_cast<DecimalRatio>(it.m_Cursor.ratio),static_cast<DecimalUnit>(it.m_Cursor.unit));
+    }
+    return it;
+}
+
+ValuePackReader::Iterator ValuePackReader::end() const
+{
+    Iterator it;
+    it.m_Reader = this;
+    it.m_Index = m_Count;
+    return it;
+}
+
+ValuePackReader::Iterator &ValuePackReader::Iterator::operator++()
+{
+    if(++m_Index < m_Reader->m_Count)
+    {
+        m_Reader->next(m_Cursor);
+        m_Pack = ValuePack(m_Cursor.value,static_cast<DecimalRatio>(m_Cursor.ratio),static_cast<DecimalUnit>(m_Cursor.unit));
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path)
+{
+    m_File = CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+    LARGE_INTEGER size;
+    if(m_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_File,&size))
+    {
+        if(m_File != INVALID_HANDLE_VALUE)
+            CloseHandle(m_File);
+        throw std::runtime_error("UnitConvertor::MappedFile: cannot open " + path);
+    }
+    m_Size = static_cast<std::size_t>(size.QuadPart);
+    if(m_Size == 0)
+        return;
+    m_Mapping = CreateFileMappingA(m_File,nullptr,PAGE_READONLY,0,0,nullptr);
+    m_Data = m_Mapping == nullptr ? nullptr : MapViewOfFile(m_Mapping,FILE_MAP_READ,0,0,0);
+    if(m_Data == nullptr)
+    {
+        if(m_Mapping != nullptr)
+            CloseHandle(m_Mapping);
+        CloseHandle(m_File);
+        throw std::runtime_error("UnitConvertor::MappedFile: cannot map " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_Data != nullptr)
+        UnmapViewOfFile(m_Data);
+    if(m_Mapping != nullptr)
+        CloseHandle(m_Mapping);
+    CloseHandle(m_File);
+}
+#else
+MappedFile::MappedFile(const std::string &path)
+{
+    const int fd = ::open(path.c_str(),O_RDONLY);
+    struct stat st;
+    if(fd < 0 || ::fstat(fd,&st) != 0)
+    {
+        if(fd >= 0)
+            ::close(fd);
+        throw std::runtime_error("UnitConvertor::MappedFile: cannot open " + path);
+    }
+    m_Size = static_cast<std::size_t>(st.st_size);
+    if(m_Size != 0)
+    {
+        void* data = ::mmap(nullptr,m_Size,PROT_READ,MAP_PRIVATE,fd,0);
+        if(data == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("UnitConvertor::MappedFile: cannot map " + path);
+        }
+        m_Data = data;
+    }
+    ::close(fd);        //映射建立之后不再需要文件描述符
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_Data != nullptr)
+        ::munmap(const_cast<void*>(m_Data),m_Size);
+}
+#endif
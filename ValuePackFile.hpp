@@ -0,0 +1,183 @@
+﻿#ifndef VALUEPACKFILE_HPP
+#define VALUEPACKFILE_HPP
+
+#include "UnitConvertor.hpp"
+
+#include <iosfwd>
+#include <iterator>
+
+///ValuePack序列的二进制格式(所有整数为小端序):
+///  文件头  "UCVP"、版本(1字节)、编码方式(1字节)、保留(2字节)
+///  数据块  每blockSize个记录为一块,每块开始时解码状态复位,所以可以从任意一块开始解码
+///  文件尾  记录个数(8)、blockSize(4)、块数(4)、单位个数(4)、单位表、每一块的起始偏移(8 × 块数)
+///  结尾    文件尾的偏移(8)、"UCVE"
+///单位表保存每个用到的单位的枚举值、数量级范围、进制和单位字符串,读取时按照字符串对应到当前进程中的单位
+///文件尾写在最后,所以写入时不需要预先知道记录个数,可以边采集边写入
+namespace UnitConvertor
+{
+    enum SerialEncoding : std::uint8_t
+    {
+        SerialRaw,          //每个记录固定10字节:单位、数量级、double
+        SerialCompact       //每个记录1字节标记,单位和数量级只在变化时写出;数值与上一个相同时不写,整数值写成与上一个值之差的变长整数,其他数值写8字节double
+    };
+
+    ///写入ValuePack序列,数据先放在内部缓冲区中,攒够一定大小之后再写入out
+    ///写入失败时抛出std::runtime_error
+    class ValuePackWriter
+    {
+    public:
+        explicit ValuePackWriter(std::ostream& out,SerialEncoding encoding = SerialCompact,std::uint32_t blockSize = 4096);
+
+        ///没有调用finish()时在析构时调用,析构时的写入错误会被忽略
+        ~ValuePackWriter();
+
+        ValuePackWriter(const ValuePackWriter&) = delete;
+        ValuePackWriter& operator = (const ValuePackWriter&) = delete;
+
+        void append(const ValuePack& pack);
+
+        void append(const ValuePack* packs,std::size_t count);
+
+        void append(const ValueColumn& column);
+
+        ///写出剩余的数据和文件尾,之后不能再调用append(抛出std::logic_error)
+        void finish();
+
+        ///已经写入的记录个数
+        std::size_t size() const noexcept { return m_Count; }
+
+    private:
+        void appendRecord(double value,std::uint8_t ratio,std::uint8_t unit);
+        void flush();
+
+        std::ostream& m_Out;
+        SerialEncoding m_Encoding;
+        std::uint32_t m_BlockSize;
+        std::size_t m_Count = 0;
+        std::uint64_t m_Written = 0;        //已经写入m_Out的字节数
+        std::string m_Buffer;
+        std::vector<std::uint64_t> m_BlockOffsets;
+        bool m_UsedUnits[256] = {};
+        double m_Previous = 0;
+        int m_Unit = -1;
+        bool m_Finished = false;
+    };
+
+    ///文件中单位表的一项
+    struct SerialUnit
+    {
+        std::uint8_t recordedUnit = Null;   //写入时的枚举值
+        DecimalUnit unit = Null;            //当前进程中对应的单位,找不到同名的单位时为Null
+        DecimalRatio minRatio = One;
+        DecimalRatio maxRatio = One;
+        double exp = 1000;
+        std::string name;
+    };
+
+    ///直接在一块内存(例如MappedFile)上读取ValuePackWriter写出的数据,不复制数据
+    ///构造时只检查文件头和文件尾,格式错误或者数据被截断时抛出std::invalid_argument;解码时发现数据损坏同样抛出std::invalid_argument
+    ///注册的单位需要在构造之前注册,否则读出的单位为Null
+    class ValuePackReader
+    {
+    public:
+        class Iterator;
+
+        ValuePackReader(const void* data,std::size_t size);
+
+        std::size_t size() const noexcept { return m_Count; }
+
+        SerialEncoding encoding() const noexcept { return m_Encoding; }
+
+        const std::vector<SerialUnit>& units() const noexcept { return m_Units; }
+
+        ///第index个记录,从所在块的开始解码;index超出范围时抛出std::out_of_range
+        ValuePack at(std::size_t index) const;
+
+        ///从第first个记录开始解码最多count个记录到数组中,返回实际解码的个数
+        std::size_t read(std::size_t first,std::size_t count,double* values,std::uint8_t* ratios,std::uint8_t* units) const;
+
+        ///解码全部记录,column被调整为size()大小,flags全部为ParseOk
+        void read(ValueColumn& column) const;
+
+        Iterator begin() const;
+        Iterator end() const;
+
+    private:
+        ///解码位置:pos指向第index个记录,value、ratio、unit为上一个记录解码之后的状态
+        struct Cursor
+        {
+            const std::uint8_t* pos = nullptr;
+            std::size_t index = 0;
+            double value = 0;
+            std::uint8_t ratio = One;
+            std::uint8_t unit = Null;
+        };
+
+        Cursor cursorAt(std::size_t index) const;
+
+        ///解码cursor指向的记录并前进到下一个记录
+        void next(Cursor& cursor) const;
+
+        const std::uint8_t* m_Data;
+        const std::uint8_t* m_DataEnd;      //数据块的结尾(文件尾的开始)
+        std::size_t m_Count = 0;
+        std::uint32_t m_BlockSize = 1;
+        SerialEncoding m_Encoding = SerialRaw;
+        std::vector<std::uint64_t> m_BlockOffsets;
+        std::vector<SerialUnit> m_Units;
+        std::uint8_t m_UnitMap[256] = {};   //写入时的枚举值到当前进程中枚举值的映射
+    };
+
+    ///按照顺序解码的迭代器,每次递增只解码一个记录
+    class ValuePackReader::Iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = ValuePack;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ValuePack*;
+        using reference = const ValuePack&;
+
+        Iterator() = default;
+
+        const ValuePack& operator*() const noexcept { return m_Pack; }
+        const ValuePack* operator->() const noexcept { return &m_Pack; }
+
+        Iterator& operator++();
+
+        bool operator == (const Iterator& other) const noexcept { return m_Index == other.m_Index; }
+        bool operator != (const Iterator& other) const noexcept { return !(*this == other); }
+
+    private:
+        friend class ValuePackReader;
+
+        const ValuePackReader* m_Reader = nullptr;
+        Cursor m_Cursor;
+        std::size_t m_Index = 0;
+        ValuePack m_Pack;
+    };
+
+    ///以只读方式把整个文件映射到内存,用于ValuePackReader;打开或映射失败时抛出std::runtime_error
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+
+        const void* data() const noexcept { return m_Data; }
+        std::size_t size() const noexcept { return m_Size; }
+
+    private:
+        const void* m_Data = nullptr;
+        std::size_t m_Size = 0;
+#ifdef _WIN32
+        void* m_File = nullptr;
+        void* m_Mapping = nullptr;
+#endif
+    };
+}
+
+#endif // VALUEPACKFILE_HPP
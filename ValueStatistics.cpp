@@ -0,0 +1,128 @@
+﻿#include "ValueStatistics.hpp"
+
+#include <algorithm>
+
+using namespace UnitConvertor;
+
+ValueStatistics::ValueStatistics(DecimalUnit unit)
+    : m_Unit(unit)
+{
+    //与ratioTo使用同一张系数表,注册的单位也一样
+    for(int ratio = 0; ratio < RatioNum; ratio++)
+        m_Factors[ratio] = conversionFactor(unit,static_cast<DecimalRatio>(ratio),One);
+}
+
+void ValueStatistics::add(const ValuePack &pack) noexcept
+{
+    if(pack.unit() != m_Unit)
+    {
+        ++m_Skipped;
+        return;
+    }
+    add(pack.value(),pack.ratio());
+}
+
+void ValueStatistics::add(double value, DecimalRatio ratio) noexcept
+{
+    const double base = value * m_Factors[std::min<int>(ratio,RatioNum - 1)];
+    if(std::isnan(base))
+        ++m_Skipped;
+    else
+        m_Summary.add(base);
+}
+
+void ValueStatistics::add(const double *values, std::size_t count, DecimalRatio ratio) noexcept
+{
+    const ColumnSummary part = summarize(values,count,m_Factors[std::min<int>(ratio,RatioNum - 1)]);
+    m_Skipped += count - part.count;
+    m_Summary.merge(part);
+}
+
+void ValueStatistics::add(const double *values, const std::uint8_t *ratios, std::size_t count) noexcept
+{
+    //先在栈上的缓冲区中换算到基本数量级,再交给向量化的统计
+    double buffer[1024];
+    for(std::size_t begin = 0; begin < count; begin += 1024)
+    {
+        const std::size_t n = std::min<std::size_t>(1024,count - begin);
+        for(std::size_t i = 0; i < n; i++)
+            buffer[i] = values[begin + i] * m_Factors[std::min<std::uint8_t>(ratios[begin + i],RatioNum - 1)];
+        add(buffer,n,One);
+    }
+}
+
+void ValueStatistics::add(const ValueColumn &column) noexcept
+{
+    const std::size_t count = column.size();
+    for(std::size_t begin = 0; begin < count;)
+    {
+        std::size_t end = begin + 1;
+        while(end < count && column.units[end] == column.units[begin])
+            ++end;
+        if(column.units[begin] == m_Unit)
+            add(column.values.data() + begin,column.ratios.data() + begin,end - begin);
+        else
+            m_Skipped += end - begin;
+        begin = end;
+    }
+}
+
+void ValueStatistics::merge(const ValueStatistics &other) noexcept
+{
+    if(other.m_Unit != m_Unit)
+    {
+        m_Skipped += other.count() + other.skipped();
+        return;
+    }
+    m_Summary.merge(other.m_Summary);
+    m_Skipped += other.m_Skipped;
+}
+
+void ValueStatistics::reset() noexcept
+{
+    m_Summary = ColumnSummary();
+    m_Skipped = 0;
+}
+
+ValuePack ValueStatistics::fromBase(double value) const noexcept
+{
+    //基本数量级超出单位的范围时先换算到允许的最小数量级
+    const DecimalRatio ratio = limitRatio(m_Unit,One);
+    return proper(ValuePack(value / m_Factors[ratio],ratio,m_Unit));
+}
+
+ValuePack ValueStatistics::min() const noexcept
+{
+    return fromBase(count() == 0 ? 0 : m_Summary.min);
+}
+
+ValuePack ValueStatistics::max() const noexcept
+{
+    return fromBase(count() == 0 ? 0 : m_Summary.max);
+}
+
+ValuePack ValueStatistics::mean() const noexcept
+{
+    return fromBase(m_Summary.mean);
+}
+
+ValuePack ValueStatistics::sum() const noexcept
+{
+    return fromBase(m_Summary.sum + m_Summary.compensation);
+}
+
+ValuePack ValueStatistics::rms() const noexcept
+{
+    //均方值 = 方差 + 均值的平方,两项都不小于0,不会因为相减损失精度
+    return fromBase(count() == 0 ? 0 : std::sqrt(variance() + m_Summary.mean * m_Summary.mean));
+}
+
+ValuePack ValueStatistics::stddev() const noexcept
+{
+    return fromBase(std::sqrt(variance()));
+}
+
+double ValueStatistics::variance() const noexcept
+{
+    return count() == 0 ? 0 : m_Summary.m2 / static_cast<double>(count());
+}
@@ -0,0 +1,64 @@
+﻿#ifndef VALUESTATISTICS_HPP
+#define VALUESTATISTICS_HPP
+
+#include "UnitConvertor.hpp"
+
+namespace UnitConvertor
+{
+    ///单一单位的数值序列的流式统计:接受任意数量级的数值,换算到基本数量级(One)之后累加,只遍历一次数据
+    ///逐个添加时使用Welford算法,数组使用summarize的向量化实现;多个线程各自统计之后可以用merge合并
+    ///单位不同的数据包和NaN不参与统计,计入skipped()
+    class ValueStatistics
+    {
+    public:
+        explicit ValueStatistics(DecimalUnit unit);
+
+        void add(const ValuePack& pack) noexcept;
+
+        void add(double value,DecimalRatio ratio) noexcept;
+
+        ///count个数量级都为ratio的数值
+        void add(const double* values,std::size_t count,DecimalRatio ratio) noexcept;
+
+        ///count个数值,数量级分别为ratios
+        void add(const double* values,const std::uint8_t* ratios,std::size_t count) noexcept;
+
+        ///column中单位为unit()的数值
+        void add(const ValueColumn& column) noexcept;
+
+        ///合并另一个统计结果,单位不同时只把它的个数计入skipped()
+        void merge(const ValueStatistics& other) noexcept;
+
+        void reset() noexcept;
+
+        DecimalUnit unit() const noexcept { return m_Unit; }
+
+        std::size_t count() const noexcept { return m_Summary.count; }
+
+        std::size_t skipped() const noexcept { return m_Skipped; }
+
+        ///以下结果都已经转换为恰当的数量级(proper),没有数据时为0
+        ValuePack min() const noexcept;
+        ValuePack max() const noexcept;
+        ValuePack mean() const noexcept;
+        ValuePack sum() const noexcept;
+        ValuePack rms() const noexcept;
+        ValuePack stddev() const noexcept;          //总体标准差
+
+        ///总体方差,单位为基本数量级的平方
+        double variance() const noexcept;
+
+        ///基本数量级下的原始统计量
+        const ColumnSummary& summary() const noexcept { return m_Summary; }
+
+    private:
+        ValuePack fromBase(double value) const noexcept;
+
+        DecimalUnit m_Unit;
+        double m_Factors[RatioNum];     //各个数量级换算到One的系数
+        ColumnSummary m_Summary;
+        std::size_t m_Skipped = 0;
+    };
+}
+
+#endif // VALUESTATISTICS_HPP
@@ -0,0 +1,169 @@
+﻿///启动时间和第一次转换的延迟,只能在新进程中测量,所以每个样本都重新启动一次自身(POSIX)
+///编译: g++ -std=c++17 -O2 -pthread -I.. StartupBenchmark.cpp ../UnitConvertor.cpp -o ucstartup
+///用法: ucstartup [--runs N]
+///  startup           启动一个链接了库的进程直到退出的时间
+///  first call        新进程中第一次tryFromString + toString的时间,对比之后的第二次调用
+///  warmUp            warmUp本身的时间,以及调用它之后的第一次转换
+///输出每项的中位数和90%分位数(ns)
+
+#include "UnitConvertor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace Uc = UnitConvertor;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double elapsedNs(Clock::time_point begin)
+{
+    return std::chrono::duration<double,std::nano>(Clock::now() - begin).count();
+}
+
+///一次完整的转换:解析一个字符串再格式化到缓冲区
+double convertOnce()
+{
+    char buffer[64];
+    const Clock::time_point begin = Clock::now();
+    const ValuePack pack = Uc::tryFromString("12.5 kHz").pack;
+    const std::size_t length = Uc::toString(pack,buffer,sizeof(buffer));
+    const double ns = elapsedNs(begin);
+    if(length == Uc::FormatFailed)
+        std::exit(1);
+    return ns;
+}
+
+///子进程:按照mode测量并把结果写到stdout,每个数值一行
+int runChild(const std::string& mode)
+{
+    if(mode == "cold")
+    {
+        const double first = convertOnce();
+        std::printf("%.0f\n%.0f\n",first,convertOnce());
+    }
+    else if(mode == "warm")
+    {
+        const Clock::time_point begin = Clock::now();
+        Uc::warmUp();
+        const double warmUp = elapsedNs(begin);
+        std::printf("%.0f\n%.0f\n",warmUp,convertOnce());
+    }
+    return 0;
+}
+
+///启动子进程并等待它退出,返回它的输出,wallNs为从启动到退出的时间
+std::vector<double> spawnChild(const char* self,const char* mode,double& wallNs)
+{
+    int fds[2];
+    if(pipe(fds) != 0)
+    {
+        std::perror("pipe");
+        std::exit(1);
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions,fds[1],STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions,fds[0]);
+
+    char* argv[] = {const_cast<char*>(self),const_cast<char*>("--child"),const_cast<char*>(mode),nullptr};
+    pid_t pid = 0;
+    const Clock::time_point begin = Clock::now();
+    if(posix_spawn(&pid,self,&actions,nullptr,argv,environ) != 0)
+    {
+        std::perror("posix_spawn");
+        std::exit(1);
+    }
+    close(fds[1]);
+    std::string output;
+    char chunk[256];
+    ssize_t n;
+    while((n = read(fds[0],chunk,sizeof(chunk))) > 0)
+        output.append(chunk,static_cast<std::size_t>(n));
+    int status = 0;
+    waitpid(pid,&status,0);
+    wallNs = elapsedNs(begin);
+    close(fds[0]);
+    posix_spawn_file_actions_destroy(&actions);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::fprintf(stderr,"child %s failed\n",mode);
+        std::exit(1);
+    }
+
+    std::vector<double> values;
+    const char* pos = output.c_str();
+    char* end = nullptr;
+    for(double value = std::strtod(pos,&end); end != pos; value = std::strtod(pos,&end))
+    {
+        values.push_back(value);
+        pos = end;
+    }
+    return values;
+}
+
+void report(const char* name,std::vector<double> samples)
+{
+    std::sort(samples.begin(),samples.end());
+    const double median = samples[samples.size() / 2];
+    const double p90 = samples[std::min(samples.size() - 1,samples.size() * 9 / 10)];
+    std::printf("%-36s %12.0f %12.0f\n",name,median,p90);
+}
+}
+
+int main(int argc,char** argv)
+{
+    if(argc == 3 && std::strcmp(argv[1],"--child") == 0)
+        return runChild(argv[2]);
+
+    int runs = 50;
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i],"--runs") == 0 && i + 1 < argc)
+            runs = std::max(1,std::atoi(argv[++i]));
+        else
+        {
+            std::fprintf(stderr,"usage: ucstartup [--runs N]\n");
+            return 2;
+        }
+    }
+
+    std::vector<double> startup, first, second, warmUp, afterWarmUp;
+    for(int i = 0; i < runs; i++)
+    {
+        double wall = 0;
+        spawnChild(argv[0],"idle",wall);
+        startup.push_back(wall);
+        std::vector<double> cold = spawnChild(argv[0],"cold",wall);
+        std::vector<double> warm = spawnChild(argv[0],"warm",wall);
+        if(cold.size() != 2 || warm.size() != 2)
+        {
+            std::fprintf(stderr,"unexpected child output\n");
+            return 1;
+        }
+        first.push_back(cold[0]);
+        second.push_back(cold[1]);
+        warmUp.push_back(warm[0]);
+        afterWarmUp.push_back(warm[1]);
+    }
+
+    std::printf("%-36s %12s %12s\n","benchmark","median ns","p90 ns");
+    report("startup/process",startup);
+    report("first call/cold",first);
+    report("first call/second call",second);
+    report("warmUp",warmUp);
+    report("first call/after warmUp",afterWarmUp);
+    return 0;
+}
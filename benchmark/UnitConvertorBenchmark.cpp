@@ -0,0 +1,917 @@
+﻿///UnitConvertor热点函数的性能测试,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -pthread -I.. UnitConvertorBenchmark.cpp ../UnitConvertor.cpp ../ParallelConvertor.cpp ../ConvertCache.cpp ../ReadoutFormatter.cpp ../ExactValue.cpp ../SortedIndex.cpp ../ConvertStats.cpp ../ValuePackFile.cpp ../StreamParser.cpp ../ValueStatistics.cpp -o ucbench
+///      加上-DUNITCONVERTOR_ENABLE_STATS可以测量打开统计之后的开销,加上-DUNITCONVERTOR_INLINE可以测量热点函数内联之后的效果
+///用法: ucbench [--filter 名称片段] [--json 输出文件] [--compare 基准文件] [--min-time 秒]
+///每个测试输出ns/op、每次操作的内存申请次数和吞吐量;--json输出机器可读的结果,每行一个测试,
+///baseline.json是提交到仓库中的基准结果,热点函数变慢时重新生成的结果与它的差异可以直接在diff中看到
+
+#include "UnitConvertor.hpp"
+#include "ConvertCache.hpp"
+#include "ExactValue.hpp"
+#include "ParallelConvertor.hpp"
+#include "ReadoutFormatter.hpp"
+#include "SortedIndex.hpp"
+#include "StreamParser.hpp"
+#include "ValueExpression.hpp"
+#include "ValueStatistics.hpp"
+#include "ValuePackFile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+///统计内存申请次数,替换全部的operator new/delete(普通、数组、对齐、nothrow),对齐的申请(例如alignas(64)的CacheShard)同样计数
+static std::atomic<std::size_t> AllocationCount{0};
+
+///malloc返回的地址已经满足的对齐值,超过它时才需要专门的对齐申请
+static constexpr std::size_t MallocAlignment = alignof(std::max_align_t);
+
+///申请和释放放在不内联的函数中,否则GCC内联operator delete之后会把free与operator new配对而报告-Wmismatched-new-delete
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+static void* countedAllocate(std::size_t size,std::size_t alignment) noexcept
+{
+    AllocationCount.fetch_add(1,std::memory_order_relaxed);
+    if(size == 0)
+        size = 1;
+    if(alignment <= MallocAlignment)
+        return std::malloc(size);
+#if defined(_MSC_VER)
+    return _aligned_malloc(size,alignment);
+#else
+    //aligned_alloc要求大小是对齐值的整数倍
+    return std::aligned_alloc(alignment,(size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+static void countedRelease(void* p,std::size_t alignment) noexcept
+{
+#if defined(_MSC_VER)
+    if(alignment > MallocAlignment)
+    {
+        _aligned_free(p);
+        return;
+    }
+#else
+    (void)alignment;
+#endif
+    std::free(p);
+}
+
+static void* countedNew(std::size_t size,std::size_t alignment = MallocAlignment)
+{
+    if(void* p = countedAllocate(size,alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) { return countedNew(size); }
+void* operator new[](std::size_t size) { return countedNew(size); }
+void* operator new(std::size_t size,std::align_val_t alignment) { return countedNew(size,static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size,std::align_val_t alignment) { return countedNew(size,static_cast<std::size_t>(alignment)); }
+void* operator new(std::size_t size,const std::nothrow_t&) noexcept { return countedAllocate(size,MallocAlignment); }
+void* operator new[](std::size_t size,const std::nothrow_t&) noexcept { return countedAllocate(size,MallocAlignment); }
+void* operator new(std::size_t size,std::align_val_t alignment,const std::nothrow_t&) noexcept { return countedAllocate(size,static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size,std::align_val_t alignment,const std::nothrow_t&) noexcept { return countedAllocate(size,static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* p) noexcept { countedRelease(p,MallocAlignment); }
+void operator delete[](void* p) noexcept { countedRelease(p,MallocAlignment); }
+void operator delete(void* p,std::size_t) noexcept { countedRelease(p,MallocAlignment); }
+void operator delete[](void* p,std::size_t) noexcept { countedRelease(p,MallocAlignment); }
+void operator delete(void* p,const std::nothrow_t&) noexcept { countedRelease(p,MallocAlignment); }
+void operator delete[](void* p,const std::nothrow_t&) noexcept { countedRelease(p,MallocAlignment); }
+void operator delete(void* p,std::align_val_t alignment) noexcept { countedRelease(p,static_cast<std::size_t>(alignment)); }
+void operator delete[](void* p,std::align_val_t alignment) noexcept { countedRelease(p,static_cast<std::size_t>(alignment)); }
+void operator delete(void* p,std::size_t,std::align_val_t alignment) noexcept { countedRelease(p,static_cast<std::size_t>(alignment)); }
+void operator delete[](void* p,std::size_t,std::align_val_t alignment) noexcept { countedRelease(p,static_cast<std::size_t>(alignment)); }
+void operator delete(void* p,std::align_val_t alignment,const std::nothrow_t&) noexcept { countedRelease(p,static_cast<std::size_t>(alignment)); }
+void operator delete[](void* p,std::align_val_t alignment,const std::nothrow_t&) noexcept { countedRelease(p,static_cast<std::size_t>(alignment)); }
+
+namespace
+{
+///防止编译器把测试代码优化掉
+volatile double Sink = 0;
+
+template<typename T>
+inline void keep(const T& value)
+{
+    Sink = Sink + static_cast<double>(value);
+}
+
+struct Result
+{
+    std::string name;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    double opsPerSecond = 0;
+    double mbPerSecond = 0;     //只有输入为字符串时统计
+};
+
+///一个测试:body执行一轮并返回这一轮的操作次数,bytes为这一轮处理的字节数(可以为0)
+struct Case
+{
+    std::string name;
+    std::function<std::size_t()> body;
+    std::size_t bytes = 0;
+};
+
+Result run(const Case& test,double minTime)
+{
+    using Clock = std::chrono::steady_clock;
+    test.body();//预热,同时完成延迟初始化
+
+    std::size_t rounds = 0;
+    std::size_t ops = 0;
+    const std::size_t allocBefore = AllocationCount.load();
+    const Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    do
+    {
+        ops += test.body();
+        ++rounds;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    while(elapsed < minTime);
+    const std::size_t allocs = AllocationCount.load() - allocBefore;
+
+    Result result;
+    result.name = test.name;
+    result.nsPerOp = elapsed * 1e9 / static_cast<double>(ops);
+    result.allocsPerOp = static_cast<double>(allocs) / static_cast<double>(ops);
+    result.opsPerSecond = static_cast<double>(ops) / elapsed;
+    result.mbPerSecond = static_cast<double>(test.bytes * rounds) / elapsed / (1024.0 * 1024.0);
+    return result;
+}
+
+std::size_t totalBytes(const std::vector<std::string>& inputs)
+{
+    std::size_t bytes = 0;
+    for(const std::string& s : inputs)
+        bytes += s.size();
+    return bytes;
+}
+
+///压缩到16字节之前的ValuePack布局:数值、数量级加上完整的UnitProperty,当时DecimalUnit的底层类型是int
+///只用来和现在的布局比较大数组的扫描和换算,换算系数两者都从同一张表中读取
+///不加-DUNITCONVERTOR_INLINE时ratioTo是函数调用,换算测试中ValuePack一侧还包含调用的开销
+struct LegacyUnitProperty
+{
+    Uc::DecimalRatio maxRatio = Uc::One;
+    Uc::DecimalRatio minRatio = Uc::One;
+    int unit = Uc::Null;
+    double Exp = 1000;
+};
+
+struct LegacyValuePack
+{
+    double value = 0;
+    Uc::DecimalRatio ratio = Uc::One;
+    LegacyUnitProperty property;
+};
+
+static_assert(sizeof(LegacyValuePack) == 40,"legacy layout is double + ratio + UnitProperty");
+
+///测试输入:不带单位、每个单位、每个数量级、格式错误的字符串以及科学计数法
+struct Inputs
+{
+    std::vector<std::string> unitless;
+    std::vector<std::string> units;
+    std::vector<std::string> ratios;
+    std::vector<std::string> malformed;
+    std::vector<std::string> scientific;
+    std::vector<std::string> mixed;
+    std::vector<ValuePack> packs;
+    std::vector<ValuePack> others;
+
+    Inputs()
+    {
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<double> dist(-999.0,999.0);
+        char buffer[64];
+        for(int i = 0; i < 256; i++)
+        {
+            std::snprintf(buffer,sizeof(buffer),"%.3f",dist(rng));
+            unitless.push_back(buffer);
+
+            const int unit = 1 + i % (Uc::UnitNum - 1);
+            std::snprintf(buffer,sizeof(buffer),"%.2f %s",dist(rng),std::string(Uc::DecimalUnitString[unit]).c_str());
+            units.push_back(buffer);
+
+            const int ratio = i % Uc::RatioNum;
+            std::snprintf(buffer,sizeof(buffer),"%.4f%sHz",dist(rng),std::string(Uc::DecimalRatioString[ratio]).c_str());
+            ratios.push_back(buffer);
+
+            std::snprintf(buffer,sizeof(buffer),"%.6e %sV",dist(rng),std::string(Uc::DecimalRatioString[ratio]).c_str());
+            scientific.push_back(buffer);
+
+            packs.emplace_back(dist(rng),static_cast<Uc::DecimalRatio>(ratio),Uc::Freq);
+            others.emplace_back(dist(rng),static_cast<Uc::DecimalRatio>((ratio + i / 7) % Uc::RatioNum),Uc::Freq);
+        }
+        const char* bad[] = {"","abc","1 2 Hz","5 HzHz","--","1.2.3 kV","12 kMHz","Hz","..5",". V","7 xyz","1e999 s"};
+        for(int i = 0; i < 256; i++)
+            malformed.push_back(bad[i % (sizeof(bad) / sizeof(bad[0]))]);
+
+        for(std::size_t i = 0; i < 256; i++)
+        {
+            const std::vector<std::string>* source[] = {&unitless,&units,&ratios,&malformed,&scientific};
+            mixed.push_back((*source[i % 5])[i]);
+        }
+    }
+};
+
+std::vector<Case> makeCases(const Inputs& in)
+{
+    std::vector<Case> cases;
+    auto parseCase = [&](const std::string& name,const std::vector<std::string>& inputs){
+        cases.push_back({"parse/fromString/" + name,[&inputs]{
+            for(const std::string& s : inputs)
+                keep(Uc::fromString(s).value());
+            return inputs.size();
+        },totalBytes(inputs)});
+    };
+    parseCase("unitless",in.unitless);
+    parseCase("units",in.units);
+    parseCase("ratios",in.ratios);
+    parseCase("scientific",in.scientific);
+
+    cases.push_back({"parse/fromString/malformed",[&in]{
+        for(const std::string& s : in.malformed)
+        {
+            try { keep(Uc::fromString(s).value()); } catch (const std::out_of_range&) {}
+        }
+        return in.malformed.size();
+    },totalBytes(in.malformed)});
+
+    cases.push_back({"parse/tryFromString/mixed",[&in]{
+        for(const std::string& s : in.mixed)
+            keep(Uc::tryFromString(s).pack.value());
+        return in.mixed.size();
+    },totalBytes(in.mixed)});
+
+    cases.push_back({"parse/fromStrings/mixed",[&in]{
+        static std::vector<std::string_view> views(in.mixed.begin(),in.mixed.end());
+        static Uc::ValueColumn column;
+        Uc::fromStrings(views.data(),views.size(),column);
+        keep(column.values[0]);
+        return views.size();
+    },totalBytes(in.mixed)});
+
+    cases.push_back({"convert/ratioTo/pack",[&in]{
+        for(const ValuePack& p : in.packs)
+            keep(Uc::ratioTo(p,Uc::Kilo).value());
+        return in.packs.size();
+    }});
+
+    //读取和换算ValuePack数组的循环,访问函数和构造函数在UnitConvertor.cpp中定义时每次都是函数调用,加上-DUNITCONVERTOR_INLINE时可以内联
+    cases.push_back({"convert/access/sum",[&in]{
+        double sum = 0;
+        for(const ValuePack& p : in.packs)
+            sum += p.ratio() == Uc::Kilo ? p.value() * 1000 : p.value();
+        keep(sum);
+        return in.packs.size();
+    },in.packs.size() * sizeof(ValuePack)});
+
+    cases.push_back({"convert/access/toBase",[&in]{
+        double sum = 0;
+        for(const ValuePack& p : in.packs)
+            sum += p.value() * Uc::conversionFactor(p.unit(),p.ratio(),Uc::One);
+        keep(sum);
+        return in.packs.size();
+    },in.packs.size() * sizeof(ValuePack)});
+
+    cases.push_back({"convert/access/construct",[&in]{
+        double sum = 0;
+        for(const ValuePack& p : in.packs)
+            sum += ValuePack(p.value(),Uc::Giga,p.unit()).ratio();
+        keep(sum);
+        return in.packs.size();
+    },in.packs.size() * sizeof(ValuePack)});
+
+    cases.push_back({"convert/proper/pack",[&in]{
+        for(const ValuePack& p : in.packs)
+            keep(Uc::proper(ValuePack(p.value() * 12345.0,p.ratio(),p.unit())).value());
+        return in.packs.size();
+    }});
+
+    //数组版本每轮处理64K个数值
+    static std::vector<double> values(1 << 16);
+    static std::vector<std::uint8_t> ratios(1 << 16);
+    cases.push_back({"convert/ratioTo/array",[]{
+        for(std::size_t i = 0; i < values.size(); i++)
+        {
+            values[i] = static_cast<double>(i % 2000) - 1000.0;
+            ratios[i] = static_cast<std::uint8_t>(i % Uc::RatioNum);
+        }
+        Uc::ratioTo(values.data(),ratios.data(),values.size(),Uc::Freq,Uc::Kilo);
+        keep(values[7]);
+        return values.size();
+    }});
+
+    cases.push_back({"convert/proper/array",[]{
+        for(std::size_t i = 0; i < values.size(); i++)
+        {
+            values[i] = static_cast<double>(i) * 37.0 - 1e6;
+            ratios[i] = Uc::One;
+        }
+        Uc::proper(values.data(),ratios.data(),values.size(),Uc::Freq);
+        keep(values[7]);
+        return values.size();
+    }});
+
+    auto formatCase = [&](const std::string& name,std::function<std::string(const ValuePack&)> f){
+        cases.push_back({"format/" + name,[&in,f]{
+            for(const ValuePack& p : in.packs)
+                keep(f(p).size());
+            return in.packs.size();
+        }});
+    };
+    formatCase("toString",[](const ValuePack& p){ return Uc::toString(p); });
+    formatCase("numericPart",[](const ValuePack& p){ return Uc::numericPart(p); });
+    formatCase("toFormatString/fixed",[](const ValuePack& p){ return Uc::toFormatString(p,3); });
+    formatCase("toFormatString/significant",[](const ValuePack& p){ return Uc::toFormatString(p,4,false); });
+    formatCase("toFormatString/width",[](const ValuePack& p){ return Uc::toFormatString(p,10,3,'0'); });
+    formatCase("toScientificString",[](const ValuePack& p){ return Uc::toScientificString(p); });
+    formatCase("toScientificString/precision",[](const ValuePack& p){ return Uc::toScientificString(p,3); });
+
+    auto bufferCase = [&](const std::string& name,std::function<std::size_t(const ValuePack&,char*,std::size_t)> f){
+        cases.push_back({"format/buffer/" + name,[&in,f]{
+            char buffer[64];
+            for(const ValuePack& p : in.packs)
+                keep(f(p,buffer,sizeof(buffer)));
+            return in.packs.size();
+        }});
+    };
+    bufferCase("toString",[](const ValuePack& p,char* b,std::size_t n){ return Uc::toString(p,b,n); });
+    bufferCase("toFormatString/fixed",[](const ValuePack& p,char* b,std::size_t n){ return Uc::toFormatString(p,b,n,3); });
+    bufferCase("toFormatString/width",[](const ValuePack& p,char* b,std::size_t n){ return Uc::toFormatString(p,b,n,10,3,'0'); });
+    bufferCase("toScientificString",[](const ValuePack& p,char* b,std::size_t n){ return Uc::toScientificString(p,b,n); });
+
+    //批量格式化到一块连续的缓冲区,与逐个生成std::string并保存下来的导出方式比较
+    auto batchCase = [&](const std::string& name,Uc::FormatSpec spec){
+        cases.push_back({"format/batch/" + name,[&in,spec]{
+            Uc::TextColumn text;
+            Uc::toStrings(in.packs.data(),in.packs.size(),text,spec,"\n");
+            keep(text.buffer.size());
+            return in.packs.size();
+        }});
+    };
+    batchCase("toString",Uc::FormatSpec());
+    batchCase("toFormatString/fixed",Uc::FormatSpec::precisionFormat(3));
+    batchCase("toFormatString/width",Uc::FormatSpec::widthFormat(10,3,'0'));
+    batchCase("toScientificString",Uc::FormatSpec::scientificFormat());
+    cases.push_back({"format/vector<string>/toScientificString",[&in]{
+        std::vector<std::string> strings;
+        strings.reserve(in.packs.size());
+        for(const ValuePack& p : in.packs)
+            strings.push_back(Uc::toScientificString(p));
+        keep(strings.back().size());
+        return in.packs.size();
+    }});
+
+    auto compareCase = [&](const std::string& name,std::function<bool(const ValuePack&,const ValuePack&)> f){
+        cases.push_back({"compare/" + name,[&in,f]{
+            std::size_t count = 0;
+            for(std::size_t i = 0; i < in.packs.size(); i++)
+                count += f(in.packs[i],in.others[i]);
+            keep(count);
+            return in.packs.size();
+        }});
+    };
+    compareCase("equal",[](const ValuePack& a,const ValuePack& b){ return a == b; });
+    compareCase("less",[](const ValuePack& a,const ValuePack& b){ return a < b; });
+    compareCase("lessEqual",[](const ValuePack& a,const ValuePack& b){ return a <= b; });
+    compareCase("greater",[](const ValuePack& a,const ValuePack& b){ return a > b; });
+
+    //缓存:界面上反复解析和格式化的少量设定值,全部命中
+    static const std::vector<std::string> setpoints = {"1kHz","10 mV","50%","2.5 GSa/s","100 ns","3.3 V","90°","1 MHz"};
+    static Uc::ConvertCache cache;
+    cases.push_back({"cache/fromString/setpoints",[]{
+        for(const std::string& s : setpoints)
+            keep(cache.fromString(s).value());
+        return setpoints.size();
+    },totalBytes(setpoints)});
+    static std::vector<ValuePack> setpointPacks;
+    for(const std::string& s : setpoints)
+        setpointPacks.push_back(Uc::fromString(s));
+    cases.push_back({"cache/toFormatString/setpoints",[]{
+        for(const ValuePack& p : setpointPacks)
+            keep(cache.toFormatString(p,3).size());
+        return setpointPacks.size();
+    }});
+    cases.push_back({"uncached/fromString/setpoints",[]{
+        for(const std::string& s : setpoints)
+            keep(Uc::fromString(s).value());
+        return setpoints.size();
+    },totalBytes(setpoints)});
+    cases.push_back({"uncached/toFormatString/setpoints",[]{
+        for(const ValuePack& p : setpointPacks)
+            keep(Uc::toFormatString(p,3).size());
+        return setpointPacks.size();
+    }});
+
+    //定点表示:与上面ValuePack的比较使用相同的数据
+    static std::vector<ExactValue> exactPacks;
+    static std::vector<ExactValue> exactOthers;
+    for(std::size_t i = 0; i < in.packs.size(); i++)
+    {
+        exactPacks.emplace_back(in.packs[i]);
+        exactOthers.emplace_back(in.others[i]);
+    }
+    cases.push_back({"exact/compare/less",[]{
+        std::size_t count = 0;
+        for(std::size_t i = 0; i < exactPacks.size(); i++)
+            count += exactPacks[i] < exactOthers[i];
+        keep(count);
+        return exactPacks.size();
+    }});
+    cases.push_back({"exact/sum",[]{
+        ExactValue sum(0,Uc::Freq);
+        for(const ExactValue& v : exactPacks)
+            sum += v;
+        keep(sum.count());
+        return exactPacks.size();
+    }});
+    cases.push_back({"pack/sum",[&in]{
+        ValuePack sum(0,Uc::One,Uc::Freq);
+        for(const ValuePack& v : in.packs)
+            sum = sum + v;
+        keep(sum.value());
+        return in.packs.size();
+    }});
+    cases.push_back({"exact/fromPack",[&in]{
+        std::int64_t sum = 0;
+        for(const ValuePack& v : in.packs)
+            sum += ExactValue(v).count();
+        keep(sum);
+        return in.packs.size();
+    }});
+
+    //实时读数:在1000 Hz附近波动的信号,以及变化小于显示分辨率的稳定信号
+    static std::vector<double> hover;
+    static std::vector<double> steady;
+    for(int i = 0; i < 1024; i++)
+    {
+        hover.push_back(1000.0 + std::sin(i * 0.1) * 3.0);
+        steady.push_back(12.3456 + std::sin(i * 0.1) * 1e-5);
+    }
+    auto readoutCase = [&](const std::string& name,const std::vector<double>& samples,double hysteresis){
+        cases.push_back({"readout/update/" + name,[&samples,hysteresis]{
+            static std::map<double,Uc::ReadoutFormatter> formatters;
+            Uc::ReadoutFormatter& f = formatters.emplace(hysteresis,Uc::ReadoutFormatter(Uc::Freq,3,true,hysteresis)).first->second;
+            std::size_t changed = 0;
+            for(double v : samples)
+                changed += f.update(v);
+            keep(changed);
+            return samples.size();
+        }});
+    };
+    readoutCase("hover1000",hover,0.05);
+    readoutCase("hover1000/noHysteresis",hover,0);
+    readoutCase("steady",steady,0.05);
+    auto naiveCase = [&](const std::string& name,const std::vector<double>& samples){
+        cases.push_back({"readout/naive/" + name,[&samples]{
+            for(double v : samples)
+                keep(Uc::toFormatString(Uc::proper(ValuePack(v,Uc::One,Uc::Freq)),3).size());
+            return samples.size();
+        }});
+    };
+    naiveCase("hover1000",hover);
+    naiveCase("steady",steady);
+
+    //大数组的内存占用:每个元素读取数值和数量级并转换到基本单位,与压缩之前的40字节布局对比
+    //数组在第一次运行时才生成,两种布局加上换算用的副本一共约450MB
+    constexpr std::size_t HistorySize = std::size_t(1) << 22;
+    static std::vector<ValuePack> history;
+    static std::vector<LegacyValuePack> legacyHistory;
+    auto fillHistory = []{
+        if(!history.empty())
+            return;
+        history.reserve(HistorySize);
+        for(std::size_t i = 0; i < HistorySize; i++)
+            history.emplace_back(static_cast<double>(i % 1000),static_cast<Uc::DecimalRatio>(i % Uc::RatioNum),Uc::Freq);
+    };
+    auto fillLegacyHistory = []{
+        if(!legacyHistory.empty())
+            return;
+        legacyHistory.resize(HistorySize);
+        for(std::size_t i = 0; i < HistorySize; i++)
+        {
+            LegacyValuePack& p = legacyHistory[i];
+            p.value = static_cast<double>(i % 1000);
+            p.ratio = static_cast<Uc::DecimalRatio>(i % Uc::RatioNum);
+            p.property = LegacyUnitProperty{Uc::Giga,Uc::One,Uc::Freq,1000};
+        }
+    };
+    cases.push_back({"layout/vector<ValuePack>/sum",[fillHistory]{
+        fillHistory();
+        double sum = 0;
+        for(const ValuePack& p : history)
+            sum += p.value() * (p.ratio() == Uc::One ? 1.0 : 1000.0);
+        keep(sum);
+        return history.size();
+    },HistorySize * sizeof(ValuePack)});
+    cases.push_back({"layout/vector<LegacyValuePack>/sum",[fillLegacyHistory]{
+        fillLegacyHistory();
+        double sum = 0;
+        for(const LegacyValuePack& p : legacyHistory)
+            sum += p.value * (p.ratio == Uc::One ? 1.0 : 1000.0);
+        keep(sum);
+        return legacyHistory.size();
+    },HistorySize * sizeof(LegacyValuePack)});
+
+    //原地换算整个数组,每一轮在Milli和Kilo之间交替,数值保持在同一范围内
+    static std::vector<ValuePack> converted;
+    static std::vector<LegacyValuePack> legacyConverted;
+    cases.push_back({"layout/vector<ValuePack>/convert",[fillHistory]{
+        static int round = 0;
+        if(converted.empty())
+        {
+            fillHistory();
+            converted = history;
+        }
+        const Uc::DecimalRatio target = round++ % 2 ? Uc::Kilo : Uc::Milli;
+        for(ValuePack& p : converted)
+            p = Uc::ratioTo(p,target);
+        keep(converted[1].value());
+        return converted.size();
+    },HistorySize * sizeof(ValuePack) * 2});
+    cases.push_back({"layout/vector<LegacyValuePack>/convert",[fillLegacyHistory]{
+        static int round = 0;
+        if(legacyConverted.empty())
+        {
+            fillLegacyHistory();
+            legacyConverted = legacyHistory;
+        }
+        const Uc::DecimalRatio target = round++ % 2 ? Uc::Kilo : Uc::Milli;
+        for(LegacyValuePack& p : legacyConverted)
+        {
+            //与ratioTo相同,数量级限制在单位的范围内,这里直接使用保存的UnitProperty
+            const Uc::DecimalRatio ratio = std::max(p.property.minRatio,std::min(p.property.maxRatio,target));
+            p.value *= Uc::conversionFactor(static_cast<Uc::DecimalUnit>(p.property.unit),p.ratio,ratio);
+            p.ratio = ratio;
+        }
+        keep(legacyConverted[1].value);
+        return legacyConverted.size();
+    },HistorySize * sizeof(LegacyValuePack) * 2});
+
+    //混合数量级的扫描表排序:operator<每次比较都要换算数量级,排序键每个元素只换算一次
+    static std::vector<ValuePack> sweep;
+    for(std::size_t i = 0; i < (std::size_t(1) << 16); i++)
+    {
+        const auto ratio = static_cast<Uc::DecimalRatio>(Uc::One + i % 4);
+        sweep.emplace_back(static_cast<double>((i * 2654435761u) % 100000) / 100.0,ratio,Uc::Freq);
+    }
+    cases.push_back({"sort/std::sort/operator<",[]{
+        std::vector<ValuePack> v = sweep;
+        std::sort(v.begin(),v.end());
+        keep(v[1].value());
+        return v.size();
+    }});
+    cases.push_back({"sort/std::sort/SortKeyLess",[]{
+        std::vector<ValuePack> v = sweep;
+        std::sort(v.begin(),v.end(),Uc::SortKeyLess());
+        keep(v[1].value());
+        return v.size();
+    }});
+    cases.push_back({"sort/radixSort",[]{
+        std::vector<ValuePack> v = sweep;
+        Uc::radixSort(v.data(),v.size());
+        keep(v[1].value());
+        return v.size();
+    }});
+    //小批量时每次调用的固定开销占主要部分
+    cases.push_back({"sort/sortKeys/16",[]{
+        static Uc::SortKey keys[16];
+        Uc::sortKeys(sweep.data(),16,keys);
+        keep(keys[1].value);
+        return std::size_t(16);
+    }});
+    cases.push_back({"sort/SortedIndex/build",[]{
+        Uc::SortedIndex index(sweep.data(),sweep.size());
+        keep(index.order()[1]);
+        return sweep.size();
+    }});
+    cases.push_back({"sort/SortedIndex/range",[]{
+        static const Uc::SortedIndex index(sweep.data(),sweep.size());
+        std::size_t count = 0;
+        for(int i = 1; i <= 1000; i++)
+        {
+            const auto r = index.range(ValuePack(i,Uc::Kilo,Uc::Freq),ValuePack(i * 0.002,Uc::Mega,Uc::Freq));
+            count += r.second - r.first;
+        }
+        keep(count);
+        return std::size_t(1000);
+    }});
+
+    //分段到达的仪器回复:StreamParser逐段解析,对比先拆分成std::string再逐个tryFromString
+    static std::string reply;
+    for(const std::string& s : in.mixed)
+        reply.append(s).push_back(',');
+    auto streamCase = [&](std::size_t chunk){
+        cases.push_back({"stream/feed/chunk:" + std::to_string(chunk),[&in,chunk]{
+            std::size_t count = 0;
+            Uc::StreamParser parser([&count](const Uc::ParseResult& r){ count += r.pack.ratio(); });
+            for(std::size_t pos = 0; pos < reply.size(); pos += chunk)
+                parser.feed(std::string_view(reply).substr(pos,chunk));
+            parser.finish();
+            keep(count);
+            return in.mixed.size();
+        },reply.size()});
+    };
+    streamCase(16);
+    streamCase(4096);
+    cases.push_back({"stream/split+tryFromString",[&in]{
+        std::size_t count = 0;
+        std::string token;
+        for(char c : reply)
+        {
+            if(c != ',')
+            {
+                token.push_back(c);
+                continue;
+            }
+            count += Uc::tryFromString(token).pack.ratio();
+            token.clear();
+        }
+        keep(count);
+        return in.mixed.size();
+    },reply.size()});
+
+    //采集数据的统计:每个元素用ratioTo换算再比较,对比流式统计的逐个添加和数组版本
+    static std::vector<double> capture;
+    static std::vector<std::uint8_t> captureRatios;
+    static std::vector<ValuePack> capturePacks;
+    for(std::size_t i = 0; i < (std::size_t(1) << 20); i++)
+    {
+        const auto ratio = static_cast<Uc::DecimalRatio>(Uc::Micro + i % 3);
+        capture.push_back(std::sin(i * 0.001) * 900.0 + 1.0);
+        captureRatios.push_back(static_cast<std::uint8_t>(ratio));
+        capturePacks.emplace_back(capture.back(),ratio,Uc::Voltage);
+    }
+    cases.push_back({"stats/naive/ratioTo",[]{
+        ValuePack lo = capturePacks[0];
+        ValuePack hi = capturePacks[0];
+        double sum = 0;
+        for(const ValuePack& p : capturePacks)
+        {
+            lo = p < lo ? p : lo;
+            hi = p > hi ? p : hi;
+            sum += Uc::ratioTo(p,Uc::One).value();
+        }
+        keep(sum + lo.value() + hi.value());
+        return capturePacks.size();
+    },capturePacks.size() * sizeof(ValuePack)});
+    cases.push_back({"stats/add/pack",[]{
+        Uc::ValueStatistics stats(Uc::Voltage);
+        for(const ValuePack& p : capturePacks)
+            stats.add(p);
+        keep(stats.mean().value());
+        return capturePacks.size();
+    },capturePacks.size() * sizeof(ValuePack)});
+    cases.push_back({"stats/add/array",[]{
+        Uc::ValueStatistics stats(Uc::Voltage);
+        stats.add(capture.data(),capture.size(),Uc::Milli);
+        keep(stats.mean().value());
+        return capture.size();
+    },capture.size() * sizeof(double)});
+    cases.push_back({"stats/add/array+ratios",[]{
+        Uc::ValueStatistics stats(Uc::Voltage);
+        stats.add(capture.data(),captureRatios.data(),capture.size());
+        keep(stats.mean().value());
+        return capture.size();
+    },capture.size() * (sizeof(double) + 1)});
+
+    //校准公式 v * gain - offset + reference:逐个运算符生成临时数据包,对比表达式模板的一次求值
+    static const ValuePack offset(12.5,Uc::Micro,Uc::Voltage);
+    static const ValuePack reference(0.25,Uc::One,Uc::Voltage);
+    static std::vector<double> calibrated(capture.size());
+    cases.push_back({"arith/chained",[]{
+        double sum = 0;
+        for(const ValuePack& p : capturePacks)
+            sum += (p * 1.02 - offset + reference).value();
+        keep(sum);
+        return capturePacks.size();
+    },capturePacks.size() * sizeof(ValuePack)});
+    cases.push_back({"arith/expression",[]{
+        double sum = 0;
+        for(const ValuePack& p : capturePacks)
+            sum += ValuePack(Uc::expr(p) * 1.02 - offset + reference).value();
+        keep(sum);
+        return capturePacks.size();
+    },capturePacks.size() * sizeof(ValuePack)});
+    cases.push_back({"arith/array/chained",[]{
+        for(std::size_t i = 0; i < capture.size(); i++)
+            calibrated[i] = (ValuePack(capture[i],Uc::Milli,Uc::Voltage) * 1.02 - offset + reference).value();
+        keep(calibrated.back());
+        return capture.size();
+    },capture.size() * sizeof(double) * 2});
+    cases.push_back({"arith/array/expression",[]{
+        Uc::evaluate(Uc::expr(capture.data(),Uc::Milli,Uc::Voltage) * 1.02 - offset + reference,calibrated.data(),capture.size());
+        keep(calibrated.back());
+        return capture.size();
+    },capture.size() * sizeof(double) * 2});
+
+    //二进制记录:写入内存中的流,再从内存中解码,与文本的toStrings + fromStrings对比
+    static std::string serialized[2];
+    auto serialize = [&in](Uc::SerialEncoding encoding) -> const std::string& {
+        std::ostringstream out;
+        Uc::ValuePackWriter writer(out,encoding);
+        writer.append(in.packs.data(),in.packs.size());
+        writer.finish();
+        return serialized[encoding] = out.str();
+    };
+    for(Uc::SerialEncoding encoding : {Uc::SerialRaw,Uc::SerialCompact})
+    {
+        const std::string suffix = encoding == Uc::SerialRaw ? "raw" : "compact";
+        cases.push_back({"serial/write/" + suffix,[&in,serialize,encoding]{
+            keep(serialize(encoding).size());
+            return in.packs.size();
+        }});
+        cases.push_back({"serial/read/" + suffix,[serialize,encoding]{
+            const std::string& data = serialized[encoding].empty() ? serialize(encoding) : serialized[encoding];
+            const Uc::ValuePackReader reader(data.data(),data.size());
+            static Uc::ValueColumn column;
+            reader.read(column);
+            keep(column.values[1]);
+            return reader.size();
+        }});
+    }
+    cases.push_back({"serial/iterate/compact",[serialize]{
+        const std::string& data = serialized[Uc::SerialCompact].empty() ? serialize(Uc::SerialCompact) : serialized[Uc::SerialCompact];
+        const Uc::ValuePackReader reader(data.data(),data.size());
+        double sum = 0;
+        for(const ValuePack& p : reader)
+            sum += p.value();
+        keep(sum);
+        return reader.size();
+    }});
+
+    //多线程扩展性:同样的工作量分别用1、2、4……个线程完成,理想情况下ns/op随线程数成反比
+    static std::vector<std::string> bulk;
+    static std::vector<std::string_view> bulkViews;
+    for(std::size_t i = 0; i < (std::size_t(1) << 20); i++)
+        bulk.push_back(in.mixed[i % in.mixed.size()]);
+    bulkViews.assign(bulk.begin(),bulk.end());
+    const unsigned cores = std::max(2u,std::thread::hardware_concurrency());
+    for(unsigned threads = 1; threads <= cores && threads <= 32; threads *= 2)
+    {
+        auto convertor = std::make_shared<Uc::ParallelConvertor>(threads);
+        auto column = std::make_shared<Uc::ValueColumn>();
+        const std::string suffix = "/threads:" + std::to_string(threads);
+        cases.push_back({"parallel/fromStrings" + suffix,[convertor,column]{
+            convertor->fromStrings(bulkViews.data(),bulkViews.size(),*column);
+            keep(column->values[1]);
+            return bulkViews.size();
+        },totalBytes(bulk)});
+        cases.push_back({"parallel/proper" + suffix,[convertor,column]{
+            if(column->size() != bulkViews.size())
+                convertor->fromStrings(bulkViews.data(),bulkViews.size(),*column);
+            std::fill(column->ratios.begin(),column->ratios.end(),std::uint8_t(Uc::One));
+            convertor->proper(column->values.data(),column->ratios.data(),column->size(),Uc::Freq);
+            keep(column->values[1]);
+            return column->size();
+        }});
+        cases.push_back({"parallel/toStrings" + suffix,[convertor,column]{
+            if(column->size() != bulkViews.size())
+                convertor->fromStrings(bulkViews.data(),bulkViews.size(),*column);
+            std::vector<std::string> strings = convertor->toStrings(*column,[](const ValuePack& p){ return Uc::toString(p); });
+            keep(strings[1].size());
+            return strings.size();
+        }});
+    }
+
+    //运行时注册的单位:第一次注册之后所有解析都改为查找快照,所以这些测试放在最后
+    static std::vector<std::string> custom;
+    cases.push_back({"registry/fromString/custom",[]{
+        if(custom.empty())
+        {
+            Uc::registerUnit("Ohm",Uc::Milli,Uc::Mega);
+            Uc::registerUnit("dBm",Uc::One,Uc::One,1);
+            Uc::registerUnit("m²",Uc::Micro,Uc::One,1e6);
+            const char* samples[] = {"1.5 kOhm","220 mOhm","-30 dBm","2.5 mm²","4.7 MOhm","12 dBm","0.25 m²","47 Ohm"};
+            custom.assign(std::begin(samples),std::end(samples));
+        }
+        for(const std::string& s : custom)
+            keep(Uc::fromString(s).value());
+        return custom.size();
+    }});
+    cases.push_back({"registry/fromString/units",[&in]{
+        for(const std::string& s : in.units)
+            keep(Uc::fromString(s).value());
+        return in.units.size();
+    },totalBytes(in.units)});
+
+    return cases;
+}
+
+bool writeJson(const char* path,const std::vector<Result>& results)
+{
+    std::FILE* file = std::fopen(path,"w");
+    if(file == nullptr)
+        return false;
+    std::fprintf(file,"{\n  \"sizeof(ValuePack)\": %zu,\n  \"results\": [\n",sizeof(ValuePack));
+    for(std::size_t i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+        std::fprintf(file,"    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"allocs_per_op\": %.2f, \"ops_per_s\": %.0f, \"mb_per_s\": %.1f}%s\n",
+                     r.name.c_str(),r.nsPerOp,r.allocsPerOp,r.opsPerSecond,r.mbPerSecond,i + 1 == results.size() ? "" : ",");
+    }
+    std::fputs("  ]\n}\n",file);
+    std::fclose(file);
+    return true;
+}
+
+///读取writeJson写出的文件,返回测试名称到ns/op的映射
+std::map<std::string,double> readJson(const char* path)
+{
+    std::map<std::string,double> baseline;
+    std::FILE* file = std::fopen(path,"r");
+    if(file == nullptr)
+        return baseline;
+    char line[512];
+    while(std::fgets(line,sizeof(line),file) != nullptr)
+    {
+        char name[256];
+        double ns = 0;
+        if(std::sscanf(line," {\"name\": \"%255[^\"]\", \"ns_per_op\": %lf",name,&ns) == 2)
+            baseline[name] = ns;
+    }
+    std::fclose(file);
+    return baseline;
+}
+}
+
+int main(int argc,char** argv)
+{
+    const char* filter = nullptr;
+    const char* jsonPath = nullptr;
+    const char* comparePath = nullptr;
+    double minTime = 0.3;
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i],"--filter") == 0 && i + 1 < argc)
+            filter = argv[++i];
+        else if(std::strcmp(argv[i],"--json") == 0 && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if(std::strcmp(argv[i],"--compare") == 0 && i + 1 < argc)
+            comparePath = argv[++i];
+        else if(std::strcmp(argv[i],"--min-time") == 0 && i + 1 < argc)
+            minTime = std::atof(argv[++i]);
+        else
+        {
+            std::fputs("usage: ucbench [--filter text] [--json file] [--compare baseline.json] [--min-time seconds]\n",stderr);
+            return 2;
+        }
+    }
+
+    Inputs inputs;
+    std::vector<Case> cases = makeCases(inputs);
+    std::map<std::string,double> baseline;
+    if(comparePath != nullptr)
+        baseline = readJson(comparePath);
+
+    std::printf("%-44s %12s %10s %14s %10s%s\n","benchmark","ns/op","allocs/op","ops/s","MB/s",comparePath ? "   vs baseline" : "");
+    std::vector<Result> results;
+    for(const Case& test : cases)
+    {
+        if(filter != nullptr && test.name.find(filter) == std::string::npos)
+            continue;
+        Result r = run(test,minTime);
+        std::printf("%-44s %12.2f %10.2f %14.0f %10.1f",r.name.c_str(),r.nsPerOp,r.allocsPerOp,r.opsPerSecond,r.mbPerSecond);
+        auto it = baseline.find(r.name);
+        if(it != baseline.end())
+            std::printf("   %+6.1f%%",(r.nsPerOp / it->second - 1.0) * 100.0);
+        std::printf("\n");
+        results.push_back(r);
+    }
+
+    if(jsonPath != nullptr && !writeJson(jsonPath,results))
+    {
+        std::fprintf(stderr,"ucbench: cannot write %s\n",jsonPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+﻿///ConvertCache的行为测试:命中统计、FIFO和CLOCK的淘汰顺序、注册单位之后的失效以及缓存的超出范围错误,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -g -pthread -fsanitize=address,undefined -I.. ConvertCacheTest.cpp ../UnitConvertor.cpp ../ConvertCache.cpp -o uccachetest
+///用法: uccachetest,全部通过时返回0,否则输出失败的检查并返回1
+///淘汰顺序的测试只使用一个分片,这样所有的键都在同一个分片中按照写入顺序排列
+
+#include "ConvertCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+///数值逐位相同(包括NaN和-0),数量级和单位相同
+static bool samePack(const ValuePack& a,const ValuePack& b)
+{
+    const double x = a.value();
+    const double y = b.value();
+    return std::memcmp(&x,&y,sizeof(double)) == 0 && a.ratio() == b.ratio() && a.unit() == b.unit();
+}
+
+static void testHitsAndMisses()
+{
+    Uc::ConvertCache cache(64,Uc::CacheClock,4);
+    CHECK(samePack(cache.fromString("1.5 kHz"),Uc::fromString("1.5 kHz")));
+    CHECK(samePack(cache.fromString("1.5 kHz"),Uc::fromString("1.5 kHz")));
+    //指定单位是键的一部分
+    CHECK(samePack(cache.fromString("1.5 k",Uc::Voltage),Uc::fromString("1.5 k",Uc::Voltage)));
+    CHECK(cache.tryFromString("1.5 kHz").pack.value() == 1.5);
+
+    Uc::CacheStats stats = cache.stats();
+    CHECK(stats.parseMisses == 2 && stats.parseHits == 2);
+    CHECK(stats.formatMisses == 0 && stats.formatHits == 0 && stats.evictions == 0);
+
+    const ValuePack pack(12.345,Uc::Milli,Uc::Time);
+    CHECK(cache.toString(pack) == Uc::toString(pack));
+    CHECK(cache.toString(pack) == Uc::toString(pack));
+    //格式化函数的种类和参数不同时不能命中
+    CHECK(cache.toFormatString(pack,2) == Uc::toFormatString(pack,2));
+    CHECK(cache.toFormatString(pack,3) == Uc::toFormatString(pack,3));
+    CHECK(cache.toFormatString(pack,3,false) == Uc::toFormatString(pack,3,false));
+    CHECK(cache.toFormatString(pack,8,2,' ') == Uc::toFormatString(pack,8,2,' '));
+    CHECK(cache.toScientificString(pack) == Uc::toScientificString(pack));
+    CHECK(cache.toScientificString(pack,6) == Uc::toScientificString(pack));
+    CHECK(cache.toScientificString(pack,2) == Uc::toScientificString(pack,2));
+
+    stats = cache.stats();
+    CHECK(stats.formatMisses == 7 && stats.formatHits == 2);
+
+    //清空之后重新计算,统计数据保留
+    cache.clear();
+    CHECK(cache.toString(pack) == Uc::toString(pack));
+    CHECK(cache.fromString("1.5 kHz").value() == 1.5);
+    stats = cache.stats();
+    CHECK(stats.formatMisses == 8 && stats.formatHits == 2);
+    CHECK(stats.parseMisses == 3 && stats.parseHits == 2);
+}
+
+///容量为3的单分片缓存:依次写入a、b、c,读取a,再写入d,然后检查probe是否还在缓存中
+static bool cachedAfterEviction(Uc::CachePolicy policy,const char* probe)
+{
+    Uc::ConvertCache cache(3,policy,1);
+    cache.fromString("1 Hz");
+    cache.fromString("2 Hz");
+    cache.fromString("3 Hz");
+    cache.fromString("1 Hz");
+    cache.fromString("4 Hz");
+    if(cache.stats().evictions != 1)
+        return false;
+    const std::uint64_t hits = cache.stats().parseHits;
+    cache.fromString(probe);
+    return cache.stats().parseHits == hits + 1;
+}
+
+static void testEvictionOrder()
+{
+    //FIFO淘汰最早写入的a,与是否被读取过无关
+    CHECK(!cachedAfterEviction(Uc::CacheFifo,"1 Hz"));
+    CHECK(cachedAfterEviction(Uc::CacheFifo,"2 Hz"));
+    CHECK(cachedAfterEviction(Uc::CacheFifo,"3 Hz"));
+    CHECK(cachedAfterEviction(Uc::CacheFifo,"4 Hz"));
+    //CLOCK跳过被读取过的a,淘汰b
+    CHECK(cachedAfterEviction(Uc::CacheClock,"1 Hz"));
+    CHECK(!cachedAfterEviction(Uc::CacheClock,"2 Hz"));
+    CHECK(cachedAfterEviction(Uc::CacheClock,"3 Hz"));
+    CHECK(cachedAfterEviction(Uc::CacheClock,"4 Hz"));
+
+    //CLOCK跳过一次之后清除标记,再写入两个新结果时a和c被淘汰
+    Uc::ConvertCache cache(3,Uc::CacheClock,1);
+    for(const char* s : {"1 Hz","2 Hz","3 Hz","1 Hz","4 Hz","5 Hz"})
+        cache.fromString(s);
+    CHECK(cache.stats().evictions == 2);
+    const std::uint64_t misses = cache.stats().parseMisses;
+    cache.fromString("4 Hz");
+    cache.fromString("5 Hz");
+    CHECK(cache.stats().parseMisses == misses);
+}
+
+///解析结果与已经注册的单位有关,注册新单位之后原来缓存的结果不能再被使用
+static void testRegisterUnitInvalidates()
+{
+    Uc::ConvertCache cache;
+    const ValuePack before = cache.fromString("5 kfoo");
+    CHECK(before.unit() == Uc::Null);
+    CHECK(samePack(cache.fromString("5 kfoo"),before));
+    const std::uint64_t misses = cache.stats().parseMisses;
+
+    const Uc::DecimalUnit foo = Uc::registerUnit("foo",Uc::One,Uc::Mega);
+    const ValuePack after = cache.fromString("5 kfoo");
+    CHECK(cache.stats().parseMisses == misses + 1);
+    CHECK(after.unit() == foo && after.ratio() == Uc::Kilo && after.value() == 5);
+    CHECK(samePack(after,Uc::fromString("5 kfoo")));
+}
+
+///数值超出范围时fromString每次都抛出std::out_of_range,命中缓存时也一样
+static void testCachedOutOfRange()
+{
+    Uc::ConvertCache cache;
+    for(int i = 0; i < 2; i++)
+    {
+        bool thrown = false;
+        try
+        {
+            cache.fromString("1e999 Hz");
+        }
+        catch(const std::out_of_range&)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+    const Uc::CacheStats stats = cache.stats();
+    CHECK(stats.parseMisses == 1 && stats.parseHits == 1);
+    const Uc::ParseResult result = cache.tryFromString("1e999 Hz");
+    CHECK((result.flags & Uc::ParseValueOutOfRange) != 0);
+    CHECK(cache.stats().parseHits == 2);
+}
+
+int main()
+{
+    testHitsAndMisses();
+    testEvictionOrder();
+    testRegisterUnitInvalidates();
+    testCachedOutOfRange();
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+﻿///ExactValue的测试:int64边界上的饱和运算、ValuePack转换为计数值时的舍入和饱和、哈希与相等的一致性,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -g -fsanitize=address,undefined -I.. ExactValueTest.cpp ../UnitConvertor.cpp ../ExactValue.cpp -o ucexacttest
+///用法: ucexacttest,全部通过时返回0,否则输出失败的检查并返回1
+///饱和运算与GCC/Clang的__int128计算再截断到int64范围的结果比较
+
+#include "ExactValue.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+//饱和运算可以在编译期计算
+static_assert((ExactValue(ExactValue::Max,Uc::Freq) + ExactValue(1,Uc::Freq)).count() == ExactValue::Max,"constexpr add");
+static_assert((-ExactValue(ExactValue::Min,Uc::Time)).count() == ExactValue::Max,"constexpr negate");
+
+static std::int64_t clamp(__int128 x)
+{
+    if(x > ExactValue::Max)
+        return ExactValue::Max;
+    if(x < ExactValue::Min)
+        return ExactValue::Min;
+    return static_cast<std::int64_t>(x);
+}
+
+///int64的边界附近和随机的计数值
+static std::vector<std::int64_t> makeCounts(std::mt19937_64& rng)
+{
+    const std::int64_t max = ExactValue::Max;
+    const std::int64_t min = ExactValue::Min;
+    std::vector<std::int64_t> counts = {0,1,-1,2,-2,3,-3,max,max - 1,max / 2,max / 2 + 1,min,min + 1,min / 2,min / 2 - 1,
+                                        3037000499,3037000500,-3037000499,-3037000500,4294967296,-4294967296};
+    for(int i = 0; i < 40; i++)
+    {
+        counts.push_back(static_cast<std::int64_t>(rng()));
+        counts.push_back(static_cast<std::int64_t>(rng()) >> (rng() % 63));
+    }
+    return counts;
+}
+
+static void testSaturatedArithmetic(std::mt19937_64& rng)
+{
+    const std::vector<std::int64_t> counts = makeCounts(rng);
+    bool add = true;
+    bool sub = true;
+    bool mul = true;
+    bool div = true;
+    for(std::int64_t a : counts)
+    {
+        const ExactValue x(a,Uc::Time);
+        CHECK((-x).count() == clamp(-static_cast<__int128>(a)));
+        for(std::int64_t b : counts)
+        {
+            const ExactValue y(b,Uc::Time);
+            add = add && (x + y).count() == clamp(static_cast<__int128>(a) + b) && (x + y).unit() == Uc::Time;
+            sub = sub && (x - y).count() == clamp(static_cast<__int128>(a) - b);
+            mul = mul && (x * b).count() == clamp(static_cast<__int128>(a) * b);
+            if(b != 0)
+                div = div && (x / b).count() == clamp(static_cast<__int128>(a) / b);
+        }
+    }
+    CHECK(add);
+    CHECK(sub);
+    CHECK(mul);
+    CHECK(div);
+
+    //除数为0时按照被除数的符号饱和
+    CHECK((ExactValue(5,Uc::Freq) / 0).count() == ExactValue::Max);
+    CHECK((ExactValue(-5,Uc::Freq) / 0).count() == ExactValue::Min);
+    CHECK((ExactValue(0,Uc::Freq) / 0).count() == 0);
+    CHECK((ExactValue(-7,Uc::Freq) / 2).count() == -3);
+
+    CHECK(ExactValue(ExactValue::Max,Uc::Freq).saturated() && ExactValue(ExactValue::Min,Uc::Freq).saturated());
+    CHECK(!ExactValue(ExactValue::Max - 1,Uc::Freq).saturated());
+
+    //复合赋值与二元运算相同,单位不同时得到默认值
+    ExactValue v(ExactValue::Max - 1,Uc::Freq);
+    v += ExactValue(5,Uc::Freq);
+    CHECK(v.count() == ExactValue::Max);
+    v -= ExactValue(ExactValue::Max,Uc::Freq);
+    CHECK(v.count() == 0);
+    v = ExactValue(ExactValue::Min / 2,Uc::Freq);
+    v *= 2;
+    CHECK(v.count() == ExactValue::Min);
+    v *= 2;
+    CHECK(v.count() == ExactValue::Min);
+    v /= -1;
+    CHECK(v.count() == ExactValue::Max);
+    CHECK(ExactValue(1,Uc::Freq) + ExactValue(1,Uc::Time) == ExactValue());
+    CHECK(ExactValue(1,Uc::Freq) - ExactValue(1,Uc::Time) == ExactValue());
+}
+
+static void testFromPack()
+{
+    //以最小数量级计数:Time为ns,Freq为Hz
+    CHECK(ExactValue(ValuePack(1.5,Uc::One,Uc::Time)) == ExactValue(1500000000,Uc::Time));
+    CHECK(ExactValue(ValuePack(1,Uc::Giga,Uc::Freq)) == ExactValue(1000000000,Uc::Freq));
+    //十进制小数不能精确表示,乘以倍数之后四舍五入得到正确的计数值
+    CHECK(ExactValue(ValuePack(0.1,Uc::One,Uc::Time)).count() == 100000000);
+    CHECK(ExactValue(ValuePack(0.3,Uc::Milli,Uc::Time)).count() == 300000);
+    CHECK(ExactValue(ValuePack(4.35,Uc::Kilo,Uc::Freq)).count() == 4350);
+    //正好一半时远离0舍入
+    CHECK(ExactValue(ValuePack(0.5,Uc::One,Uc::Freq)).count() == 1);
+    CHECK(ExactValue(ValuePack(-0.5,Uc::One,Uc::Freq)).count() == -1);
+    CHECK(ExactValue(ValuePack(0.0625,Uc::Kilo,Uc::Freq)).count() == 63);
+    CHECK(ExactValue(ValuePack(-0.0625,Uc::Kilo,Uc::Freq)).count() == -63);
+    CHECK(ExactValue(ValuePack(0.49,Uc::One,Uc::Freq)).count() == 0);
+    CHECK(ExactValue(ValuePack(-0.0,Uc::One,Uc::Freq)).count() == 0);
+
+    //进制不是1000的注册单位
+    const Uc::DecimalUnit byte = Uc::registerUnit("B",Uc::One,Uc::Giga,1024);
+    CHECK(ExactValue(ValuePack(1.5,Uc::Kilo,byte)).count() == 1536);
+    CHECK(ExactValue(ValuePack(1,Uc::Giga,byte)).count() == 1073741824);
+
+    //超出int64范围时饱和,NaN为0;2^63可以用double精确表示,小于它的最大double不饱和
+    CHECK(ExactValue(ValuePack(1e300,Uc::Giga,Uc::Freq)).count() == ExactValue::Max);
+    CHECK(ExactValue(ValuePack(-1e300,Uc::Giga,Uc::Freq)).count() == ExactValue::Min);
+    CHECK(ExactValue(ValuePack(std::numeric_limits<double>::infinity(),Uc::One,Uc::Freq)).count() == ExactValue::Max);
+    CHECK(ExactValue(ValuePack(std::nan(""),Uc::One,Uc::Freq)).count() == 0);
+    CHECK(ExactValue(ValuePack(9223372036854775808.0,Uc::One,Uc::Freq)).count() == ExactValue::Max);
+    CHECK(ExactValue(ValuePack(-9223372036854775808.0,Uc::One,Uc::Freq)).count() == ExactValue::Min);
+    CHECK(ExactValue(ValuePack(9223372036854774784.0,Uc::One,Uc::Freq)).count() == 9223372036854774784);
+
+    //转换回ValuePack
+    const ExactValue period(1500,Uc::Time);
+    CHECK(period.toPack().value() == 1500 && period.toPack().ratio() == Uc::Nano && period.toPack().unit() == Uc::Time);
+    CHECK(period.toPack(Uc::Micro).value() == 1.5 && period.toPack(Uc::Micro).ratio() == Uc::Micro);
+    //数量级超出单位的范围时被调整
+    CHECK(period.toPack(Uc::Kilo).ratio() == Uc::One);
+    CHECK(ExactValue(period.toPack(Uc::Micro)) == period);
+    CHECK(ExactValue(static_cast<ValuePack>(period)) == period);
+}
+
+///相等的值哈希值相同,可以作为std::unordered_set的键;单位不同的值不相等
+static void testHashAndEquality()
+{
+    const ExactValue a(ValuePack(1,Uc::Kilo,Uc::Freq));
+    const ExactValue b(ValuePack(1000,Uc::One,Uc::Freq));
+    const ExactValue c(ValuePack(0.001,Uc::Mega,Uc::Freq));
+    CHECK(a == b && b == c && !(a != c));
+    CHECK(a.hash() == b.hash() && b.hash() == c.hash());
+    CHECK(std::hash<ExactValue>()(a) == a.hash());
+    CHECK(!(a < b) && !(b < a) && a <= b && a >= b);
+
+    const ExactValue time(1000,Uc::Time);
+    CHECK(a != time && (a < time) != (time < a));
+    CHECK(ExactValue(-1,Uc::Freq) < ExactValue(0,Uc::Freq) && ExactValue(ExactValue::Min,Uc::Time) > ExactValue(ExactValue::Max,Uc::Freq));
+
+    std::unordered_set<ExactValue> set;
+    for(double v : {1.0,1000.0,0.5,500.0})
+        set.insert(ExactValue(ValuePack(v,v < 10 ? Uc::Kilo : Uc::One,Uc::Freq)));
+    set.insert(time);
+    set.insert(ExactValue(1000,Uc::Time));
+    CHECK(set.size() == 3);
+    CHECK(set.count(ExactValue(500,Uc::Freq)) == 1 && set.count(ExactValue(500,Uc::Time)) == 0);
+
+    //计数值和单位都参与哈希
+    std::unordered_set<std::size_t> hashes;
+    for(std::int64_t count = -500; count < 500; count++)
+        for(Uc::DecimalUnit unit : {Uc::Freq,Uc::Time})
+            hashes.insert(ExactValue(count,unit).hash());
+    CHECK(hashes.size() == 2000);
+}
+
+int main()
+{
+    std::mt19937_64 rng(15);
+    testSaturatedArithmetic(rng);
+    testFromPack();
+    testHashAndEquality();
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+﻿///写入缓冲区的格式化函数的测试:缓冲区足够时与返回std::string的版本输出相同,不足时返回FormatFailed,长度为0的有效结果返回0,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -g -fsanitize=address,undefined -I.. FormatBufferTest.cpp ../UnitConvertor.cpp -o ucformattest
+///用法: ucformattest,全部通过时返回0,否则输出失败的检查并返回1
+
+#include "UnitConvertor.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+///同一种格式的两个版本
+struct Format
+{
+    const char* name;
+    std::function<std::string(const ValuePack&)> string;
+    std::function<std::size_t(const ValuePack&,char*,std::size_t)> buffer;
+};
+
+static const std::vector<Format>& formats()
+{
+    static const std::vector<Format> list = {
+        {"numericPart",[](const ValuePack& p){ return Uc::numericPart(p); },[](const ValuePack& p,char* b,std::size_t n){ return Uc::numericPart(p,b,n); }},
+        {"unitPart",[](const ValuePack& p){ return Uc::unitPart(p); },[](const ValuePack& p,char* b,std::size_t n){ return Uc::unitPart(p,b,n); }},
+        {"toString",[](const ValuePack& p){ return Uc::toString(p); },[](const ValuePack& p,char* b,std::size_t n){ return Uc::toString(p,b,n); }},
+        {"toFormatString/fixed",[](const ValuePack& p){ return Uc::toFormatString(p,3); },[](const ValuePack& p,char* b,std::size_t n){ return Uc::toFormatString(p,b,n,3); }},
+        {"toFormatString/general",[](const ValuePack& p){ return Uc::toFormatString(p,4,false); },[](const ValuePack& p,char* b,std::size_t n){ return Uc::toFormatString(p,b,n,4,false); }},
+        {"toFormatString/width",[](const ValuePack& p){ return Uc::toFormatString(p,10,3,'0'); },[](const ValuePack& p,char* b,std::size_t n){ return Uc::toFormatString(p,b,n,10,3,'0'); }},
+        {"toScientificString",[](const ValuePack& p){ return Uc::toScientificString(p); },[](const ValuePack& p,char* b,std::size_t n){ return Uc::toScientificString(p,b,n); }},
+        {"toScientificString/precision",[](const ValuePack& p){ return Uc::toScientificString(p,2); },[](const ValuePack& p,char* b,std::size_t n){ return Uc::toScientificString(p,b,n,2); }},
+    };
+    return list;
+}
+
+///每一种长度的缓冲区:长度不小于结果时写入相同的内容,否则返回FormatFailed
+static void testEverySize()
+{
+    const ValuePack packs[] = {ValuePack(12.5,Uc::Kilo,Uc::Freq),ValuePack(-0.001,Uc::Milli,Uc::Voltage),ValuePack(0,Uc::One,Uc::Null),
+                               ValuePack(1e300,Uc::One,Uc::Null),ValuePack(std::nan(""),Uc::Micro,Uc::Time),ValuePack(3,Uc::One,Uc::Percent)};
+    for(const Format& format : formats())
+    {
+        bool same = true;
+        for(const ValuePack& pack : packs)
+        {
+            const std::string expected = format.string(pack);
+            std::vector<char> buffer(expected.size() + 8);
+            for(std::size_t size = 0; size <= buffer.size(); size++)
+            {
+                const std::size_t len = format.buffer(pack,buffer.data(),size);
+                if(size >= expected.size())
+                    same = same && len == expected.size() && std::string(buffer.data(),len) == expected;
+                else
+                    same = same && len == Uc::FormatFailed;
+            }
+        }
+        if(!same)
+            std::printf("%s: buffer version differs\n",format.name);
+        CHECK(same);
+    }
+}
+
+///没有数量级和单位时unitPart的结果为空字符串,即使缓冲区长度为0也是成功
+static void testEmptyUnitPart()
+{
+    const ValuePack pack(5,Uc::One,Uc::Null);
+    char buffer[4];
+    CHECK(Uc::unitPart(pack,buffer,sizeof(buffer)) == 0);
+    CHECK(Uc::unitPart(pack,nullptr,0) == 0);
+    CHECK(Uc::unitPart(ValuePack(5,Uc::Kilo,Uc::Freq),buffer,2) == Uc::FormatFailed);
+    CHECK(Uc::unitPart(ValuePack(5,Uc::Kilo,Uc::Freq),buffer,3) == 3 && std::string(buffer,3) == "kHz");
+    CHECK(Uc::toString(pack,nullptr,0) == Uc::FormatFailed);
+}
+
+int main()
+{
+    testEverySize();
+    testEmptyUnitPart();
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+﻿///fromString的差分测试:随机生成的字符串分别交给当前的线性扫描实现和冻结的旧版正则表达式实现,两者的结果必须相同
+///编译: g++ -std=c++17 -O2 -I.. FromStringDifferentialTest.cpp ../UnitConvertor.cpp -o ucfromstringtest
+///用法: ucfromstringtest [count] [seed],默认生成200000个字符串,全部相同时返回0,否则输出不同的输入并返回1
+///旧版不支持科学计数法,数值后面带有指数部分(如"1.5e-3")的输入是有意的差别,不参与比较,单独检查新版的结果
+
+#include "UnitConvertor.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <regex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace Uc = UnitConvertor;
+
+///替换为线性扫描之前的fromString,除了适配string_view的字符串数组之外保持原样,作为比较的基准
+namespace Reference
+{
+std::string toLower(const std::string& str)
+{
+    std::string result = str;
+    std::transform(result.begin(), result.end(), result.begin(),[](unsigned char c) { return std::tolower(c); });
+    return result;
+}
+
+///获取比例字符串和枚举值的映射关系
+static const std::unordered_map<std::string,std::size_t>& ratioMap()
+{
+    static const std::unordered_map<std::string,std::size_t> map = []{
+        std::unordered_map<std::string,std::size_t> result;
+        for(int i = 0; i < Uc::RatioNum; i++)
+            result.emplace(std::string(Uc::DecimalRatioString[i]),i);
+        return result;
+    }();
+    return map;
+}
+
+///获取单位字符串和枚举值的映射关系
+static const std::unordered_map<std::string,std::size_t>& unitMap()
+{
+    static const std::unordered_map<std::string,std::size_t> map = []{
+        std::unordered_map<std::string,std::size_t> result;
+        for(int i = 0; i < Uc::UnitNum; i++)
+            result.emplace(toLower(std::string(Uc::DecimalUnitString[i])),i);//查找单位时转换为小写
+        return result;
+    }();
+    return map;
+}
+
+///转义正则表达式特殊字符
+const std::string escapeRegex(const std::string &str)
+{
+    std::string result;
+    for (char c : str)
+    {
+        if (c == '.' || c == '*' || c == '+' || c == '?' || c == '^' ||
+            c == '$' || c == '|' || c == '(' || c == ')' || c == '[' ||
+            c == ']' || c == '{' || c == '}' || c == '\\')
+        {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+///自定义比较函数对象
+struct LengthCompare
+{
+    bool operator()(const std::string& a, const std::string& b) const {
+        if (a.length() != b.length())
+        {
+            return a.length() > b.length(); // 长度长的在前
+        }
+        return a < b; // 长度相同时按字典序排列
+    }
+};
+
+///生成一个可以自动匹配string数组中各个字符串的正则表达式
+const std::string generateRegexString(const std::string_view *array, const std::size_t arraySize)
+{
+    std::set<std::string, LengthCompare> stringSet;
+    // 按长度降序排序，确保长匹配优先
+    for (size_t i = 0; i < arraySize; ++i)
+    {
+        if (!array[i].empty())
+        {
+            stringSet.insert(std::string(array[i]));
+        }
+    }
+
+    std::string pattern;
+    pattern.append("(");
+
+    // 构建正则表达式字符串
+    for (auto it = stringSet.begin(); it != stringSet.end(); ++it)
+    {
+        if (it != stringSet.begin())
+            pattern.append("|");
+
+        pattern.append(escapeRegex(*it));
+    }
+    pattern.append( ")+");
+    return pattern;
+}
+
+const std::regex& ratioRegex()
+{
+    //数量级必须区分大小写,因为m和M会重复
+    static const std::regex instance(generateRegexString(Uc::DecimalRatioString,Uc::RatioNum));
+    return instance;
+}
+
+const std::regex& unitRegex()
+{
+    static const std::regex instance(generateRegexString(Uc::DecimalUnitString,Uc::UnitNum),std::regex_constants::icase);
+    return instance;
+}
+
+const std::regex& decimalRegex()
+{
+    static const std::regex  reg(R"(-?\d*\.?\d+)",std::regex_constants::icase);
+    return reg;
+}
+
+///通过三个字符串生成数据包
+ValuePack generateValuePack(const std::string& valueStr,const std::string& ratioStr,const std::string& unitStr)
+{
+    double value = std::stod(valueStr);
+    Uc::DecimalRatio ratio;
+    Uc::DecimalUnit unit ;
+
+    try {
+        ratio = static_cast<Uc::DecimalRatio>(ratioMap().at(ratioStr));
+    } catch (const std::out_of_range&) {
+        ratio = Uc::One;
+    }
+
+    try {
+        unit = static_cast<Uc::DecimalUnit>(unitMap().at(toLower(unitStr)));//查找单位时转换为小写
+    } catch (const std::out_of_range&) {
+        unit = Uc::Null;
+    }
+
+    return ValuePack(value,ratio,unit);
+}
+
+ValuePack fromString(const std::string &target,Uc::DecimalUnit unit)
+{
+    std::string valueStr = "0";
+    std::string ratioStr;
+    std::string unitStr;
+
+    const char* begin = target.data();
+    const char* end = begin + target.length();
+
+    //先查找数字对应的字符串,允许查找结果为空,查找失败时字符串会保持为空
+    const std::regex& decimalReg = decimalRegex();
+    std::cregex_iterator decimalBeg(begin,end,decimalReg);
+    std::cregex_iterator decimalEnd;
+    if(std::distance(decimalBeg,decimalEnd) == 1)//如果查找到的数字字符串不等于1(多余或者少于1都认为是错误的,此时让值保持为默认值0)
+    {
+        valueStr = decimalBeg->str();
+        begin += decimalBeg->str().length();//移动指针缩小查找范围
+    }
+
+    //再查找单位对应的字符串(DecimalUnit的底层类型已经改为无符号,原来的std::abs去掉)
+    if(unit < Uc::DecimalUnit::UnitNum)//避免传入的值超出枚举范围,使用static_cast是有可能的
+    {
+        unitStr = std::string(Uc::DecimalUnitString[unit]);
+    }
+    else
+    {
+        const std::regex& unitReg = unitRegex();
+        std::cregex_iterator unitBeg(begin,end,unitReg);
+        std::cregex_iterator unitEnd;
+        if(std::distance(unitBeg,unitEnd) == 1)//如果查找到的数字字符串不等于1(多余或者少于1都认为是错误的,此时让值保持为默认值0)
+        {
+            unitStr = unitBeg->str();
+            end -= unitBeg->str().length();//再次缩写查找范围
+        }
+    }
+
+    const std::regex& ratioReg = ratioRegex();
+    std::cregex_iterator ratioBeg(begin,end,ratioReg);
+    std::cregex_iterator ratioEnd;
+    if(std::distance(ratioBeg,ratioEnd) == 1)//如果查找到的数字字符串不等于1(多余或者少于1都认为是错误的,此时让值保持为默认值0)
+    {
+        ratioStr = ratioBeg->str();
+    }
+
+    //最后将查找到的三个字符串转换为数据包
+    return generateValuePack(valueStr,ratioStr,unitStr);
+}
+}
+
+///解析结果:抛出的异常类型或者得到的数据包
+struct Outcome
+{
+    enum Kind{Value,OutOfRange,OtherError} kind = Value;
+    ValuePack pack;
+
+    bool operator == (const Outcome& other) const
+    {
+        if(kind != other.kind)
+            return false;
+        if(kind != Value)
+            return true;
+        const double x = pack.value();
+        const double y = other.pack.value();
+        return std::memcmp(&x,&y,sizeof(double)) == 0 && pack.ratio() == other.pack.ratio() && pack.unit() == other.pack.unit();
+    }
+};
+
+template<typename Parse>
+static Outcome parse(Parse parseFunction,const std::string& target,Uc::DecimalUnit unit)
+{
+    Outcome outcome;
+    try
+    {
+        outcome.pack = parseFunction(target,unit);
+    }
+    catch(const std::out_of_range&)
+    {
+        outcome.kind = Outcome::OutOfRange;
+    }
+    catch(...)
+    {
+        outcome.kind = Outcome::OtherError;
+    }
+    return outcome;
+}
+
+///数字后面紧跟着e[+-]数字:新版把指数部分算作数值的一部分,旧版会把它拆成两个数值,这是有意的差别
+static bool hasExponent(const std::string& s)
+{
+    for(std::size_t i = 0; i + 2 < s.length(); i++)
+    {
+        if(!std::isdigit(static_cast<unsigned char>(s[i])) || (s[i + 1] != 'e' && s[i + 1] != 'E'))
+            continue;
+        std::size_t j = i + 2;
+        if(s[j] == '+' || s[j] == '-')
+            ++j;
+        if(j < s.length() && std::isdigit(static_cast<unsigned char>(s[j])))
+            return true;
+    }
+    return false;
+}
+
+///由数值、数量级、单位、分隔符和干扰字符的片段随机拼接,覆盖多个数值、多个单位和前后缀文本
+static std::string makeInput(std::mt19937& rng)
+{
+    static const char* const pieces[] = {
+        "0","1","12","3.5",".25","-","-7","-.5","5.",".","e","E","e3","1e5","+"," ","  ",
+        "n","u","m","k","M","G","Hz","hz","HZ","s","S","Vpp","vpp","V","v","A","a","°","Sa/s","sa/s","V*s","%",
+        "x","mk","kHz","ms","MHz","abc",":",",","Freq: ","*","/","p","9999999","0.000001"};
+    constexpr std::size_t PieceNum = sizeof(pieces) / sizeof(pieces[0]);
+
+    std::string s;
+    if(rng() % 2)
+        s += pieces[rng() % 4];     //大部分真实输入以数字开头
+    const int count = 1 + static_cast<int>(rng() % 5);
+    for(int i = 0; i < count; i++)
+        s += pieces[rng() % PieceNum];
+    return s;
+}
+
+int main(int argc,char** argv)
+{
+    const long count = argc > 1 ? std::atol(argv[1]) : 200000;
+    std::mt19937 rng(argc > 2 ? static_cast<unsigned>(std::atol(argv[2])) : 42u);
+
+    long compared = 0;
+    long exponents = 0;
+    long failures = 0;
+    for(long i = 0; i < count; i++)
+    {
+        const std::string target = makeInput(rng);
+        //四分之一的输入指定单位,其余由字符串决定单位
+        const Uc::DecimalUnit unit = rng() % 4 == 0 ? static_cast<Uc::DecimalUnit>(rng() % Uc::UnitNum) : Uc::UnitNum;
+        const Outcome expected = parse(Reference::fromString,target,unit);
+        const Outcome actual = parse(Uc::fromString,target,unit);
+        if(hasExponent(target))
+        {
+            ++exponents;
+            continue;
+        }
+        ++compared;
+        if(expected == actual)
+            continue;
+        if(failures++ < 20)
+            std::printf("[%s] unit=%d: reference=%d %g %d %d, scanner=%d %g %d %d\n",target.c_str(),unit,
+                        expected.kind,expected.pack.value(),expected.pack.ratio(),expected.pack.unit(),
+                        actual.kind,actual.pack.value(),actual.pack.ratio(),actual.pack.unit());
+    }
+
+    //有意的差别:指数部分属于数值
+    const ValuePack scientific = Uc::fromString("1.5e-3 kHz");
+    if(scientific.value() != 1.5e-3 || scientific.ratio() != Uc::Kilo || scientific.unit() != Uc::Freq)
+    {
+        ++failures;
+        std::printf("[1.5e-3 kHz]: scanner=%g %d %d\n",scientific.value(),scientific.ratio(),scientific.unit());
+    }
+
+    std::printf("%ld inputs compared, %ld with an exponent skipped, %ld different\n",compared,exponents,failures);
+    return failures == 0 ? 0 : 1;
+}
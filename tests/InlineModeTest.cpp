@@ -0,0 +1,132 @@
+﻿///UNITCONVERTOR_INLINE两种模式的对比测试:ValuePack的构造、访问、比较、加减以及ratioTo/proper在拆分和内联两种编译方式下的结果逐位相同
+///编译: g++ -std=c++17 -O2 -g -fsanitize=address,undefined -I.. InlineModeTest.cpp ../UnitConvertor.cpp -o ucinlinetest
+///      g++ -std=c++17 -O2 -g -fsanitize=address,undefined -DUNITCONVERTOR_INLINE -I.. InlineModeTest.cpp ../UnitConvertor.cpp -o ucinlinetest-inline
+///用法: ucinlinetest,检查本模式内的一致性,全部通过时返回0,否则输出失败的检查并返回1
+///所有结果的位模式合并为一个摘要输出在最后一行,两种模式的摘要必须相同(runTests.sh会比较)
+
+#include "UnitConvertor.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+///FNV-1a摘要
+class Digest
+{
+public:
+    void add(const void* data,std::size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for(std::size_t i = 0; i < size; i++)
+            m_Hash = (m_Hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+
+    void add(double value) { add(&value,sizeof(value)); }
+
+    void add(int value) { add(&value,sizeof(value)); }
+
+    void add(const ValuePack& pack)
+    {
+        add(pack.value());
+        add(static_cast<int>(pack.ratio()));
+        add(static_cast<int>(pack.unit()));
+    }
+
+    std::uint64_t value() const noexcept { return m_Hash; }
+
+private:
+    std::uint64_t m_Hash = 0xcbf29ce484222325ull;
+};
+
+static bool samePack(const ValuePack& a,const ValuePack& b)
+{
+    const double x = a.value();
+    const double y = b.value();
+    return std::memcmp(&x,&y,sizeof(double)) == 0 && a.ratio() == b.ratio() && a.unit() == b.unit();
+}
+
+int main()
+{
+    std::vector<Uc::DecimalUnit> units;
+    for(int unit = 0; unit < Uc::UnitNum; unit++)
+        units.push_back(static_cast<Uc::DecimalUnit>(unit));
+    units.push_back(Uc::registerUnit("B",Uc::One,Uc::Giga,1024));
+    units.push_back(Uc::registerUnit("rad",Uc::Nano,Uc::Giga,10));
+    //没有注册的单位
+    units.push_back(static_cast<Uc::DecimalUnit>(200));
+
+    const double values[] = {0.0,-0.0,1,-1,999.5,1000,1000.5,-1234567.25,0.000123,1e-300,1e300,std::nan(""),
+                             std::numeric_limits<double>::infinity(),std::numeric_limits<double>::denorm_min()};
+
+    Digest digest;
+    bool pow = true;
+    bool member = true;
+    for(Uc::DecimalUnit unit : units)
+    {
+        const UnitProperty p = Uc::generateUnitProperty(unit);
+        digest.add(static_cast<int>(p.minRatio));
+        digest.add(static_cast<int>(p.maxRatio));
+        digest.add(static_cast<int>(p.unit));
+        digest.add(static_cast<double>(p.Exp));
+        for(int ratio = 0; ratio < Uc::RatioNum; ratio++)
+        {
+            digest.add(static_cast<int>(Uc::limitRatio(unit,static_cast<Uc::DecimalRatio>(ratio))));
+            for(int newRatio = 0; newRatio < Uc::RatioNum; newRatio++)
+            {
+                const double factor = Uc::conversionFactor(unit,static_cast<Uc::DecimalRatio>(ratio),static_cast<Uc::DecimalRatio>(newRatio));
+                digest.add(factor);
+                pow = pow && (p.Exp == 0 || factor == std::pow(static_cast<double>(p.Exp),ratio - newRatio));
+            }
+            for(double value : values)
+            {
+                const ValuePack pack(value,static_cast<Uc::DecimalRatio>(ratio),unit);
+                digest.add(pack);
+                for(int newRatio = 0; newRatio < Uc::RatioNum; newRatio++)
+                {
+                    const ValuePack converted = Uc::ratioTo(pack,static_cast<Uc::DecimalRatio>(newRatio));
+                    ValuePack copy = pack;
+                    copy.ratioTo(static_cast<Uc::DecimalRatio>(newRatio));
+                    member = member && samePack(converted,copy);
+                    digest.add(converted);
+                }
+                const ValuePack shown = Uc::proper(pack);
+                ValuePack copy = pack;
+                copy.proper();
+                member = member && samePack(shown,copy);
+                digest.add(shown);
+
+                //与相同单位、不同数量级以及不同单位的数据包运算和比较
+                for(const ValuePack& other : {ValuePack(1.5,Uc::Kilo,unit),ValuePack(-2,Uc::Milli,unit),ValuePack(3,Uc::One,Uc::Freq)})
+                {
+                    digest.add(pack + other);
+                    digest.add(pack - other);
+                    ValuePack sum = pack;
+                    sum += other;
+                    sum -= other;
+                    digest.add(sum);
+                    digest.add((pack == other) + 2 * (pack != other) + 4 * (pack < other) + 8 * (pack > other) + 16 * (pack <= other) + 32 * (pack >= other));
+                }
+            }
+        }
+    }
+    CHECK(pow);
+    CHECK(member);
+    CHECK(ValuePack().value() == 0 && ValuePack().ratio() == Uc::One && ValuePack().unit() == Uc::Null);
+
+#ifdef UNITCONVERTOR_INLINE
+    const char* mode = "inline";
+#else
+    const char* mode = "split";
+#endif
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    std::printf("%s digest %016llx\n",mode,static_cast<unsigned long long>(digest.value()));
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+﻿///ParallelConvertor的测试:并行的批量函数与单线程的批量函数逐位相同,同一个对象反复执行批量任务时结果不受上一次任务影响,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -g -pthread -fsanitize=thread -I.. ParallelConvertorTest.cpp ../UnitConvertor.cpp ../ParallelConvertor.cpp -o ucparalleltest
+///用法: ucparalleltest,全部通过时返回0,否则输出失败的检查并返回1
+///使用ThreadSanitizer编译以检查工作线程之间的数据竞争,也可以换成-fsanitize=address,undefined
+///元素个数包括小于一个块(解析256个,数值转换16384个)而直接在调用线程中执行的情况,以及需要切分为多个块的情况
+
+#include "ParallelConvertor.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+static bool sameColumn(const Uc::ValueColumn& a,const Uc::ValueColumn& b)
+{
+    return a.size() == b.size() && a.ratios == b.ratios && a.units == b.units && a.flags == b.flags
+           && (a.size() == 0 || std::memcmp(a.values.data(),b.values.data(),a.size() * sizeof(double)) == 0);
+}
+
+///数值、数量级和单位随机组合,包括无法解析的文本和超出范围的数值,相邻元素的单位经常相同以形成连续的单位段
+static std::vector<std::string> makeTexts(std::size_t count,std::mt19937_64& rng)
+{
+    static const char* const ratios[] = {"n","u","m","","k","M","G"};
+    static const char* const units[] = {"Hz","s","V","A","Vpp","","%"};
+    std::vector<std::string> texts(count);
+    std::size_t unit = 0;
+    for(std::string& text : texts)
+    {
+        if(rng() % 8 == 0)
+            unit = rng() % (sizeof(units) / sizeof(units[0]));
+        switch(rng() % 16)
+        {
+        case 0: text = "abc"; break;
+        case 1: text = "1e999 s"; break;
+        case 2: text = ""; break;
+        default:
+            text = std::to_string(static_cast<double>(static_cast<std::int64_t>(rng() % 2000001) - 1000000) / 1000);
+            text += ' ';
+            text += ratios[rng() % (sizeof(ratios) / sizeof(ratios[0]))];
+            text += units[unit];
+            break;
+        }
+    }
+    return texts;
+}
+
+static void testMatchesSerial(Uc::ParallelConvertor& convertor,std::size_t count,std::mt19937_64& rng)
+{
+    const std::vector<std::string> texts = makeTexts(count,rng);
+    const std::vector<std::string_view> targets(texts.begin(),texts.end());
+
+    Uc::ValueColumn serial;
+    Uc::ValueColumn parallel;
+    const std::size_t serialFailed = Uc::fromStrings(targets.data(),count,serial);
+    const std::size_t parallelFailed = convertor.fromStrings(targets.data(),count,parallel);
+    CHECK(serialFailed == parallelFailed);
+    CHECK(sameColumn(serial,parallel));
+
+    //指定单位时所有元素的单位相同
+    Uc::ValueColumn serialFreq;
+    Uc::ValueColumn parallelFreq;
+    CHECK(Uc::fromStrings(targets.data(),count,serialFreq,Uc::Freq) == convertor.fromStrings(targets.data(),count,parallelFreq,Uc::Freq));
+    CHECK(sameColumn(serialFreq,parallelFreq));
+
+    Uc::ratioTo(serialFreq.values.data(),serialFreq.ratios.data(),count,Uc::Freq,Uc::Kilo);
+    convertor.ratioTo(parallelFreq.values.data(),parallelFreq.ratios.data(),count,Uc::Freq,Uc::Kilo);
+    CHECK(sameColumn(serialFreq,parallelFreq));
+    Uc::proper(serialFreq.values.data(),serialFreq.ratios.data(),count,Uc::Freq);
+    convertor.proper(parallelFreq.values.data(),parallelFreq.ratios.data(),count,Uc::Freq);
+    CHECK(sameColumn(serialFreq,parallelFreq));
+
+    //按单位分段转换
+    Uc::ratioTo(serial,Uc::Milli);
+    convertor.ratioTo(parallel,Uc::Milli);
+    CHECK(sameColumn(serial,parallel));
+    Uc::proper(serial);
+    convertor.proper(parallel);
+    CHECK(sameColumn(serial,parallel));
+
+    std::vector<ValuePack> packs(count);
+    for(std::size_t i = 0; i < count; i++)
+        packs[i] = ValuePack(serial.values[i],static_cast<Uc::DecimalRatio>(serial.ratios[i]),static_cast<Uc::DecimalUnit>(serial.units[i]));
+    const std::vector<std::string> strings = convertor.toStrings(packs.data(),count);
+    const std::vector<std::string> formatted = convertor.toStrings(packs.data(),count,[](const ValuePack& pack){ return Uc::toFormatString(pack,3); });
+    const std::vector<std::string> columnFormatted = convertor.toStrings(parallel,[](const ValuePack& pack){ return Uc::toScientificString(pack); });
+    bool same = strings.size() == count && formatted.size() == count && columnFormatted.size() == count;
+    for(std::size_t i = 0; same && i < count; i++)
+        same = strings[i] == Uc::toString(packs[i]) && formatted[i] == Uc::toFormatString(packs[i],3) && columnFormatted[i] == Uc::toScientificString(packs[i]);
+    CHECK(same);
+}
+
+///反复执行parallelFor:每一轮的每个下标都恰好被处理一次,上一轮的任务不会泄漏到下一轮
+static void testRepeatedRuns(Uc::ParallelConvertor& convertor)
+{
+    std::vector<std::atomic<int>> visits(10000);
+    bool exact = true;
+    for(int round = 1; round <= 200; round++)
+    {
+        const std::size_t count = 1 + static_cast<std::size_t>(round) * 37 % visits.size();
+        convertor.parallelFor(count,1,[&visits](std::size_t begin,std::size_t end){
+            for(std::size_t i = begin; i < end; i++)
+                visits[i].fetch_add(1,std::memory_order_relaxed);
+        });
+        for(std::size_t i = 0; i < visits.size(); i++)
+            exact = exact && visits[i].exchange(0,std::memory_order_relaxed) == (i < count ? 1 : 0);
+    }
+    CHECK(exact);
+}
+
+///某个块抛出的异常在所有块结束之后重新抛出,下一轮任务正常执行
+static void testException(Uc::ParallelConvertor& convertor)
+{
+    for(int round = 0; round < 20; round++)
+    {
+        std::atomic<std::size_t> processed{0};
+        bool thrown = false;
+        try
+        {
+            convertor.parallelFor(4096,64,[&processed](std::size_t begin,std::size_t end){
+                processed.fetch_add(end - begin,std::memory_order_relaxed);
+                if(begin <= 1000 && 1000 < end)
+                    throw std::runtime_error("bad chunk");
+            });
+        }
+        catch(const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        CHECK(thrown && processed.load() == 4096);
+
+        std::atomic<std::size_t> sum{0};
+        convertor.parallelFor(4096,64,[&sum](std::size_t begin,std::size_t end){
+            sum.fetch_add(end - begin,std::memory_order_relaxed);
+        });
+        CHECK(sum.load() == 4096);
+    }
+}
+
+///多个线程同时使用同一个对象,批量任务依次执行
+static void testConcurrentCallers(Uc::ParallelConvertor& convertor)
+{
+    std::vector<std::thread> callers;
+    std::atomic<int> wrong{0};
+    for(unsigned t = 0; t < 3; t++)
+    {
+        callers.emplace_back([&convertor,&wrong,t]{
+            const ValuePack expected = Uc::ratioTo(ValuePack(1500.0 + t,Uc::One,Uc::Freq),Uc::Kilo);
+            for(int round = 0; round < 20; round++)
+            {
+                std::vector<double> values(20000,1500.0 + t);
+                std::vector<std::uint8_t> ratios(values.size(),Uc::One);
+                convertor.ratioTo(values.data(),ratios.data(),values.size(),Uc::Freq,Uc::Kilo);
+                for(std::size_t i = 0; i < values.size(); i++)
+                    if(values[i] != expected.value() || ratios[i] != expected.ratio())
+                        wrong.fetch_add(1,std::memory_order_relaxed);
+            }
+        });
+    }
+    for(std::thread& caller : callers)
+        caller.join();
+    CHECK(wrong.load() == 0);
+}
+
+int main()
+{
+    static const std::size_t Counts[] = {0,1,7,255,256,257,1000,5000,16383,16385,70000};
+    for(unsigned threads : {1u,2u,4u,0u})
+    {
+        Uc::ParallelConvertor convertor(threads);
+        CHECK(convertor.threadCount() >= 1 && (threads == 0 || convertor.threadCount() == threads));
+        std::mt19937_64 rng(threads + 1);
+        //同一个对象连续执行两遍,检查重复使用时的结果
+        for(int repeat = 0; repeat < 2; repeat++)
+            for(std::size_t count : Counts)
+                testMatchesSerial(convertor,count,rng);
+        testRepeatedRuns(convertor);
+        testException(convertor);
+        testConcurrentCallers(convertor);
+    }
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
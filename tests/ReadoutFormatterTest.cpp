@@ -0,0 +1,173 @@
+﻿///ReadoutFormatter的测试:按照脚本输入一系列读数,检查每一步显示的字符串、数量级和返回值,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -g -fsanitize=address,undefined -I.. ReadoutFormatterTest.cpp ../UnitConvertor.cpp ../ReadoutFormatter.cpp -o ucreadouttest
+///用法: ucreadouttest,全部通过时返回0,否则输出失败的步骤并返回1
+
+#include "ReadoutFormatter.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+///一次读数和期望的结果:update的返回值、显示的字符串和数量级
+struct Step
+{
+    double value;
+    Uc::DecimalRatio ratio;
+    bool changed;
+    const char* text;
+    Uc::DecimalRatio shown;
+};
+
+template<std::size_t N>
+static void runScript(Uc::ReadoutFormatter& formatter,const Step (&steps)[N],int line)
+{
+    for(std::size_t i = 0; i < N; i++)
+    {
+        const Step& step = steps[i];
+        const bool changed = formatter.update(step.value,step.ratio);
+        if(changed != step.changed || formatter.text() != step.text || formatter.ratio() != step.shown)
+        {
+            ++failures;
+            std::printf("%s:%d: step %zu (%.17g, ratio %d): got %d [%s] ratio %d, expected %d [%s] ratio %d\n",__FILE__,line,i,step.value,step.ratio,
+                        changed,formatter.text().c_str(),formatter.ratio(),step.changed,step.text,step.shown);
+        }
+    }
+}
+
+///回差为5%:超过1000 * 1.05 = 1050或者低于1 / 1.05 = 0.952时才切换数量级
+static void testHysteresisBand()
+{
+    Uc::ReadoutFormatter formatter(Uc::Voltage);
+    CHECK(formatter.text().empty() && formatter.hysteresis() == 0.05);
+    static const Step steps[] = {
+        {999,Uc::Milli,true,"999 mV",Uc::Milli},
+        {1000,Uc::Milli,true,"1000 mV",Uc::Milli},
+        {1049.9,Uc::Milli,true,"1049.900 mV",Uc::Milli},     //在回差范围内,保持mV
+        {1050.1,Uc::Milli,true,"1.050 V",Uc::One},           //超出上限,重新选择数量级
+        {1.0,Uc::One,true,"1 V",Uc::One},
+        {0.953,Uc::One,true,"0.953 V",Uc::One},              //低于1但在回差范围内,保持V
+        {1.02,Uc::One,true,"1.020 V",Uc::One},
+        {0.952,Uc::One,true,"952 mV",Uc::Milli},             //低于下限
+        {1.02,Uc::One,true,"1020 mV",Uc::Milli},             //读数的数量级与显示的数量级无关
+        {5000,Uc::Kilo,true,"5000 kV",Uc::Kilo},             //已经是最大的数量级
+        {2e6,Uc::Kilo,true,"2000000 kV",Uc::Kilo},
+        {0.5,Uc::Micro,true,"0.500 uV",Uc::Micro},           //已经是最小的数量级
+    };
+    runScript(formatter,steps,__LINE__);
+}
+
+///回差为0时与proper()选择的数量级相同
+static void testZeroHysteresis()
+{
+    Uc::ReadoutFormatter formatter(Uc::Freq,3,true,0);
+    static const Step steps[] = {
+        {999.5,Uc::One,true,"999.500 Hz",Uc::One},
+        {1000,Uc::One,true,"1000 Hz",Uc::One},
+        {1000.5,Uc::One,true,"1 kHz",Uc::Kilo},
+        {0.9995,Uc::Kilo,true,"999.500 Hz",Uc::One},
+    };
+    runScript(formatter,steps,__LINE__);
+
+    formatter.setHysteresis(-1);
+    CHECK(formatter.hysteresis() == 0);
+    std::mt19937_64 rng(14);
+    bool same = true;
+    for(int i = 0; i < 10000; i++)
+    {
+        const ValuePack sample(std::ldexp(static_cast<double>(rng() % 2000000) - 1000000,static_cast<int>(rng() % 40) - 30),
+                               static_cast<Uc::DecimalRatio>(rng() % Uc::RatioNum),Uc::Freq);
+        formatter.update(sample);
+        same = same && formatter.ratio() == Uc::proper(sample).ratio();
+    }
+    CHECK(same);
+}
+
+///显示的数字不变时不重新格式化,返回false;符号改变时即使数字相同也重新格式化
+static void testSkipAndSign()
+{
+    Uc::ReadoutFormatter formatter(Uc::Voltage);
+    static const Step steps[] = {
+        {950,Uc::Milli,true,"950 mV",Uc::Milli},
+        {950.0001,Uc::Milli,false,"950 mV",Uc::Milli},
+        {950.0004,Uc::Milli,false,"950 mV",Uc::Milli},
+        {950.0006,Uc::Milli,true,"950.001 mV",Uc::Milli},
+        {950.0014,Uc::Milli,false,"950.001 mV",Uc::Milli},
+        {-950.0014,Uc::Milli,true,"-950.001 mV",Uc::Milli},
+        {-950.0009,Uc::Milli,false,"-950.001 mV",Uc::Milli},
+        {950.0009,Uc::Milli,true,"950.001 mV",Uc::Milli},
+        {0.0004,Uc::Milli,true,"0.400 uV",Uc::Micro},
+        {-0.0004,Uc::Milli,true,"-0.400 uV",Uc::Micro},
+        {-0.0,Uc::Milli,true,"-0 uV",Uc::Micro},
+        {0.0,Uc::Milli,true,"0 uV",Uc::Micro},
+        {0.0,Uc::Milli,false,"0 uV",Uc::Micro},
+    };
+    runScript(formatter,steps,__LINE__);
+
+    //单位改变时重新开始
+    CHECK(formatter.update(ValuePack(3,Uc::Kilo,Uc::Freq)));
+    CHECK(formatter.unit() == Uc::Freq && formatter.ratio() == Uc::Kilo && formatter.text() == "3 kHz");
+    formatter.reset();
+    CHECK(formatter.text().empty() && formatter.ratio() == Uc::One);
+    CHECK(formatter.update(2500,Uc::One) && formatter.text() == "2.500 kHz");
+}
+
+///宽度格式:四舍五入之后进位改变了整数部分的位数
+static void testWidthFormat()
+{
+    Uc::ReadoutFormatter formatter(Uc::Freq,8,2,' ',0);
+    static const Step steps[] = {
+        {999.994,Uc::One,true,"  999.99 Hz",Uc::One},
+        {999.996,Uc::One,true," 1000 Hz",Uc::One},
+        {1000,Uc::One,false," 1000 Hz",Uc::One},
+        {1000.004,Uc::One,true,"    1 kHz",Uc::Kilo},
+        {1000.006,Uc::One,false,"    1 kHz",Uc::Kilo},
+        {-1000.006,Uc::One,true,"   -1 kHz",Uc::Kilo},
+    };
+    runScript(formatter,steps,__LINE__);
+}
+
+///跳过重新格式化时显示的字符串必须与直接格式化当前读数的结果相同
+static void testSkipMatchesFormat()
+{
+    std::mt19937_64 rng(41);
+    Uc::ReadoutFormatter formatter(Uc::Time);
+    double value = 0.9;
+    bool same = true;
+    bool reported = true;
+    int skipped = 0;
+    for(int i = 0; i < 100000; i++)
+    {
+        //在数量级边界附近随机游走,步长从远小于显示精度到大于显示精度
+        value += std::ldexp(static_cast<double>(static_cast<std::int64_t>(rng() % 2001) - 1000),-static_cast<int>(rng() % 30) - 8);
+        if(rng() % 1000 == 0)
+            value = -value;
+        const std::string before = formatter.text();
+        const bool changed = formatter.update(value,Uc::Milli);
+        const ValuePack shown = Uc::ratioTo(ValuePack(value,Uc::Milli,Uc::Time),formatter.ratio());
+        same = same && formatter.text() == Uc::toFormatString(shown,3);
+        reported = reported && changed == (formatter.text() != before);
+        skipped += changed ? 0 : 1;
+    }
+    CHECK(same);
+    CHECK(reported);
+    CHECK(skipped > 1000);
+}
+
+int main()
+{
+    testHysteresisBand();
+    testZeroHysteresis();
+    testSkipAndSign();
+    testWidthFormat();
+    testSkipMatchesFormat();
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
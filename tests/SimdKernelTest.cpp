@@ -0,0 +1,245 @@
+﻿///数组转换的SIMD实现与标量实现的对比测试:CPU支持的每一个指令集的结果都必须与标量实现逐位相同
+///编译: g++ -std=c++17 -O2 -g -fsanitize=address,undefined -I.. SimdKernelTest.cpp -o ucsimdtest
+///用法: ucsimdtest,全部通过时返回0,否则输出失败的检查并返回1
+///各个指令集的实现是UnitConvertor.cpp中的静态函数,所以这里直接包含UnitConvertor.cpp,不再单独链接它
+///统计(summarize)的各个通道分别求和,求和顺序与标量实现不同,所以和与平方和只要求相对误差足够小,个数、最小值和最大值必须相同
+
+#include "../UnitConvertor.cpp"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+static const char* const LevelName[] = {"scalar","sse2","avx2","avx512"};
+
+static bool sameBits(const std::vector<double>& a,const std::vector<double>& b)
+{
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(),b.data(),a.size() * sizeof(double)) == 0);
+}
+
+///普通数值、整数、NaN、±0、±inf、非规格化数以及接近进制边界的数值
+static std::vector<double> makeValues(std::size_t count,std::mt19937_64& rng)
+{
+    static const double special[] = {
+        std::nan(""),-std::nan(""),0.0,-0.0,std::numeric_limits<double>::infinity(),-std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::denorm_min(),-std::numeric_limits<double>::denorm_min(),1e-310,-3e-320,
+        std::numeric_limits<double>::min(),std::numeric_limits<double>::max(),-std::numeric_limits<double>::max(),
+        1000,1000.0000000000001,999.99999999999989,1,0.99999999999999989,-1000,-1,1e-9,1e12,-4.5e15};
+    std::vector<double> values(count);
+    for(double& v : values)
+    {
+        switch(rng() % 4)
+        {
+        case 0: v = special[rng() % (sizeof(special) / sizeof(special[0]))]; break;
+        case 1: v = static_cast<double>(static_cast<std::int64_t>(rng() % 2000001) - 1000000); break;
+        default: v = std::ldexp(static_cast<double>(static_cast<std::int64_t>(rng()) >> 11),static_cast<int>(rng() % 120) - 100); break;
+        }
+    }
+    return values;
+}
+
+///所有合法的数量级,包括超出单位范围的数量级(proper不会把它们移回范围内,只要求与标量实现相同)
+static std::vector<std::uint8_t> makeRatios(std::size_t count,std::mt19937_64& rng)
+{
+    std::vector<std::uint8_t> ratios(count);
+    for(std::uint8_t& r : ratios)
+        r = static_cast<std::uint8_t>(rng() % RatioNum);
+    return ratios;
+}
+
+static void scaleAt(SimdLevel level,double* values,std::size_t count,double factor)
+{
+    switch(level)
+    {
+#if UC_SIMD_X86
+    case SimdAvx512:scaleAvx512(values,count,factor);break;
+    case SimdAvx2:scaleAvx2(values,count,factor);break;
+    case SimdSse2:scaleSse2(values,count,factor);break;
+#endif
+    default:scaleScalar(values,count,factor);break;
+    }
+}
+
+static void scaleEachAt(SimdLevel level,double* values,const std::uint8_t* ratios,std::size_t count,const double* factors)
+{
+    switch(level)
+    {
+#if UC_SIMD_X86
+    case SimdAvx512:scaleEachAvx512(values,ratios,count,factors);break;
+    case SimdAvx2:scaleEachAvx2(values,ratios,count,factors);break;
+    case SimdSse2:scaleEachSse2(values,ratios,count,factors);break;
+#endif
+    default:scaleEachScalar(values,ratios,count,factors);break;
+    }
+}
+
+static void properAt(SimdLevel level,double* values,std::uint8_t* ratios,std::size_t count,const UnitProperty& p)
+{
+    switch(level)
+    {
+#if UC_SIMD_X86
+    case SimdAvx512:properAvx512(values,ratios,count,p);break;
+    case SimdAvx2:properAvx2(values,ratios,count,p);break;
+    case SimdSse2:properSse2(values,ratios,count,p);break;
+#endif
+    default:properScalar(values,ratios,count,p);break;
+    }
+}
+
+///与summarize的分派相同,AVX-512使用AVX2的实现
+static ColumnSummary summarizeAt(SimdLevel level,const double* values,std::size_t count,double factor)
+{
+    switch(level)
+    {
+#if UC_SIMD_X86
+    case SimdAvx512:
+    case SimdAvx2:return summarizeAvx2(values,count,factor);
+    case SimdSse2:return summarizeSse2(values,count,factor);
+#endif
+    default:return summarizeScalar(values,count,factor);
+    }
+}
+
+///0~67覆盖每种向量宽度下的所有尾部长度,再加上几个较长的数组;offset为1时数组不对齐
+static const std::size_t Lengths[] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,15,16,17,23,31,33,63,64,65,67,255,1001};
+
+static void testScale(SimdLevel level,const std::vector<UnitProperty>& units,std::mt19937_64& rng)
+{
+    bool same = true;
+    for(std::size_t length : Lengths)
+    {
+        for(std::size_t offset = 0; offset < 2; offset++)
+        {
+            const std::vector<double> input = makeValues(length + offset,rng);
+            const std::vector<std::uint8_t> ratios = makeRatios(length + offset,rng);
+            for(const UnitProperty& p : units)
+            {
+                for(int newRatio = p.minRatio; newRatio <= p.maxRatio; newRatio++)
+                {
+                    double factors[RatioNum];
+                    for(int ratio = 0; ratio < RatioNum; ratio++)
+                        factors[ratio] = ratioFactor(p.unit,ratio,newRatio);
+
+                    std::vector<double> expected = input;
+                    std::vector<double> actual = input;
+                    scaleScalar(expected.data() + offset,length,factors[length % RatioNum]);
+                    scaleAt(level,actual.data() + offset,length,factors[length % RatioNum]);
+                    same = same && sameBits(expected,actual);
+
+                    expected = input;
+                    actual = input;
+                    scaleEachScalar(expected.data() + offset,ratios.data() + offset,length,factors);
+                    scaleEachAt(level,actual.data() + offset,ratios.data() + offset,length,factors);
+                    same = same && sameBits(expected,actual);
+                }
+            }
+        }
+    }
+    if(!same)
+        std::printf("%s: scale differs from the scalar implementation\n",LevelName[level]);
+    CHECK(same);
+}
+
+static void testProper(SimdLevel level,const std::vector<UnitProperty>& units,std::mt19937_64& rng)
+{
+    bool same = true;
+    for(std::size_t length : Lengths)
+    {
+        for(std::size_t offset = 0; offset < 2; offset++)
+        {
+            const std::vector<double> input = makeValues(length + offset,rng);
+            const std::vector<std::uint8_t> inputRatios = makeRatios(length + offset,rng);
+            for(const UnitProperty& p : units)
+            {
+                std::vector<double> expected = input;
+                std::vector<double> actual = input;
+                std::vector<std::uint8_t> expectedRatios = inputRatios;
+                std::vector<std::uint8_t> actualRatios = inputRatios;
+                properScalar(expected.data() + offset,expectedRatios.data() + offset,length,p);
+                properAt(level,actual.data() + offset,actualRatios.data() + offset,length,p);
+                same = same && sameBits(expected,actual) && expectedRatios == actualRatios;
+            }
+        }
+    }
+    if(!same)
+        std::printf("%s: proper differs from the scalar implementation\n",LevelName[level]);
+    CHECK(same);
+}
+
+///数量级被限制在单位的范围内:很大的数值停在maxRatio,很小的数值停在minRatio
+static void testProperClamp(SimdLevel level)
+{
+    const UnitProperty freq = generateUnitProperty(Freq);
+    std::vector<double> values(19,1e30);
+    std::vector<std::uint8_t> ratios(19,One);
+    for(std::size_t i = 10; i < values.size(); i++)
+        values[i] = 1e-30;
+    properAt(level,values.data(),ratios.data(),values.size(),freq);
+    for(std::size_t i = 0; i < values.size(); i++)
+    {
+        const bool large = i < 10;
+        CHECK(ratios[i] == (large ? freq.maxRatio : freq.minRatio));
+        CHECK(values[i] == (large ? 1e30 / 1000 / 1000 / 1000 : 1e-30));
+    }
+}
+
+static bool close(double a,double b)
+{
+    return a == b || std::abs(a - b) <= 1e-12 * std::max(std::abs(a),std::abs(b));
+}
+
+static void testSummarize(SimdLevel level,std::mt19937_64& rng)
+{
+    bool same = true;
+    for(std::size_t length : Lengths)
+    {
+        std::vector<double> values = makeValues(length,rng);
+        //统计时去掉inf和很大的数值,否则和与平方和本身就是inf或者被舍入误差淹没
+        for(double& v : values)
+            if(!std::isnan(v) && !(std::abs(v) < 1e15))
+                v = std::copysign(1e15,v);
+        for(double factor : {1.0,1e-3,1e6})
+        {
+            const ColumnSummary expected = summarizeScalar(values.data(),length,factor);
+            const ColumnSummary actual = summarizeAt(level,values.data(),length,factor);
+            same = same && expected.count == actual.count && expected.min == actual.min && expected.max == actual.max
+                   && close(expected.sum,actual.sum) && close(expected.mean,actual.mean)
+                   && std::abs(expected.m2 - actual.m2) <= 1e-12 * std::max(1.0,expected.m2);
+        }
+    }
+    if(!same)
+        std::printf("%s: summarize differs from the scalar implementation\n",LevelName[level]);
+    CHECK(same);
+}
+
+int main()
+{
+    //内置单位加上两个进制不是1000的注册单位
+    std::vector<UnitProperty> units;
+    for(int unit = 0; unit < UnitNum; unit++)
+        units.push_back(generateUnitProperty(static_cast<DecimalUnit>(unit)));
+    units.push_back(generateUnitProperty(registerUnit("B",One,Giga,1024)));
+    units.push_back(generateUnitProperty(registerUnit("rad",Nano,Giga,10)));
+
+    const SimdLevel supported = detectSimdLevel();
+    for(int level = SimdScalar; level <= SimdAvx512; level++)
+    {
+        if(level > supported)
+        {
+            std::printf("%s: not supported by this CPU, skipped\n",LevelName[level]);
+            continue;
+        }
+        std::mt19937_64 rng(17);
+        testScale(static_cast<SimdLevel>(level),units,rng);
+        testProper(static_cast<SimdLevel>(level),units,rng);
+        testProperClamp(static_cast<SimdLevel>(level));
+        testSummarize(static_cast<SimdLevel>(level),rng);
+    }
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+﻿///SortedIndex和排序键的测试:SortKeyLess满足严格弱序,基数排序与std::stable_sort的结果相同,区间查询的边界正确,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -g -fsanitize=address,undefined -I.. SortedIndexTest.cpp ../UnitConvertor.cpp ../SortedIndex.cpp -o ucsorttest
+///用法: ucsorttest,全部通过时返回0,否则输出失败的检查并返回1
+
+#include "SortedIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+static bool samePack(const ValuePack& a,const ValuePack& b)
+{
+    const double x = a.value();
+    const double y = b.value();
+    return std::memcmp(&x,&y,sizeof(double)) == 0 && a.ratio() == b.ratio() && a.unit() == b.unit();
+}
+
+///直接写入数量级和单位字节:构造函数会把数量级限制在单位的范围内,这里模拟从文件或者共享内存中读到的任意字节
+static ValuePack rawPack(double value,std::uint8_t ratio,std::uint8_t unit)
+{
+    static_assert(sizeof(ValuePack) == sizeof(double) + 8,"value followed by the ratio and unit bytes");
+    ValuePack pack(value,Uc::One,Uc::Null);
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(&pack);
+    bytes[sizeof(double)] = ratio;
+    bytes[sizeof(double) + 1] = unit;
+    return pack;
+}
+
+static Uc::DecimalUnit Byte = Uc::Null;
+
+///不同单位、不同数量级、相等的换算结果、NaN、±0、±inf和非规格化数
+static std::vector<ValuePack> makeSpecialPacks()
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    const double values[] = {std::nan(""),-std::nan(""),0.0,-0.0,inf,-inf,1,-1,1000,0.001,1024,2.5,-2.5,
+                             std::numeric_limits<double>::denorm_min(),-std::numeric_limits<double>::max()};
+    const Uc::DecimalUnit units[] = {Uc::Null,Uc::Freq,Uc::Time,Byte};
+    const Uc::DecimalRatio ratios[] = {Uc::Milli,Uc::One,Uc::Kilo};
+    std::vector<ValuePack> packs;
+    for(Uc::DecimalUnit unit : units)
+        for(Uc::DecimalRatio ratio : ratios)
+            for(double value : values)
+                packs.emplace_back(value,ratio,unit);
+    packs.push_back(rawPack(1,9,Uc::Freq));
+    packs.push_back(rawPack(1,255,Byte));
+    return packs;
+}
+
+static void testStrictWeakOrder()
+{
+    const std::vector<ValuePack> packs = makeSpecialPacks();
+    const Uc::SortKeyLess less;
+    auto equivalent = [&less](const ValuePack& a,const ValuePack& b){ return !less(a,b) && !less(b,a); };
+    bool irreflexive = true;
+    bool asymmetric = true;
+    bool transitive = true;
+    bool equivalenceTransitive = true;
+    for(const ValuePack& a : packs)
+    {
+        irreflexive = irreflexive && !less(a,a);
+        for(const ValuePack& b : packs)
+        {
+            asymmetric = asymmetric && !(less(a,b) && less(b,a));
+            for(const ValuePack& c : packs)
+            {
+                transitive = transitive && !(less(a,b) && less(b,c) && !less(a,c));
+                equivalenceTransitive = equivalenceTransitive && !(equivalent(a,b) && equivalent(b,c) && !equivalent(a,c));
+            }
+        }
+    }
+    CHECK(irreflexive);
+    CHECK(asymmetric);
+    CHECK(transitive);
+    CHECK(equivalenceTransitive);
+
+    //换算到相同数量级之后相等的数值等价,-0与0等价,所有NaN等价并且排在同一单位的最后
+    CHECK(equivalent(ValuePack(1,Uc::Kilo,Uc::Freq),ValuePack(1000,Uc::One,Uc::Freq)));
+    CHECK(equivalent(ValuePack(1,Uc::Kilo,Byte),ValuePack(1024,Uc::One,Byte)));
+    CHECK(equivalent(ValuePack(-0.0,Uc::Kilo,Uc::Time),ValuePack(0.0,Uc::Milli,Uc::Time)));
+    CHECK(equivalent(ValuePack(std::nan(""),Uc::One,Uc::Freq),ValuePack(-std::nan(""),Uc::Kilo,Uc::Freq)));
+    CHECK(less(ValuePack(std::numeric_limits<double>::infinity(),Uc::One,Uc::Freq),ValuePack(-std::nan(""),Uc::One,Uc::Freq)));
+    CHECK(less(ValuePack(-1,Uc::Kilo,Uc::Freq),ValuePack(-1,Uc::One,Uc::Freq)));
+    //先按照单位排序
+    CHECK(less(ValuePack(std::nan(""),Uc::One,Uc::Null),ValuePack(-std::numeric_limits<double>::infinity(),Uc::One,Uc::Freq)));
+}
+
+///批量计算的排序键与逐个计算的相同,包括超出范围的数量级字节和没有注册的单位
+static void testSortKeys(const std::vector<ValuePack>& packs)
+{
+    std::vector<Uc::SortKey> keys(packs.size());
+    Uc::sortKeys(packs.data(),packs.size(),keys.data());
+    bool same = true;
+    for(std::size_t i = 0; i < packs.size(); i++)
+        same = same && keys[i] == Uc::sortKey(packs[i]);
+    CHECK(same);
+}
+
+///随机数据包,数值集中在少数几个值上以产生大量相等的排序键
+static std::vector<ValuePack> makeRandomPacks(std::size_t count,std::mt19937_64& rng)
+{
+    const std::vector<ValuePack> special = makeSpecialPacks();
+    std::vector<ValuePack> packs(count);
+    for(ValuePack& pack : packs)
+    {
+        switch(rng() % 4)
+        {
+        case 0: pack = special[rng() % special.size()]; break;
+        case 1: pack = rawPack(static_cast<double>(rng() % 5),static_cast<std::uint8_t>(rng() % 12),static_cast<std::uint8_t>(rng() % 3 == 0 ? 200 : rng() % 4)); break;
+        default:
+            pack = ValuePack(std::ldexp(static_cast<double>(static_cast<std::int64_t>(rng()) >> 11),static_cast<int>(rng() % 80) - 60),
+                             static_cast<Uc::DecimalRatio>(rng() % Uc::RatioNum),static_cast<Uc::DecimalUnit>(rng() % 3));
+            break;
+        }
+    }
+    return packs;
+}
+
+///基数排序的结果与按照排序键的std::stable_sort相同,排序键相同的元素保持原来的先后顺序
+static void testRadixSort(std::mt19937_64& rng)
+{
+    for(std::size_t count : {0,1,2,3,17,256,1000,20000})
+    {
+        const std::vector<ValuePack> packs = makeRandomPacks(count,rng);
+        testSortKeys(packs);
+
+        std::vector<std::uint32_t> expectedOrder(count);
+        std::iota(expectedOrder.begin(),expectedOrder.end(),0u);
+        std::stable_sort(expectedOrder.begin(),expectedOrder.end(),[&packs](std::uint32_t a,std::uint32_t b){
+            return Uc::sortKey(packs[a]) < Uc::sortKey(packs[b]);
+        });
+        const Uc::SortedIndex index(packs.data(),count);
+        CHECK(index.size() == count);
+        CHECK(index.order() == expectedOrder);
+        bool keys = true;
+        for(std::size_t i = 0; i < count; i++)
+            keys = keys && index.key(i) == Uc::sortKey(packs[expectedOrder[i]]);
+        CHECK(keys);
+
+        std::vector<ValuePack> expected = packs;
+        std::stable_sort(expected.begin(),expected.end(),Uc::SortKeyLess());
+        std::vector<ValuePack> actual = packs;
+        Uc::radixSort(actual.data(),count);
+        bool same = true;
+        for(std::size_t i = 0; i < count; i++)
+            same = same && samePack(expected[i],actual[i]);
+        CHECK(same);
+    }
+}
+
+static void testRange()
+{
+    const std::vector<ValuePack> packs = {
+        ValuePack(3,Uc::One,Uc::Freq),ValuePack(2,Uc::One,Uc::Freq),ValuePack(5,Uc::One,Uc::Time),ValuePack(std::nan(""),Uc::One,Uc::Freq),
+        ValuePack(1,Uc::Kilo,Uc::Freq),ValuePack(1,Uc::One,Uc::Freq),ValuePack(2,Uc::One,Uc::Freq),ValuePack(1,Uc::Giga,Uc::Freq)};
+    const Uc::SortedIndex index(packs.data(),packs.size());
+    //排序后: 1 Hz, 2 Hz(下标1), 2 Hz(下标6), 3 Hz, 1 kHz, 1 GHz, NaN Hz, 5 s
+    const std::vector<std::uint32_t> order = {5,1,6,0,4,7,3,2};
+    CHECK(index.order() == order);
+
+    //两端都包含在内,相等的元素全部包含
+    CHECK(index.range(ValuePack(2,Uc::One,Uc::Freq),ValuePack(3,Uc::One,Uc::Freq)) == std::make_pair(std::size_t(1),std::size_t(4)));
+    CHECK(index.range(ValuePack(2,Uc::One,Uc::Freq),ValuePack(2,Uc::One,Uc::Freq)) == std::make_pair(std::size_t(1),std::size_t(3)));
+    CHECK(index.range(ValuePack(3,Uc::One,Uc::Freq),ValuePack(1,Uc::Kilo,Uc::Freq)) == std::make_pair(std::size_t(3),std::size_t(5)));
+    //不同数量级换算之后比较
+    CHECK(index.range(ValuePack(1000,Uc::One,Uc::Freq),ValuePack(1000,Uc::Mega,Uc::Freq)) == std::make_pair(std::size_t(4),std::size_t(6)));
+    //下限大于上限时为空范围,单位不同时为{0,0}
+    const auto inverted = index.range(ValuePack(3,Uc::One,Uc::Freq),ValuePack(2,Uc::One,Uc::Freq));
+    CHECK(inverted.first == inverted.second);
+    CHECK(index.range(ValuePack(1,Uc::One,Uc::Freq),ValuePack(5,Uc::One,Uc::Time)) == std::make_pair(std::size_t(0),std::size_t(0)));
+    //-inf到inf不包括NaN
+    const double inf = std::numeric_limits<double>::infinity();
+    CHECK(index.range(ValuePack(-inf,Uc::One,Uc::Freq),ValuePack(inf,Uc::One,Uc::Freq)) == std::make_pair(std::size_t(0),std::size_t(6)));
+
+    CHECK(index.lowerBound(ValuePack(2,Uc::One,Uc::Freq)) == 1 && index.upperBound(ValuePack(2,Uc::One,Uc::Freq)) == 3);
+    CHECK(index.lowerBound(ValuePack(0,Uc::One,Uc::Freq)) == 0 && index.upperBound(ValuePack(0,Uc::One,Uc::Freq)) == 0);
+    CHECK(index.lowerBound(ValuePack(std::nan(""),Uc::One,Uc::Freq)) == 6 && index.upperBound(ValuePack(std::nan(""),Uc::One,Uc::Freq)) == 7);
+    CHECK(index.lowerBound(ValuePack(5,Uc::One,Uc::Time)) == 7 && index.upperBound(ValuePack(5,Uc::One,Uc::Time)) == 8);
+    CHECK(index.lowerBound(ValuePack(1,Uc::One,Uc::Voltage)) == 8);
+
+    CHECK(index.range(Uc::Freq) == std::make_pair(std::size_t(0),std::size_t(7)));
+    CHECK(index.range(Uc::Time) == std::make_pair(std::size_t(7),std::size_t(8)));
+    CHECK(index.range(Uc::Null) == std::make_pair(std::size_t(0),std::size_t(0)));
+    CHECK(index.range(Uc::Voltage) == std::make_pair(std::size_t(8),std::size_t(8)));
+
+    //超出范围的数量级字节按照最大的数量级(Giga)换算,超出单位范围的数量级不受单位范围的限制
+    CHECK(Uc::sortKey(rawPack(1,9,Uc::Freq)) == Uc::sortKey(ValuePack(1,Uc::Giga,Uc::Freq)));
+    CHECK(Uc::sortKey(rawPack(1,255,Uc::Freq)) == Uc::sortKey(ValuePack(1,Uc::Giga,Uc::Freq)));
+    CHECK(Uc::sortKey(rawPack(1,Uc::Kilo,Uc::Phase)) == Uc::sortKey(ValuePack(1000,Uc::One,Uc::Phase)));
+    CHECK(index.lowerBound(rawPack(1,200,Uc::Freq)) == 5 && index.upperBound(rawPack(1,200,Uc::Freq)) == 6);
+    CHECK(index.range(rawPack(0.5,200,Uc::Freq),rawPack(2,200,Uc::Freq)) == std::make_pair(std::size_t(5),std::size_t(6)));
+
+    const Uc::SortedIndex empty(packs.data(),0);
+    CHECK(empty.size() == 0 && empty.lowerBound(packs[0]) == 0 && empty.range(Uc::Freq) == std::make_pair(std::size_t(0),std::size_t(0)));
+}
+
+int main()
+{
+    Byte = Uc::registerUnit("B",Uc::One,Uc::Giga,1024);
+    std::mt19937_64 rng(5);
+    testStrictWeakOrder();
+    testSortKeys(makeSpecialPacks());
+    testRadixSort(rng);
+    testRange();
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
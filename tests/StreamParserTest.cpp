@@ -0,0 +1,174 @@
+﻿///StreamParser和parseChunks的测试:任意切分的数据与整段解析的结果相同,不依赖第三方测试框架
+///编译: g++ -std=c++20 -O2 -g -fsanitize=address,undefined -I.. StreamParserTest.cpp ../UnitConvertor.cpp ../StreamParser.cpp -o ucstreamtest
+///用法: ucstreamtest,全部通过时返回0,否则输出失败的检查并返回1
+///使用-std=c++17编译时没有协程,parseChunks的测试会被跳过
+
+#include "StreamParser.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+///数值逐位相同(包括NaN和-0),数量级和单位相同
+static bool samePack(const ValuePack& a,const ValuePack& b)
+{
+    const double x = a.value();
+    const double y = b.value();
+    return std::memcmp(&x,&y,sizeof(double)) == 0 && a.ratio() == b.ratio() && a.unit() == b.unit();
+}
+
+static bool sameResult(const Uc::ParseResult& a,const Uc::ParseResult& b)
+{
+    return samePack(a.pack,b.pack) && a.error == b.error && a.flags == b.flags && a.offset == b.offset;
+}
+
+///按分隔符拆开之后逐个调用tryFromString得到的结果,只包含空白字符的片段跳过
+static std::vector<Uc::ParseResult> expectedResults(const std::string& text,const std::string& separators)
+{
+    std::vector<Uc::ParseResult> results;
+    std::size_t begin = 0;
+    for(;;)
+    {
+        const std::size_t end = text.find_first_of(separators,begin);
+        const std::string token = text.substr(begin,end == std::string::npos ? std::string::npos : end - begin);
+        if(token.find_first_not_of(" \t\r\n") != std::string::npos)
+            results.push_back(Uc::tryFromString(token));
+        if(end == std::string::npos)
+            return results;
+        begin = end + 1;
+    }
+}
+
+static bool sameResults(const std::vector<Uc::ParseResult>& a,const std::vector<Uc::ParseResult>& b)
+{
+    if(a.size() != b.size())
+        return false;
+    for(std::size_t i = 0; i < a.size(); i++)
+        if(!sameResult(a[i],b[i]))
+            return false;
+    return true;
+}
+
+static const std::string Text = "1.2kHz,3.4 kHz;-5mV\r\n,,  ,7 s;12 xyz;0.5uA";
+
+///在每一对位置上把数据切成三段,数值被切开时结果也必须与整段解析相同
+static void testEverySplit()
+{
+    const std::vector<Uc::ParseResult> expected = expectedResults(Text,std::string(Uc::DefaultSeparators));
+    CHECK(expected.size() == 6);
+    bool same = true;
+    for(std::size_t i = 0; i <= Text.size(); i++)
+    {
+        for(std::size_t j = i; j <= Text.size(); j++)
+        {
+            std::vector<Uc::ParseResult> results;
+            Uc::StreamParser parser([&results](const Uc::ParseResult& result){ results.push_back(result); });
+            std::size_t emitted = parser.feed(std::string_view(Text).substr(0,i));
+            emitted += parser.feed(std::string_view(Text).substr(i,j - i));
+            emitted += parser.feed(std::string_view(Text).substr(j));
+            emitted += parser.finish();
+            same = same && emitted == results.size() && sameResults(results,expected) && parser.pending() == 0;
+        }
+    }
+    CHECK(same);
+}
+
+static void testColumnSink()
+{
+    Uc::ValueColumn column;
+    Uc::StreamParser parser(column,Uc::Voltage,";");
+    CHECK(parser.feed("1.5;2") == 1);
+    CHECK(parser.pending() == 1);
+    CHECK(parser.feed("5m;") == 1);
+    CHECK(parser.finish() == 0);
+    CHECK(column.size() == 2);
+    CHECK(column.values[0] == 1.5 && column.units[0] == Uc::Voltage);
+    CHECK(column.values[1] == 25 && column.ratios[1] == Uc::Milli && column.units[1] == Uc::Voltage);
+}
+
+///超过MaxTokenLength的片段报告ParseUnexpectedText,之后的片段正常解析
+static void testOverflow()
+{
+    std::vector<Uc::ParseResult> results;
+    Uc::StreamParser parser([&results](const Uc::ParseResult& result){ results.push_back(result); });
+    const std::string longToken(Uc::StreamParser::MaxTokenLength + 1,'1');
+    parser.feed(longToken.substr(0,100));
+    parser.feed(longToken.substr(100) + ",2 Hz");
+    parser.feed(",");
+    parser.feed(longToken + ",");
+    CHECK(results.size() == 3);
+    if(results.size() == 3)
+    {
+        CHECK(results[0].error == Uc::ParseUnexpectedText && results[0].offset == Uc::StreamParser::MaxTokenLength);
+        CHECK(results[1] && results[1].pack.value() == 2 && results[1].pack.unit() == Uc::Freq);
+        CHECK(results[2].error == Uc::ParseUnexpectedText);
+    }
+    parser.feed("3 s");
+    parser.reset();
+    CHECK(parser.pending() == 0 && parser.finish() == 0);
+}
+
+#ifdef UNITCONVERTOR_HAS_COROUTINE
+///分隔符是临时字符串,协程在第一次遍历时才构造StreamParser,此时临时字符串已经销毁
+static void testParseChunksTemporarySeparators()
+{
+    const std::vector<std::string> chunks = {"1.5k","Hz|2","0 mV|","| 3 s",""};
+    std::size_t next = 0;
+    auto read = [&chunks,&next]{ return std::string_view(chunks[next++]); };
+    Uc::ParseGenerator generator = Uc::parseChunks(read,Uc::DecimalUnit::UnitNum,std::string("|"));
+
+    std::vector<Uc::ParseResult> results;
+    for(const Uc::ParseResult& result : generator)
+        results.push_back(result);
+    CHECK(next == chunks.size());
+    CHECK(sameResults(results,expectedResults("1.5kHz|20 mV|| 3 s","|")));
+    CHECK(results.size() == 3);
+}
+
+///读取函数抛出的异常在遍历时重新抛出
+static void testParseChunksError()
+{
+    int calls = 0;
+    auto read = [&calls]() -> std::string_view {
+        if(calls++ == 0)
+            return "1 Hz,2 Hz,";
+        throw std::runtime_error("device timeout");
+    };
+    std::size_t count = 0;
+    bool thrown = false;
+    try
+    {
+        for(const Uc::ParseResult& result : Uc::parseChunks(read))
+            count += result ? 1 : 0;
+    }
+    catch(const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown && count == 2);
+}
+#endif
+
+int main()
+{
+    testEverySplit();
+    testColumnSink();
+    testOverflow();
+#ifdef UNITCONVERTOR_HAS_COROUTINE
+    testParseChunksTemporarySeparators();
+    testParseChunksError();
+#else
+    std::printf("coroutines not available, parseChunks tests skipped\n");
+#endif
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
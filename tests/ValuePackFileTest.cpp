@@ -0,0 +1,153 @@
+﻿///ValuePackWriter/ValuePackReader的往返测试和损坏数据测试,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -g -fsanitize=address,undefined -I.. ValuePackFileTest.cpp ../UnitConvertor.cpp ../ValuePackFile.cpp -o ucvptest
+///用法: ucvptest,全部通过时返回0,否则输出失败的检查并返回1
+///损坏的数据必须以std::invalid_argument报告,不能越界读取,所以最好加上AddressSanitizer运行
+
+#include "ValuePackFile.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+///数值逐位相同(包括NaN和-0),数量级和单位相同
+static bool samePack(const ValuePack& a,const ValuePack& b)
+{
+    const double x = a.value();
+    const double y = b.value();
+    return std::memcmp(&x,&y,sizeof(double)) == 0 && a.ratio() == b.ratio() && a.unit() == b.unit();
+}
+
+static std::string serialize(const std::vector<ValuePack>& packs,Uc::SerialEncoding encoding,std::uint32_t blockSize)
+{
+    std::ostringstream out;
+    Uc::ValuePackWriter writer(out,encoding,blockSize);
+    writer.append(packs.data(),packs.size());
+    writer.finish();
+    return out.str();
+}
+
+///构造、随机访问或者完整读取必须以std::invalid_argument结束
+static bool rejected(const std::string& data)
+{
+    try
+    {
+        //先直接定位到最后一个记录,再顺序读取,两条路径分别检查边界
+        Uc::ValuePackReader reader(data.data(),data.size());
+        if(reader.size() != 0)
+            reader.at(reader.size() - 1);
+        Uc::ValueColumn column;
+        reader.read(column);
+    }
+    catch(const std::invalid_argument&)
+    {
+        return true;
+    }
+    return false;
+}
+
+///计数、整数、任意浮点数、重复值、负数、NaN和-0混合的序列,单位成段变化
+static std::vector<ValuePack> makePacks(std::size_t count)
+{
+    std::mt19937_64 rng(5);
+    std::vector<ValuePack> packs;
+    double counter = 0;
+    for(std::size_t i = 0; i < count; i++)
+    {
+        double value = 0;
+        switch(rng() % 6)
+        {
+        case 0: value = counter += static_cast<double>(rng() % 5); break;
+        case 1: value = std::ldexp(static_cast<double>(static_cast<std::int64_t>(rng()) >> 11),static_cast<int>(rng() % 40) - 20); break;
+        case 2: value = packs.empty() ? 1 : packs.back().value(); break;
+        case 3: value = -static_cast<double>(rng() % 1000000); break;
+        case 4: value = rng() % 2 ? -0.0 : std::nan(""); break;
+        default: value = static_cast<double>(static_cast<std::int64_t>(rng() >> 8)); break;
+        }
+        packs.emplace_back(value,static_cast<Uc::DecimalRatio>(rng() % Uc::RatioNum),static_cast<Uc::DecimalUnit>((i / 300) % Uc::UnitNum));
+    }
+    return packs;
+}
+
+static void testRoundTrip(const std::vector<ValuePack>& packs)
+{
+    for(Uc::SerialEncoding encoding : {Uc::SerialRaw,Uc::SerialCompact})
+    {
+        for(std::uint32_t blockSize : {1u,7u,4096u})
+        {
+            const std::string data = serialize(packs,encoding,blockSize);
+            Uc::ValuePackReader reader(data.data(),data.size());
+            CHECK(reader.size() == packs.size());
+            CHECK(reader.encoding() == encoding);
+
+            std::size_t i = 0;
+            bool same = true;
+            for(const ValuePack& pack : reader)
+                same = same && i < packs.size() && samePack(pack,packs[i++]);
+            CHECK(same && i == packs.size());
+
+            for(std::size_t k = 0; k < packs.size(); k += 997)
+                CHECK(samePack(reader.at(k),packs[k]));
+            CHECK(samePack(reader.at(packs.size() - 1),packs.back()));
+
+            Uc::ValueColumn column;
+            reader.read(column);
+            CHECK(column.size() == packs.size());
+        }
+    }
+}
+
+static void testCorruption(const std::vector<ValuePack>& packs)
+{
+    std::mt19937_64 rng(11);
+    for(Uc::SerialEncoding encoding : {Uc::SerialRaw,Uc::SerialCompact})
+    {
+        const std::string data = serialize(packs,encoding,7);
+        //截断之后文件尾的标记不存在,必须拒绝
+        for(int i = 0; i < 100; i++)
+            CHECK(rejected(data.substr(0,rng() % data.size())));
+        //随机改写字节时可能得到另一份合法的数据,只要求不越界读取
+        for(int i = 0; i < 300; i++)
+        {
+            std::string damaged = data;
+            damaged[8 + rng() % (damaged.size() - 20)] ^= static_cast<char>(1 + rng() % 255);
+            rejected(damaged);
+        }
+    }
+}
+
+///文件尾中的记录个数被改大,但是与块数仍然一致:定长记录按照偏移直接定位,必须在构造时发现数据长度不符
+static void testCorruptedFooterCount()
+{
+    const std::vector<ValuePack> packs = {ValuePack(1,Uc::Milli,Uc::Voltage),ValuePack(2,Uc::One,Uc::Voltage),ValuePack(3,Uc::Kilo,Uc::Voltage)};
+    for(Uc::SerialEncoding encoding : {Uc::SerialRaw,Uc::SerialCompact})
+    {
+        std::string data = serialize(packs,encoding,4096);
+        std::uint64_t footerOffset = 0;
+        std::memcpy(&footerOffset,data.data() + data.size() - 12,sizeof(footerOffset));    //小端,与写入的格式相同
+        const std::uint64_t count = 4000;
+        std::memcpy(&data[static_cast<std::size_t>(footerOffset)],&count,sizeof(count));
+        CHECK(rejected(data));
+    }
+}
+
+int main()
+{
+    const std::vector<ValuePack> packs = makePacks(20000);
+    testRoundTrip(packs);
+    testCorruption(packs);
+    testCorruptedFooterCount();
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+﻿///ValueStatistics和summarize的测试:数组的向量化统计与逐个添加的结果相同,分组统计后合并与一次统计的结果相同,不依赖第三方测试框架
+///编译: g++ -std=c++17 -O2 -g -fsanitize=address,undefined -I.. ValueStatisticsTest.cpp ../UnitConvertor.cpp ../ValueStatistics.cpp -o ucstattest
+///用法: ucstattest,全部通过时返回0,否则输出失败的检查并返回1
+///求和顺序不同,所以均值、和与方差只要求相对误差足够小,个数、跳过的个数、最小值和最大值必须相同
+
+#include "ValueStatistics.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace Uc = UnitConvertor;
+
+static int failures = 0;
+
+#define CHECK(condition) do{ if(!(condition)){ ++failures; std::printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); } }while(0)
+
+static bool close(double a,double b)
+{
+    return a == b || std::abs(a - b) <= 1e-10 * std::max(std::abs(a),std::abs(b));
+}
+
+static bool sameStatistics(const Uc::ValueStatistics& a,const Uc::ValueStatistics& b)
+{
+    const Uc::ColumnSummary& x = a.summary();
+    const Uc::ColumnSummary& y = b.summary();
+    return a.count() == b.count() && a.skipped() == b.skipped() && x.min == y.min && x.max == y.max
+           && close(x.mean,y.mean) && close(x.sum + x.compensation,y.sum + y.compensation)
+           && std::abs(a.variance() - b.variance()) <= 1e-10 * std::max(1.0,a.variance());
+}
+
+static bool samePack(const ValuePack& a,const ValuePack& b)
+{
+    return a.value() == b.value() && a.ratio() == b.ratio() && a.unit() == b.unit();
+}
+
+///Freq的数值,数量级随机,偶尔是NaN或者其他单位
+static Uc::ValueColumn makeColumn(std::size_t count,std::mt19937_64& rng)
+{
+    Uc::ValueColumn column;
+    column.resize(count);
+    for(std::size_t i = 0; i < count; i++)
+    {
+        column.values[i] = static_cast<double>(static_cast<std::int64_t>(rng() % 2000001) - 1000000) / 1000;
+        column.ratios[i] = static_cast<std::uint8_t>(Uc::One + rng() % 4);
+        column.units[i] = Uc::Freq;
+        if(rng() % 50 == 0)
+            column.values[i] = std::nan("");
+        if(rng() % 40 == 0)
+            column.units[i] = Uc::Time;
+    }
+    return column;
+}
+
+static const std::size_t Counts[] = {0,1,2,3,7,8,9,1023,1024,1025,5000};
+
+///add(pack)逐个累加,其他重载经过summarize的向量化实现
+static void testBatchMatchesAdd(std::mt19937_64& rng)
+{
+    for(std::size_t count : Counts)
+    {
+        const Uc::ValueColumn column = makeColumn(count,rng);
+        Uc::ValueStatistics single(Uc::Freq);
+        for(std::size_t i = 0; i < count; i++)
+            single.add(ValuePack(column.values[i],static_cast<Uc::DecimalRatio>(column.ratios[i]),static_cast<Uc::DecimalUnit>(column.units[i])));
+
+        Uc::ValueStatistics batch(Uc::Freq);
+        batch.add(column);
+        CHECK(sameStatistics(single,batch));
+
+        //只有Freq的部分,用数组重载
+        std::vector<double> values;
+        std::vector<std::uint8_t> ratios;
+        Uc::ValueStatistics perValue(Uc::Freq);
+        for(std::size_t i = 0; i < count; i++)
+        {
+            if(column.units[i] != Uc::Freq)
+                continue;
+            values.push_back(column.values[i]);
+            ratios.push_back(column.ratios[i]);
+            perValue.add(column.values[i],static_cast<Uc::DecimalRatio>(column.ratios[i]));
+        }
+        Uc::ValueStatistics arrays(Uc::Freq);
+        arrays.add(values.data(),ratios.data(),values.size());
+        CHECK(sameStatistics(perValue,arrays));
+
+        //相同数量级
+        Uc::ValueStatistics sameRatio(Uc::Freq);
+        sameRatio.add(values.data(),values.size(),Uc::Kilo);
+        Uc::ValueStatistics sameRatioSingle(Uc::Freq);
+        for(double v : values)
+            sameRatioSingle.add(v,Uc::Kilo);
+        CHECK(sameStatistics(sameRatio,sameRatioSingle));
+    }
+}
+
+///把数据分成若干组分别统计之后合并,包括空的组
+static void testMerge(std::mt19937_64& rng)
+{
+    for(std::size_t count : Counts)
+    {
+        const Uc::ValueColumn column = makeColumn(count,rng);
+        Uc::ValueStatistics whole(Uc::Freq);
+        whole.add(column);
+
+        for(std::size_t parts : {1,2,3,7})
+        {
+            Uc::ValueStatistics merged(Uc::Freq);
+            for(std::size_t p = 0; p < parts; p++)
+            {
+                const std::size_t begin = count * p / parts;
+                const std::size_t end = count * (p + 1) / parts;
+                Uc::ValueStatistics part(Uc::Freq);
+                for(std::size_t i = begin; i < end; i++)
+                    part.add(ValuePack(column.values[i],static_cast<Uc::DecimalRatio>(column.ratios[i]),static_cast<Uc::DecimalUnit>(column.units[i])));
+                merged.merge(part);
+                merged.merge(Uc::ValueStatistics(Uc::Freq));
+            }
+            CHECK(sameStatistics(whole,merged));
+        }
+    }
+
+    //单位不同的统计结果只计入skipped
+    Uc::ValueStatistics freq(Uc::Freq);
+    freq.add(ValuePack(1,Uc::One,Uc::Freq));
+    Uc::ValueStatistics time(Uc::Time);
+    time.add(ValuePack(1,Uc::One,Uc::Time));
+    time.add(ValuePack(2,Uc::One,Uc::Time));
+    time.add(ValuePack(3,Uc::One,Uc::Freq));
+    freq.merge(time);
+    CHECK(freq.count() == 1 && freq.skipped() == 3 && freq.summary().max == 1);
+}
+
+static void testSkipped()
+{
+    Uc::ValueStatistics stats(Uc::Voltage);
+    stats.add(ValuePack(1,Uc::One,Uc::Voltage));
+    stats.add(ValuePack(1,Uc::One,Uc::Current));
+    stats.add(ValuePack(std::nan(""),Uc::Milli,Uc::Voltage));
+    stats.add(std::nan(""),Uc::One);
+    const double values[] = {1,std::nan(""),3};
+    stats.add(values,3,Uc::Milli);
+    CHECK(stats.count() == 3 && stats.skipped() == 4);
+
+    Uc::ValueColumn column;
+    column.resize(4);
+    const std::uint8_t units[] = {Uc::Voltage,Uc::Current,Uc::Current,Uc::Voltage};
+    for(std::size_t i = 0; i < 4; i++)
+    {
+        column.values[i] = 2;
+        column.ratios[i] = Uc::One;
+        column.units[i] = units[i];
+    }
+    stats.add(column);
+    CHECK(stats.count() == 5 && stats.skipped() == 6);
+
+    stats.reset();
+    CHECK(stats.count() == 0 && stats.skipped() == 0);
+}
+
+static void testResults()
+{
+    //没有数据时所有结果都是0,数量级为基本数量级
+    Uc::ValueStatistics empty(Uc::Freq);
+    const ValuePack zero(0,Uc::One,Uc::Freq);
+    CHECK(samePack(empty.min(),zero) && samePack(empty.max(),zero) && samePack(empty.mean(),zero));
+    CHECK(samePack(empty.sum(),zero) && samePack(empty.rms(),zero) && samePack(empty.stddev(),zero));
+    CHECK(empty.variance() == 0 && empty.count() == 0);
+
+    //基本数量级超出单位范围时使用允许的最小数量级
+    const Uc::DecimalUnit tonne = Uc::registerUnit("t",Uc::Kilo,Uc::Giga);
+    Uc::ValueStatistics heavy(tonne);
+    CHECK(samePack(heavy.min(),ValuePack(0,Uc::Kilo,tonne)) && samePack(heavy.stddev(),ValuePack(0,Uc::Kilo,tonne)));
+    heavy.add(ValuePack(5,Uc::Kilo,tonne));
+    CHECK(samePack(heavy.mean(),ValuePack(5,Uc::Kilo,tonne)));
+
+    //1 Hz、2 Hz、3 Hz、4 Hz,其中两个用其他数量级表示
+    Uc::ValueStatistics stats(Uc::Freq);
+    stats.add(ValuePack(0.001,Uc::Kilo,Uc::Freq));
+    stats.add(ValuePack(2,Uc::One,Uc::Freq));
+    stats.add(ValuePack(3,Uc::One,Uc::Freq));
+    stats.add(ValuePack(0.000004,Uc::Mega,Uc::Freq));
+    CHECK(stats.count() == 4);
+    CHECK(close(stats.summary().mean,2.5) && close(stats.variance(),1.25));
+    CHECK(close(stats.sum().value(),10) && stats.sum().ratio() == Uc::One);
+    CHECK(close(stats.rms().value(),std::sqrt(7.5)) && close(stats.stddev().value(),std::sqrt(1.25)));
+    CHECK(close(stats.min().value(),1) && close(stats.max().value(),4));
+
+    //结果转换为恰当的数量级
+    Uc::ValueStatistics large(Uc::Freq);
+    large.add(ValuePack(1.5,Uc::Mega,Uc::Freq));
+    large.add(ValuePack(2500,Uc::Kilo,Uc::Freq));
+    CHECK(large.mean().ratio() == Uc::Mega && close(large.mean().value(),2));
+    CHECK(large.sum().ratio() == Uc::Mega && close(large.sum().value(),4));
+    CHECK(large.min().ratio() == Uc::Mega && close(large.min().value(),1.5));
+}
+
+int main()
+{
+    std::mt19937_64 rng(21);
+    testBatchMatchesAdd(rng);
+    testMerge(rng);
+    testSkipped();
+    testResults();
+
+    std::printf(failures == 0 ? "all checks passed\n" : "%d checks failed\n",failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#!/bin/sh
+# 在拆分(默认)和内联(-DUNITCONVERTOR_INLINE)两种模式下编译并运行tests/中的所有测试,任何一项失败时返回1
+# 用法: tests/runTests.sh [输出目录],默认输出到${TMPDIR:-/tmp}/uctests;编译器由CXX环境变量指定,默认为g++
+# 每个测试的编译参数与测试文件开头的注释相同,另外加上模式的宏和-Wall -Wextra
+# 另外检查:
+#   每个源文件和头文件在UNITCONVERTOR_INLINE和UNITCONVERTOR_ENABLE_STATS的四种组合下都能单独编译
+#   InlineModeTest在两种模式下输出的摘要相同,即拆分和内联两种方式的ValuePack运算结果逐位相同
+
+cd "$(dirname "$0")" || exit 1
+CXX=${CXX:-g++}
+OUT=${1:-${TMPDIR:-/tmp}/uctests}
+mkdir -p "$OUT" || exit 1
+
+ASAN="-fsanitize=address,undefined -fno-sanitize-recover=undefined"
+TSAN="-fsanitize=thread"
+export TSAN_OPTIONS="halt_on_error=1"
+
+failed=0
+
+fail()
+{
+    echo "FAILED: $*"
+    failed=1
+}
+
+# build_and_run 模式 测试名 C++标准 检查工具参数 其他源文件...
+build_and_run()
+{
+    mode=$1
+    name=$2
+    std=$3
+    sanitize=$4
+    shift 4
+    flags="-std=$std -O2 -g -pthread -Wall -Wextra $sanitize"
+    [ "$mode" = inline ] && flags="$flags -DUNITCONVERTOR_INLINE"
+    exe="$OUT/$name-$mode"
+    # shellcheck disable=SC2086
+    if ! $CXX $flags -I.. "$name.cpp" "$@" -o "$exe"; then
+        fail "$name ($mode): build"
+        return
+    fi
+    if "$exe" > "$exe.log" 2>&1; then
+        echo "ok: $name ($mode)"
+    else
+        cat "$exe.log"
+        fail "$name ($mode)"
+    fi
+}
+
+for mode in split inline; do
+    build_and_run $mode ConvertCacheTest c++17 "$ASAN" ../UnitConvertor.cpp ../ConvertCache.cpp
+    build_and_run $mode ExactValueTest c++17 "$ASAN" ../UnitConvertor.cpp ../ExactValue.cpp
+    build_and_run $mode FormatBufferTest c++17 "$ASAN" ../UnitConvertor.cpp
+    build_and_run $mode FromStringDifferentialTest c++17 "" ../UnitConvertor.cpp
+    build_and_run $mode InlineModeTest c++17 "$ASAN" ../UnitConvertor.cpp
+    build_and_run $mode ParallelConvertorTest c++17 "$TSAN" ../UnitConvertor.cpp ../ParallelConvertor.cpp
+    build_and_run $mode ReadoutFormatterTest c++17 "$ASAN" ../UnitConvertor.cpp ../ReadoutFormatter.cpp
+    build_and_run $mode SimdKernelTest c++17 "$ASAN"
+    build_and_run $mode SortedIndexTest c++17 "$ASAN" ../UnitConvertor.cpp ../SortedIndex.cpp
+    build_and_run $mode StreamParserTest c++20 "$ASAN" ../UnitConvertor.cpp ../StreamParser.cpp
+    build_and_run $mode ValuePackFileTest c++17 "$ASAN" ../UnitConvertor.cpp ../ValuePackFile.cpp
+    build_and_run $mode ValueStatisticsTest c++17 "$ASAN" ../UnitConvertor.cpp ../ValueStatistics.cpp
+done
+
+split=$(grep digest "$OUT/InlineModeTest-split.log" | cut -d' ' -f3)
+inline=$(grep digest "$OUT/InlineModeTest-inline.log" | cut -d' ' -f3)
+if [ -n "$split" ] && [ "$split" = "$inline" ]; then
+    echo "ok: split and inline digests match ($split)"
+else
+    fail "split digest '$split' differs from inline digest '$inline'"
+fi
+
+for defines in "" "-DUNITCONVERTOR_INLINE" "-DUNITCONVERTOR_ENABLE_STATS" "-DUNITCONVERTOR_INLINE -DUNITCONVERTOR_ENABLE_STATS"; do
+    for source in ../*.cpp ../*.hpp; do
+        # shellcheck disable=SC2086
+        if ! $CXX -std=c++17 -fsyntax-only -Wall -Wextra $defines -I.. -x c++ "$source"; then
+            fail "$source ($defines)"
+        fi
+    done
+    echo "ok: sources and headers compile with '$defines'"
+done
+
+if [ $failed -eq 0 ]; then
+    echo "all tests passed"
+fi
+exit $failed
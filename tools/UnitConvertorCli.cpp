@@ -0,0 +1,467 @@
+﻿///批量转换测量日志文件中的数值,例如把CSV中的"12500 Hz"统一转换为"12.5 kHz"
+///编译: g++ -std=c++17 -O2 -pthread -I.. UnitConvertorCli.cpp ../UnitConvertor.cpp -o ucconvert
+///用法: ucconvert [选项] 输入文件 [输出文件]
+///  -c, --columns 1,3      需要转换的列(从1开始),默认转换所有列
+///  -d, --delimiter ,      列分隔符,默认为逗号,"\t"表示制表符
+///  -r, --ratio k          转换为指定数量级(n u m k M G,"1"表示不带数量级)
+///  -P, --proper           转换为恰当的数量级(默认)
+///  -s, --scientific       输出科学计数法
+///  -p, --precision N      保留N位有效数字(科学计数法时为小数点后N位),默认保留15位有效数字
+///  -t, --threads N        工作线程数,默认使用所有核心
+///无法解析的字段(例如表头)原样输出,转换结束后在stderr输出吞吐量
+
+#include "UnitConvertor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+///只读内存映射文件
+class MappedFile
+{
+public:
+    explicit MappedFile(const char* path)
+    {
+#ifdef _WIN32
+        m_File = CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,nullptr);
+        if(m_File == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(m_File,&size))
+            return;
+        m_Size = static_cast<std::size_t>(size.QuadPart);
+        m_Valid = true;
+        if(m_Size == 0)
+            return;
+        m_Mapping = CreateFileMappingA(m_File,nullptr,PAGE_READONLY,0,0,nullptr);
+        if(m_Mapping != nullptr)
+            m_Data = static_cast<const char*>(MapViewOfFile(m_Mapping,FILE_MAP_READ,0,0,0));
+        m_Valid = m_Data != nullptr;
+#else
+        m_Fd = ::open(path,O_RDONLY);
+        if(m_Fd < 0)
+            return;
+        struct stat st;
+        if(::fstat(m_Fd,&st) != 0)
+            return;
+        m_Size = static_cast<std::size_t>(st.st_size);
+        m_Valid = true;
+        if(m_Size == 0)
+            return;
+        void* data = ::mmap(nullptr,m_Size,PROT_READ,MAP_PRIVATE,m_Fd,0);
+        if(data == MAP_FAILED)
+        {
+            m_Valid = false;
+            return;
+        }
+        ::madvise(data,m_Size,MADV_SEQUENTIAL);
+        m_Data = static_cast<const char*>(data);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if(m_Data != nullptr)
+            UnmapViewOfFile(m_Data);
+        if(m_Mapping != nullptr)
+            CloseHandle(m_Mapping);
+        if(m_File != INVALID_HANDLE_VALUE)
+            CloseHandle(m_File);
+#else
+        if(m_Data != nullptr)
+            ::munmap(const_cast<char*>(m_Data),m_Size);
+        if(m_Fd >= 0)
+            ::close(m_Fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    bool valid() const noexcept { return m_Valid; }
+    const char* data() const noexcept { return m_Data; }
+    std::size_t size() const noexcept { return m_Size; }
+
+private:
+#ifdef _WIN32
+    HANDLE m_File = INVALID_HANDLE_VALUE;
+    HANDLE m_Mapping = nullptr;
+#else
+    int m_Fd = -1;
+#endif
+    const char* m_Data = nullptr;
+    std::size_t m_Size = 0;
+    bool m_Valid = false;
+};
+
+enum class Mode{Ratio,Proper,Scientific};
+
+struct Options
+{
+    const char* input = nullptr;
+    const char* output = nullptr;
+    std::vector<std::size_t> columns;   //从0开始,为空时转换所有列
+    char delimiter = ',';
+    Mode mode = Mode::Proper;
+    Uc::DecimalRatio ratio = Uc::One;
+    int precision = 15;
+    unsigned threads = 0;
+};
+
+void printUsage()
+{
+    std::fputs("usage: ucconvert [-c cols] [-d delim] [-r ratio | -P | -s] [-p precision] [-t threads] input [output]\n",stderr);
+}
+
+bool parseRatio(const char* text,Uc::DecimalRatio& ratio)
+{
+    if(std::strcmp(text,"1") == 0)
+    {
+        ratio = Uc::One;
+        return true;
+    }
+    for(int i = 0; i < Uc::RatioNum; i++)
+    {
+        if(!Uc::DecimalRatioString[i].empty() && Uc::DecimalRatioString[i] == text)
+        {
+            ratio = static_cast<Uc::DecimalRatio>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseColumns(const char* text,std::vector<std::size_t>& columns)
+{
+    while(*text != '\0')
+    {
+        char* end = nullptr;
+        unsigned long column = std::strtoul(text,&end,10);
+        if(end == text || column == 0)
+            return false;
+        columns.push_back(column - 1);
+        text = *end == ',' ? end + 1 : end;
+        if(*end != ',' && *end != '\0')
+            return false;
+    }
+    std::sort(columns.begin(),columns.end());
+    return !columns.empty();
+}
+
+bool parseOptions(int argc,char** argv,Options& options)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        auto is = [&](const char* s,const char* l){ return std::strcmp(arg,s) == 0 || std::strcmp(arg,l) == 0; };
+
+        if(is("-c","--columns"))
+        {
+            const char* v = value();
+            if(v == nullptr || !parseColumns(v,options.columns))
+                return false;
+        }
+        else if(is("-d","--delimiter"))
+        {
+            const char* v = value();
+            if(v == nullptr)
+                return false;
+            options.delimiter = std::strcmp(v,"\\t") == 0 ? '\t' : v[0];
+        }
+        else if(is("-r","--ratio"))
+        {
+            const char* v = value();
+            if(v == nullptr || !parseRatio(v,options.ratio))
+                return false;
+            options.mode = Mode::Ratio;
+        }
+        else if(is("-P","--proper"))
+        {
+            options.mode = Mode::Proper;
+        }
+        else if(is("-s","--scientific"))
+        {
+            options.mode = Mode::Scientific;
+        }
+        else if(is("-p","--precision"))
+        {
+            const char* v = value();
+            if(v == nullptr)
+                return false;
+            options.precision = std::atoi(v);
+        }
+        else if(is("-t","--threads"))
+        {
+            const char* v = value();
+            if(v == nullptr)
+                return false;
+            options.threads = static_cast<unsigned>(std::atoi(v));
+        }
+        else if(arg[0] == '-' && arg[1] != '\0')
+        {
+            return false;
+        }
+        else if(options.input == nullptr)
+        {
+            options.input = arg;
+        }
+        else if(options.output == nullptr)
+        {
+            options.output = arg;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return options.input != nullptr;
+}
+
+///一个工作块:输入中以换行结尾的一段连续行,以及转换之后的输出
+struct Chunk
+{
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    std::string output;
+    std::size_t values = 0;
+    bool done = false;
+};
+
+class Converter
+{
+public:
+    explicit Converter(const Options& options) : m_Options(options) {}
+
+    ///转换一个块,结果追加到chunk.output
+    void convert(Chunk& chunk) const
+    {
+        chunk.output.reserve(static_cast<std::size_t>(chunk.end - chunk.begin) + (static_cast<std::size_t>(chunk.end - chunk.begin) >> 2));
+        const char* line = chunk.begin;
+        while(line < chunk.end)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(line,'\n',static_cast<std::size_t>(chunk.end - line)));
+            const char* next = lineEnd == nullptr ? chunk.end : lineEnd + 1;
+            if(lineEnd == nullptr)
+                lineEnd = chunk.end;
+            const char* contentEnd = lineEnd > line && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+
+            convertLine(line,contentEnd,chunk);
+            chunk.output.append(contentEnd,next);//保留原来的换行符
+            line = next;
+        }
+    }
+
+private:
+    void convertLine(const char* begin,const char* end,Chunk& chunk) const
+    {
+        std::size_t column = 0;
+        std::size_t selected = 0;
+        const char* field = begin;
+        while(true)
+        {
+            const char* fieldEnd = static_cast<const char*>(std::memchr(field,m_Options.delimiter,static_cast<std::size_t>(end - field)));
+            if(fieldEnd == nullptr)
+                fieldEnd = end;
+
+            bool wanted = m_Options.columns.empty();
+            while(!wanted && selected < m_Options.columns.size() && m_Options.columns[selected] < column)
+                ++selected;
+            if(!wanted && selected < m_Options.columns.size())
+                wanted = m_Options.columns[selected] == column;
+
+            if(wanted && convertField(field,fieldEnd,chunk.output))
+                ++chunk.values;
+            else
+                chunk.output.append(field,fieldEnd);
+
+            if(fieldEnd == end)
+                break;
+            chunk.output.push_back(m_Options.delimiter);
+            field = fieldEnd + 1;
+            ++column;
+        }
+    }
+
+    ///字段能够被解析时写入转换结果并返回true
+    bool convertField(const char* begin,const char* end,std::string& output) const
+    {
+        if(begin == end)
+            return false;
+        Uc::ParseResult parsed = Uc::tryFromString(std::string_view(begin,static_cast<std::size_t>(end - begin)));
+        if(!parsed)
+            return false;
+
+        ValuePack pack = parsed.pack;
+        if(m_Options.mode == Mode::Ratio)
+            pack = Uc::ratioTo(pack,m_Options.ratio);
+        else
+            pack = Uc::proper(pack);
+
+        char buffer[512];
+        std::size_t len = 0;
+        if(m_Options.mode == Mode::Scientific)
+            len = Uc::toScientificString(pack,buffer,sizeof(buffer),m_Options.precision);
+        else
+            len = Uc::toFormatString(pack,buffer,sizeof(buffer),m_Options.precision,false);
+        if(len == Uc::FormatFailed)
+            return false;
+
+        //去掉单位为空时末尾的空格
+        while(len > 0 && buffer[len - 1] == ' ')
+            --len;
+        output.append(buffer,len);
+        return true;
+    }
+
+    const Options& m_Options;
+};
+
+///按照换行把输入切分为大约chunkSize大小的块
+std::vector<Chunk> splitChunks(const char* data,std::size_t size,std::size_t chunkSize)
+{
+    std::vector<Chunk> chunks;
+    const char* end = data + size;
+    const char* begin = data;
+    while(begin < end)
+    {
+        const char* split = begin + std::min(chunkSize,static_cast<std::size_t>(end - begin));
+        if(split < end)
+        {
+            const char* newline = static_cast<const char*>(std::memchr(split,'\n',static_cast<std::size_t>(end - split)));
+            split = newline == nullptr ? end : newline + 1;
+        }
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = split;
+        chunks.push_back(std::move(chunk));
+        begin = split;
+    }
+    return chunks;
+}
+}
+
+int main(int argc,char** argv)
+{
+    Options options;
+    if(!parseOptions(argc,argv,options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    MappedFile input(options.input);
+    if(!input.valid())
+    {
+        std::fprintf(stderr,"ucconvert: cannot open %s\n",options.input);
+        return 1;
+    }
+
+    std::FILE* output = options.output == nullptr ? stdout : std::fopen(options.output,"wb");
+    if(output == nullptr)
+    {
+        std::fprintf(stderr,"ucconvert: cannot create %s\n",options.output);
+        return 1;
+    }
+    static char outputBuffer[1 << 22];
+    std::setvbuf(output,outputBuffer,_IOFBF,sizeof(outputBuffer));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    unsigned threads = options.threads != 0 ? options.threads : std::max(1u,std::thread::hardware_concurrency());
+    std::vector<Chunk> chunks = splitChunks(input.data(),input.size(),std::size_t(4) << 20);
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads,std::max<std::size_t>(chunks.size(),1)));
+
+    //工作线程按顺序领取块,主线程按顺序输出;最多同时保留maxInFlight个未输出的块以限制内存占用
+    const std::size_t maxInFlight = std::size_t(threads) * 4;
+    Converter converter(options);
+    std::mutex mutex;
+    std::condition_variable produced;
+    std::condition_variable consumed;
+    std::size_t nextChunk = 0;
+    std::size_t written = 0;
+
+    auto worker = [&]{
+        while(true)
+        {
+            std::size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                consumed.wait(lock,[&]{ return nextChunk >= chunks.size() || nextChunk < written + maxInFlight; });
+                if(nextChunk >= chunks.size())
+                    return;
+                index = nextChunk++;
+            }
+            converter.convert(chunks[index]);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunks[index].done = true;
+            }
+            produced.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(unsigned i = 0; i < threads; i++)
+        pool.emplace_back(worker);
+
+    std::size_t values = 0;
+    bool writeFailed = false;
+    for(std::size_t i = 0; i < chunks.size(); i++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            produced.wait(lock,[&]{ return chunks[i].done; });
+        }
+        Chunk& chunk = chunks[i];
+        if(std::fwrite(chunk.output.data(),1,chunk.output.size(),output) != chunk.output.size())
+            writeFailed = true;
+        values += chunk.values;
+        std::string().swap(chunk.output);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written = i + 1;
+        }
+        consumed.notify_all();
+    }
+
+    for(std::thread& thread : pool)
+        thread.join();
+
+    if(std::fflush(output) != 0)
+        writeFailed = true;
+    if(output != stdout)
+        std::fclose(output);
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double mb = static_cast<double>(input.size()) / (1024.0 * 1024.0);
+    std::fprintf(stderr,"ucconvert: %.1f MB, %zu values in %.3f s (%.1f MB/s, %.0f values/s, %u threads)\n",
+                 mb,values,seconds,seconds > 0 ? mb / seconds : 0.0,seconds > 0 ? static_cast<double>(values) / seconds : 0.0,threads);
+
+    if(writeFailed)
+    {
+        std::fputs("ucconvert: write failed\n",stderr);
+        return 1;
+    }
+    return 0;
+}